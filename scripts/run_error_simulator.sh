@@ -71,11 +71,12 @@ show_menu() {
     echo -e "${GREEN}5)${NC} Race Condition"
     echo -e "${GREEN}6)${NC} Deadlock"
     echo -e "${GREEN}7)${NC} Core Dump"
-    echo -e "${GREEN}8)${NC} Executar Todos os Testes"
-    echo -e "${GREEN}9)${NC} Compilar Exemplos"
+    echo -e "${GREEN}8)${NC} Pressão de Memória"
+    echo -e "${GREEN}9)${NC} Executar Todos os Testes"
+    echo -e "${GREEN}10)${NC} Compilar Exemplos"
     echo -e "${GREEN}0)${NC} Sair"
     echo ""
-    echo -e "${YELLOW}Digite sua escolha [0-9]:${NC} "
+    echo -e "${YELLOW}Digite sua escolha [0-10]:${NC} "
 }
 
 # Função para executar comando com aviso
@@ -118,7 +119,12 @@ interactive_menu() {
         case $choice in
             1)
                 ensure_compiled
-                run_with_warning "run_with_timeout 10s ./bin/stack_overflow" \
+                echo -e "${CYAN}Escolha o tipo de stack overflow:${NC}"
+                echo "1) Recursão infinita"
+                echo "2) Estouro medido numa thread (profundidade e bytes por frame)"
+                echo -e "${YELLOW}Digite [1-2]:${NC} "
+                read -r substack
+                run_with_warning "run_with_timeout 10s ./bin/stack_overflow $substack" \
                     "Este comando causará stack overflow e pode travar o processo!"
                 ;;
             2)
@@ -127,7 +133,8 @@ interactive_menu() {
                 echo "1) Ponteiro nulo"
                 echo "2) Memória inválida"  
                 echo "3) Array bounds"
-                echo -e "${YELLOW}Digite [1-3]:${NC} "
+                echo "4) Custo de falhas recuperáveis (kernel, SIGSEGV, userfaultfd)"
+                echo -e "${YELLOW}Digite [1-4]:${NC} "
                 read -r subfault
                 run_with_warning "./bin/segmentation_fault $subfault" \
                     "Este comando causará segmentation fault!"
@@ -138,7 +145,8 @@ interactive_menu() {
                 echo "1) Stack buffer overflow"
                 echo "2) Heap buffer overflow"
                 echo "3) Format string vulnerability"
-                echo -e "${YELLOW}Digite [1-3]:${NC} "
+                echo "4) Custo do alocador com página de guarda"
+                echo -e "${YELLOW}Digite [1-4]:${NC} "
                 read -r suboverflow
                 run_with_warning "./bin/buffer_overflow $suboverflow" \
                     "Este comando pode causar comportamento instável!"
@@ -149,7 +157,9 @@ interactive_menu() {
                 echo "1) Vazamento simples"
                 echo "2) Vazamento recursivo"
                 echo "3) Vazamento crescente"
-                echo -e "${YELLOW}Digite [1-3]:${NC} "
+                echo "4) Estratégias de alocação"
+                echo "5) Custo do primeiro toque (4k, THP, populate, threads)"
+                echo -e "${YELLOW}Digite [1-5]:${NC} "
                 read -r subleak
                 echo -e "${YELLOW}Use 'top' ou 'htop' em outro terminal para monitorar memória${NC}"
                 run_with_warning "run_with_timeout 15s ./bin/memory_leak $subleak" \
@@ -161,7 +171,11 @@ interactive_menu() {
                 echo "1) Contador compartilhado"
                 echo "2) Simulação bancária"
                 echo "3) Ambos"
-                echo -e "${YELLOW}Digite [1-3]:${NC} "
+                echo "4) Benchmark do contador (mutex, atomic, spinlock, sharded)"
+                echo "5) False sharing (packed, padded, thread-local)"
+                echo "6) Benchmark do livro-razão (coarse, striped, batched)"
+                echo "7) Busca de cronograma (livre, pct, aleatorio) e replay determinístico"
+                echo -e "${YELLOW}Digite [1-7]:${NC} "
                 read -r subrace
                 run_with_warning "./bin/race_condition $subrace" \
                     "Este comando demonstrará condições de corrida entre threads!"
@@ -171,7 +185,10 @@ interactive_menu() {
                 echo -e "${CYAN}Escolha o tipo de deadlock:${NC}"
                 echo "1) Deadlock simples (2 mutex)"
                 echo "2) Deadlock complexo (múltiplos mutex)"
-                echo -e "${YELLOW}Digite [1-2]:${NC} "
+                echo "3) Inversão de ordem sem deadlock (lockdep)"
+                echo "4) Custo do lockdep sem disputa"
+                echo "5) Estratégias para evitar deadlock (ordered, backoff, arbiter)"
+                echo -e "${YELLOW}Digite [1-5]:${NC} "
                 read -r subdeadlock
                 run_with_warning "run_with_timeout 30s ./bin/deadlock $subdeadlock" \
                     "Este comando pode travar indefinidamente devido ao deadlock!"
@@ -183,17 +200,29 @@ interactive_menu() {
                 echo "2) SIGFPE     6) Bus error"
                 echo "3) SIGILL     7) Double free"
                 echo "4) SIGABRT    8) Use after free"
-                echo -e "${YELLOW}Digite [1-8]:${NC} "
+                echo "9) Custo do minidump x core completo"
+                echo "10) Captura de core: completo x enxuto x coletor"
+                echo -e "${YELLOW}Digite [1-10]:${NC} "
                 read -r subcore
                 run_with_warning "./bin/core_dump $subcore" \
                     "Este comando causará terminação anormal do processo!"
                 ;;
             8)
+                ensure_compiled
+                echo -e "${CYAN}Escolha o modo de pressão de memória:${NC}"
+                echo "1) Crescer até o OOM killer"
+                echo "2) Descartar memória sob pressão e sobreviver"
+                echo -e "${YELLOW}Digite [1-2]:${NC} "
+                read -r subpressure
+                run_with_warning "./bin/memory_pressure $subpressure" \
+                    "Este comando consumirá memória até o limite do cgroup!"
+                ;;
+            9)
                 ensure_compiled
                 run_with_warning "make test-all" \
                     "Isso executará TODOS os testes! Alguns podem travar o sistema!"
                 ;;
-            9)
+            10)
                 echo -e "${YELLOW}Compilando todos os exemplos...${NC}"
                 make clean && make all
                 echo -e "${GREEN}Compilação concluída!${NC}"
@@ -220,13 +249,14 @@ show_help() {
     echo "  $0 [tipo] [opção]     - Execução direta"
     echo ""
     echo "Tipos disponíveis:"
-    echo "  stack_overflow        - Demonstra stack overflow"
-    echo "  segfault [1-3]       - Demonstra segmentation fault"
-    echo "  buffer_overflow [1-3] - Demonstra buffer overflow"
-    echo "  memory_leak [1-3]    - Demonstra memory leak"
-    echo "  race_condition [1-3] - Demonstra race condition"
-    echo "  deadlock [1-2]       - Demonstra deadlock"
-    echo "  core_dump [1-8]      - Demonstra core dump"
+    echo "  stack_overflow [1-2] - Demonstra stack overflow"
+    echo "  segfault [1-4]       - Demonstra segmentation fault"
+    echo "  buffer_overflow [1-4] - Demonstra buffer overflow"
+    echo "  memory_leak [1-5]    - Demonstra memory leak"
+    echo "  race_condition [1-7] - Demonstra race condition"
+    echo "  deadlock [1-5]       - Demonstra deadlock"
+    echo "  core_dump [1-10]     - Demonstra core dump"
+    echo "  memory_pressure [1-2] - Demonstra pressão de memória e OOM killer"
     echo ""
     echo "Exemplos:"
     echo "  $0 segfault 1        - Executa segfault por ponteiro nulo"
@@ -250,8 +280,9 @@ else
     
     case "$1" in
         stack_overflow)
-            echo -e "${RED}Executando stack overflow...${NC}"
-            run_with_timeout 10s "./bin/stack_overflow"
+            option=${2:-1}
+            echo -e "${RED}Executando stack overflow (tipo $option)...${NC}"
+            run_with_timeout 10s "./bin/stack_overflow $option"
             ;;
         segfault)
             option=${2:-1}
@@ -283,6 +314,11 @@ else
             echo -e "${RED}Executando core dump (tipo $option)...${NC}"
             ./bin/core_dump "$option"
             ;;
+        memory_pressure)
+            option=${2:-1}
+            echo -e "${RED}Executando pressão de memória (modo $option)...${NC}"
+            ./bin/memory_pressure "$option"
+            ;;
         *)
             echo -e "${RED}Tipo inválido: $1${NC}"
             echo ""
@@ -0,0 +1,146 @@
+#!/bin/bash
+
+# Varredura de escalabilidade dos cenários com threads
+#
+# Roda um cenário com 1..N threads (--threads=T), repetindo cada ponto,
+# e resume as medições gravadas em TSV (--results) numa tabela com
+# média e desvio padrão do tempo e da vazão, e a aceleração em relação
+# a 1 thread do mesmo modo.
+#
+# Uso: scripts/sweep.sh [opções] <cenário> <opção> [argumentos do cenário]
+#
+#   -r N       repetições por ponto (padrão 5)
+#   -m N       máximo de threads (padrão: nproc)
+#   -s N       passo entre contagens: 1, N, 2N, ... e sempre o máximo (padrão 1)
+#   -i N       iterações por thread (--iterations)
+#   -w N       trabalho fora da seção crítica por iteração (--work)
+#   -p cpus    fixa as threads em CPUs (--pin): "1" usa as permitidas, ou "0-31"
+#   -b dir     diretório dos executáveis (padrão: bin)
+#   -o arq     guarda as medições brutas em arq (padrão: arquivo temporário)
+#
+# Exemplos:
+#   scripts/sweep.sh -r 10 race_condition 4            # contador: todos os modos
+#   scripts/sweep.sh -s 8 -p 1 race_condition 6 0 1000000 256
+#   scripts/sweep.sh -w 200 deadlock 5 todas 0 64 500 1
+
+set -u
+
+REPEATS=5
+MAX_THREADS=$(nproc 2>/dev/null || sysctl -n hw.ncpu 2>/dev/null || echo 4)
+STEP=1
+BINDIR=bin
+RAW=""
+EXTRA=()
+
+usage() {
+    sed -n '3,24p' "$0" | sed 's/^# \{0,1\}//'
+    exit 2
+}
+
+while getopts "r:m:s:i:w:p:b:o:h" opt; do
+    case $opt in
+        r) REPEATS=$OPTARG ;;
+        m) MAX_THREADS=$OPTARG ;;
+        s) STEP=$OPTARG ;;
+        i) EXTRA+=("--iterations=$OPTARG") ;;
+        w) EXTRA+=("--work=$OPTARG") ;;
+        p) EXTRA+=("--pin=$OPTARG") ;;
+        b) BINDIR=$OPTARG ;;
+        o) RAW=$OPTARG ;;
+        *) usage ;;
+    esac
+done
+shift $((OPTIND - 1))
+[ $# -ge 1 ] || usage
+
+SCENARIO=$1
+shift
+if [ ! -x "$BINDIR/$SCENARIO" ]; then
+    echo "Executável não encontrado: $BINDIR/$SCENARIO (rode make all)" >&2
+    exit 1
+fi
+
+if [ -z "$RAW" ]; then
+    RAW=$(mktemp "${TMPDIR:-/tmp}/sweep.XXXXXX")
+    trap 'rm -f "$RAW"' EXIT
+else
+    : > "$RAW"
+fi
+
+# 1, passo, 2*passo, ... e sempre o máximo
+counts="1"
+for ((t = STEP; t < MAX_THREADS; t += STEP)); do
+    [ "$t" -gt 1 ] && counts="$counts $t"
+done
+[ "$MAX_THREADS" -gt 1 ] && counts="$counts $MAX_THREADS"
+
+echo "=== VARREDURA: $SCENARIO $* ===" >&2
+echo "threads: $counts; $REPEATS repetições por ponto" >&2
+
+for t in $counts; do
+    for ((rep = 1; rep <= REPEATS; rep++)); do
+        printf "\r  %3d threads, repetição %d/%d " "$t" "$rep" "$REPEATS" >&2
+        "$BINDIR/$SCENARIO" "$@" "--threads=$t" "--results=$RAW" ${EXTRA[@]+"${EXTRA[@]}"} > /dev/null 2>&1
+        status=$?
+        # 3 = race condition perdeu atualizações (esperado); sinais são falhas
+        if [ $status -ge 128 ]; then
+            echo >&2
+            echo "  $t threads: terminou com código $status" >&2
+        fi
+    done
+done
+echo >&2
+
+if [ ! -s "$RAW" ]; then
+    echo "Nenhuma medição registrada (o cenário/opção grava resultados?)" >&2
+    exit 1
+fi
+
+# cenário modo threads work ops segundos perdidos
+awk -F'\t' '
+    {
+        key = $1 SUBSEP $2 SUBSEP $3 SUBSEP $4
+        mode = $1 SUBSEP $2 SUBSEP $4
+        if (!(key in n)) {
+            order[++keys] = key
+            mode_of[key] = mode
+        }
+        if (!(mode in seen)) {
+            seen[mode] = 1
+            modes[++mode_count] = mode
+        }
+        n[key]++
+        s[key] += $6;  s2[key] += $6 * $6
+        v = $6 > 0 ? $5 / $6 : 0
+        x[key] += v;   x2[key] += v * v
+        lost[key] += $7
+    }
+    function sd(sum, sumsq, count,    var) {
+        if (count < 2) return 0
+        var = (sumsq - sum * sum / count) / (count - 1)
+        return var > 0 ? sqrt(var) : 0
+    }
+    END {
+        printf "%-14s %-13s %7s %6s %4s %12s %10s %14s %12s %9s %10s\n",
+               "cenário", "modo", "threads", "work", "n", "tempo(s)", "±desvio",
+               "ops/s", "±desvio", "acelera", "perdidos"
+        # Um bloco por modo, na ordem em que o cenário os mede; as contagens
+        # de threads já chegam em ordem crescente
+        for (m = 1; m <= mode_count; m++) {
+            single = 0
+            for (i = 1; i <= keys; i++) {
+                key = order[i]
+                if (mode_of[key] != modes[m]) continue
+                split(key, f, SUBSEP)
+                mean_x = x[key] / n[key]
+                if (f[3] == 1) single = mean_x
+                printf "%-14s %-13s %7d %6d %4d %12.6f %10.6f %14.0f %12.0f %8.2fx %10.1f\n",
+                       f[1], f[2], f[3], f[4], n[key], s[key] / n[key], sd(s[key], s2[key], n[key]),
+                       mean_x, sd(x[key], x2[key], n[key]), (single > 0 ? mean_x / single : 0),
+                       lost[key] / n[key]
+            }
+            printf "\n"
+        }
+        printf "acelera = vazão média / vazão média com 1 thread do mesmo modo\n"
+    }
+' "$RAW"
@@ -0,0 +1,274 @@
+/*
+ * Alocadores alternativos - implementação
+ *
+ * A arena é uma lista de chunks de pelo menos 1 MiB; o reset só volta o
+ * cursor para o primeiro chunk. O pool guarda, em cada bloco livre, o
+ * ponteiro para o próximo, tanto no cache da thread quanto na lista
+ * global da classe.
+ */
+
+#define _GNU_SOURCE
+#include "alloc_backend.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+
+#define ARENA_ALIGN 16
+#define ARENA_CHUNK (1024 * 1024)
+
+#define POOL_MIN_SHIFT 4             // 16 bytes
+#define POOL_MAX_SHIFT 16            // 64 KiB
+#define POOL_CLASSES (POOL_MAX_SHIFT - POOL_MIN_SHIFT + 1)
+#define POOL_SLAB (256 * 1024)
+#define CACHE_MAX 64                 // blocos no cache da thread por classe
+#define CACHE_BATCH 32               // blocos trocados com a lista global
+
+static atomic_size_t footprint_bytes[2]; // [0] arena, [1] pool
+
+static size_t page_round(size_t bytes) {
+    size_t page = 4096;
+    return (bytes + page - 1) & ~(page - 1);
+}
+
+static void* map_pages(size_t bytes) {
+    void* mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return mem == MAP_FAILED ? NULL : mem;
+}
+
+/* ---- glibc ---- */
+
+static void* glibc_alloc(size_t size) {
+    return malloc(size);
+}
+
+static void glibc_free(void* ptr, size_t size) {
+    (void)size;
+    free(ptr);
+}
+
+static size_t glibc_usable(void* ptr, size_t size) {
+    (void)size;
+    return malloc_usable_size(ptr);
+}
+
+static size_t glibc_footprint() {
+    struct mallinfo2 info = mallinfo2();
+    return info.arena + info.hblkhd;
+}
+
+const alloc_backend_t glibc_backend = {"glibc", glibc_alloc, glibc_free, NULL, glibc_usable, glibc_footprint};
+
+/* ---- arena ---- */
+
+typedef struct chunk {
+    struct chunk* next;
+    size_t size;
+    char data[];
+} chunk_t;
+
+typedef struct {
+    chunk_t* first;
+    chunk_t* current;
+    size_t offset;
+} arena_t;
+
+static __thread arena_t thread_arena;
+
+static chunk_t* arena_new_chunk(size_t size) {
+    size_t bytes = sizeof(chunk_t) + (size > ARENA_CHUNK ? size : ARENA_CHUNK);
+    chunk_t* c = map_pages(bytes);
+    if (!c) {
+        return NULL;
+    }
+    c->next = NULL;
+    c->size = bytes - sizeof(chunk_t);
+    atomic_fetch_add(&footprint_bytes[0], bytes);
+    return c;
+}
+
+static void* arena_alloc(size_t size) {
+    arena_t* a = &thread_arena;
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    // Segue pelos chunks já reservados (de rodadas anteriores ao reset)
+    while (a->current && a->offset + size > a->current->size) {
+        if (!a->current->next) {
+            break;
+        }
+        a->current = a->current->next;
+        a->offset = 0;
+    }
+    if (!a->current || a->offset + size > a->current->size) {
+        chunk_t* c = arena_new_chunk(size);
+        if (!c) {
+            return NULL;
+        }
+        if (a->current) {
+            a->current->next = c;
+        } else {
+            a->first = c;
+        }
+        a->current = c;
+        a->offset = 0;
+    }
+    void* ptr = a->current->data + a->offset;
+    a->offset += size;
+    return ptr;
+}
+
+static void arena_free(void* ptr, size_t size) {
+    (void)ptr;
+    (void)size; // só o reset devolve memória
+}
+
+static void arena_reset() {
+    thread_arena.current = thread_arena.first;
+    thread_arena.offset = 0;
+}
+
+static size_t arena_usable(void* ptr, size_t size) {
+    (void)ptr;
+    return (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+static size_t arena_footprint() {
+    return atomic_load(&footprint_bytes[0]);
+}
+
+const alloc_backend_t arena_backend = {"arena", arena_alloc, arena_free, arena_reset, arena_usable, arena_footprint};
+
+/* ---- pool por classe de tamanho ---- */
+
+typedef struct {
+    pthread_mutex_t lock;
+    void* free_list;
+    char* slab;        // parte ainda não recortada do slab atual
+    size_t slab_left;
+} size_class_t;
+
+typedef struct {
+    void* head;
+    int count;
+} thread_cache_t;
+
+static size_class_t classes[POOL_CLASSES] = {
+    [0 ... POOL_CLASSES - 1] = {PTHREAD_MUTEX_INITIALIZER, NULL, NULL, 0}
+};
+static __thread thread_cache_t caches[POOL_CLASSES];
+
+static int class_of(size_t size) {
+    int shift = POOL_MIN_SHIFT;
+    while (((size_t)1 << shift) < size) {
+        shift++;
+    }
+    return shift - POOL_MIN_SHIFT;
+}
+
+static size_t class_size(int c) {
+    return (size_t)1 << (c + POOL_MIN_SHIFT);
+}
+
+// Traz até CACHE_BATCH blocos da lista global (ou de um slab novo)
+static void pool_refill(int c) {
+    size_class_t* sc = &classes[c];
+    thread_cache_t* cache = &caches[c];
+    size_t block = class_size(c);
+
+    pthread_mutex_lock(&sc->lock);
+    while (cache->count < CACHE_BATCH) {
+        void* p = sc->free_list;
+        if (p) {
+            sc->free_list = *(void**)p;
+        } else {
+            if (sc->slab_left < block) {
+                sc->slab = map_pages(POOL_SLAB);
+                if (!sc->slab) {
+                    sc->slab_left = 0;
+                    break;
+                }
+                sc->slab_left = POOL_SLAB;
+                atomic_fetch_add(&footprint_bytes[1], POOL_SLAB);
+            }
+            p = sc->slab;
+            sc->slab += block;
+            sc->slab_left -= block;
+        }
+        *(void**)p = cache->head;
+        cache->head = p;
+        cache->count++;
+    }
+    pthread_mutex_unlock(&sc->lock);
+}
+
+// Devolve CACHE_BATCH blocos do cache para a lista global
+static void pool_flush(int c) {
+    size_class_t* sc = &classes[c];
+    thread_cache_t* cache = &caches[c];
+
+    pthread_mutex_lock(&sc->lock);
+    for (int i = 0; i < CACHE_BATCH && cache->head; i++) {
+        void* p = cache->head;
+        cache->head = *(void**)p;
+        cache->count--;
+        *(void**)p = sc->free_list;
+        sc->free_list = p;
+    }
+    pthread_mutex_unlock(&sc->lock);
+}
+
+static void* pool_alloc(size_t size) {
+    if (size > class_size(POOL_CLASSES - 1)) {
+        void* p = map_pages(size);
+        if (p) atomic_fetch_add(&footprint_bytes[1], page_round(size));
+        return p;
+    }
+    int c = class_of(size);
+    thread_cache_t* cache = &caches[c];
+    if (!cache->head) {
+        pool_refill(c);
+        if (!cache->head) {
+            return NULL;
+        }
+    }
+    void* p = cache->head;
+    cache->head = *(void**)p;
+    cache->count--;
+    return p;
+}
+
+static void pool_free(void* ptr, size_t size) {
+    if (!ptr) {
+        return;
+    }
+    if (size > class_size(POOL_CLASSES - 1)) {
+        munmap(ptr, size);
+        atomic_fetch_sub(&footprint_bytes[1], page_round(size));
+        return;
+    }
+    int c = class_of(size);
+    thread_cache_t* cache = &caches[c];
+    *(void**)ptr = cache->head;
+    cache->head = ptr;
+    if (++cache->count > CACHE_MAX) {
+        pool_flush(c);
+    }
+}
+
+static size_t pool_usable(void* ptr, size_t size) {
+    (void)ptr;
+    if (size > class_size(POOL_CLASSES - 1)) {
+        return page_round(size);
+    }
+    return class_size(class_of(size));
+}
+
+static size_t pool_footprint() {
+    return atomic_load(&footprint_bytes[1]);
+}
+
+const alloc_backend_t pool_backend = {"pool", pool_alloc, pool_free, NULL, pool_usable, pool_footprint};
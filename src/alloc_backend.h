@@ -0,0 +1,41 @@
+/*
+ * Alocadores alternativos para os padrões do memory_leak
+ *
+ * Três estratégias com a mesma interface, para comparar nos mesmos
+ * padrões de alocação:
+ *
+ *   glibc  malloc/free, a referência
+ *   arena  região por thread com alocação por incremento de ponteiro
+ *          (bump); free de um bloco não faz nada e o reset devolve tudo
+ *          de uma vez em O(1), mantendo os chunks para a próxima rodada.
+ *          Com uma arena por requisição, um bloco esquecido não sobrevive
+ *          ao fim da requisição: o vazamento deixa de existir por
+ *          construção
+ *   pool   listas livres por classe de tamanho (potências de 2 de 16 B a
+ *          64 KiB) recortadas de slabs de 256 KiB, com um cache por
+ *          thread que troca lotes com a lista global sob um mutex. Acima
+ *          de 64 KiB o bloco vem direto de mmap
+ *
+ * O free recebe o tamanho pedido (sized free): nem a arena nem o pool
+ * guardam cabeçalho por bloco.
+ */
+
+#ifndef ALLOC_BACKEND_H
+#define ALLOC_BACKEND_H
+
+#include <stddef.h>
+
+typedef struct {
+    const char* name;
+    void* (*alloc)(size_t size);
+    void (*free)(void* ptr, size_t size);
+    void (*release_all)(void);                // libera tudo da thread (NULL: bloco a bloco)
+    size_t (*usable)(void* ptr, size_t size); // bytes de fato reservados para o bloco
+    size_t (*footprint)(void);                // bytes que o alocador segura do sistema
+} alloc_backend_t;
+
+extern const alloc_backend_t glibc_backend;
+extern const alloc_backend_t arena_backend;
+extern const alloc_backend_t pool_backend;
+
+#endif
@@ -0,0 +1,934 @@
+/*
+ * Rastreador de alocações via LD_PRELOAD
+ *
+ * Alternativa leve ao valgrind para observar os vazamentos de
+ * memory_leak.c. Intercepta malloc/calloc/realloc/free (e as variantes
+ * alinhadas), guarda o local de cada alocação (backtrace por frame
+ * pointer) e, na saída do processo ou ao receber SIGUSR1, imprime os
+ * blocos ainda vivos agrupados por local de alocação.
+ *
+ * Uso:
+ *   LD_PRELOAD=./bin/liballoctrack.so ./bin/memory_leak 1
+ *   kill -USR1 <pid>                  # relatório sem parar o processo
+ *
+ * Variáveis de ambiente:
+ *   ALLOCTRACK_SAMPLE=N  amostra em média uma alocação a cada N bytes
+ *                        (como o heap profiler do tcmalloc; 0 = todas)
+ *   ALLOCTRACK_TOP=N     quantos locais mostrar no relatório (padrão 20)
+ *   ALLOCTRACK_LEAKS=1   junto de cada relatório, varre a memória atrás de
+ *                        blocos inalcançáveis (ver leak_check abaixo)
+ *
+ * Nada aqui usa locks: cada thread guarda seu estado de amostragem em
+ * TLS e publica as alocações amostradas em tabelas globais de
+ * endereçamento aberto atualizadas com compare-and-swap.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <link.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <execinfo.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+// Alocador real da glibc (sem passar por dlsym, que também aloca)
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void __libc_free(void* ptr);
+extern void* __libc_memalign(size_t alignment, size_t size);
+
+#define TRACK_MAX_FRAMES 16
+#define TRACK_SKIP_FRAMES 2      // track_alloc e o malloc/calloc/realloc interceptado
+#define LIVE_TABLE_BITS 20       // até ~1M blocos vivos amostrados
+#define SITE_TABLE_BITS 16       // até 64K locais de alocação distintos
+#define MAX_PROBE 64
+
+#define SLOT_EMPTY ((uintptr_t)0)
+#define SLOT_TOMBSTONE ((uintptr_t)1)
+#define SLOT_RESERVED ((uintptr_t)2)
+
+typedef struct {
+    _Atomic uintptr_t ptr;
+    uint32_t site;
+    size_t size;
+    size_t weight;   // bytes que esta amostra representa
+} live_entry_t;
+
+typedef struct {
+    _Atomic uint64_t hash;
+    atomic_int ready;
+    int depth;
+    void* frames[TRACK_MAX_FRAMES];
+    atomic_long live_bytes;
+    atomic_long live_count;
+    atomic_long total_bytes;
+    atomic_long total_count;
+} site_entry_t;
+
+#define TLS __thread __attribute__((tls_model("initial-exec")))
+
+static TLS int in_hook = 0;
+static TLS long sample_countdown = 0;
+static TLS int sample_started = 0;
+static TLS uint64_t sample_rng = 0;
+static TLS uintptr_t stack_high = 0;
+
+static int tracker_ready = 0;
+static long sample_rate = 0;
+static int report_top = 20;
+static live_entry_t* live_table = NULL;
+static site_entry_t* site_table = NULL;
+static atomic_long dropped = 0;
+static atomic_long seen_count = 0;
+static atomic_long seen_bytes = 0;
+static int report_pipe[2] = {-1, -1};
+static int leak_mode = 0;
+
+static void* map_table(size_t bytes) {
+    void* mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return mem == MAP_FAILED ? NULL : mem;
+}
+
+static inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+/*
+ * Backtrace seguindo a cadeia de frame pointers. Os exemplos são
+ * compilados com -O0, então cada frame guarda o anterior; os limites da
+ * pilha da thread evitam seguir lixo para fora dela.
+ */
+__attribute__((noinline))
+static int capture_frames(void** frames) {
+    if (!stack_high) {
+        pthread_attr_t attr;
+        void* low;
+        size_t size;
+        if (pthread_getattr_np(pthread_self(), &attr) != 0) {
+            return 0;
+        }
+        pthread_attr_getstack(&attr, &low, &size);
+        pthread_attr_destroy(&attr);
+        stack_high = (uintptr_t)low + size;
+    }
+
+    uintptr_t* fp = (uintptr_t*)__builtin_frame_address(0);
+    int depth = 0, skip = TRACK_SKIP_FRAMES;
+
+    while (depth < TRACK_MAX_FRAMES) {
+        uintptr_t next = fp[0];
+        uintptr_t ret = fp[1];
+        if (!ret) {
+            break;
+        }
+        if (skip > 0) {
+            skip--;
+        } else {
+            frames[depth++] = (void*)ret;
+        }
+        if (next <= (uintptr_t)fp || next + 2 * sizeof(uintptr_t) > stack_high) {
+            break;
+        }
+        fp = (uintptr_t*)next;
+    }
+    return depth;
+}
+
+static uint32_t intern_site(void** frames, int depth) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < depth; i++) {
+        hash = mix64(hash ^ (uint64_t)(uintptr_t)frames[i]);
+    }
+    hash |= 1; // 0 marca entrada vazia
+
+    uint32_t mask = (1u << SITE_TABLE_BITS) - 1;
+    for (uint32_t i = 0, slot = (uint32_t)hash & mask; i < MAX_PROBE; i++, slot = (slot + 1) & mask) {
+        site_entry_t* site = &site_table[slot];
+        uint64_t current = atomic_load_explicit(&site->hash, memory_order_acquire);
+
+        if (current == hash) {
+            return slot;
+        }
+        if (current == 0) {
+            uint64_t expected = 0;
+            if (atomic_compare_exchange_strong(&site->hash, &expected, hash)) {
+                memcpy(site->frames, frames, depth * sizeof(void*));
+                site->depth = depth;
+                atomic_store_explicit(&site->ready, 1, memory_order_release);
+                return slot;
+            }
+            if (expected == hash) {
+                return slot;
+            }
+        }
+    }
+    return UINT32_MAX;
+}
+
+static void live_insert(void* ptr, uint32_t site, size_t size, size_t weight) {
+    uint32_t mask = (1u << LIVE_TABLE_BITS) - 1;
+    uint32_t slot = (uint32_t)mix64((uintptr_t)ptr) & mask;
+
+    for (int i = 0; i < MAX_PROBE; i++, slot = (slot + 1) & mask) {
+        live_entry_t* entry = &live_table[slot];
+        uintptr_t current = atomic_load_explicit(&entry->ptr, memory_order_relaxed);
+
+        if (current == SLOT_EMPTY || current == SLOT_TOMBSTONE) {
+            if (atomic_compare_exchange_strong(&entry->ptr, &current, SLOT_RESERVED)) {
+                // Reservada: preenche antes de publicar o ponteiro
+                entry->site = site;
+                entry->size = size;
+                entry->weight = weight;
+                atomic_store_explicit(&entry->ptr, (uintptr_t)ptr, memory_order_release);
+
+                site_entry_t* s = &site_table[site];
+                atomic_fetch_add_explicit(&s->live_bytes, weight, memory_order_relaxed);
+                atomic_fetch_add_explicit(&s->live_count, 1, memory_order_relaxed);
+                atomic_fetch_add_explicit(&s->total_bytes, weight, memory_order_relaxed);
+                atomic_fetch_add_explicit(&s->total_count, 1, memory_order_relaxed);
+                return;
+            }
+        }
+    }
+    atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+}
+
+static void live_remove(void* ptr) {
+    uint32_t mask = (1u << LIVE_TABLE_BITS) - 1;
+    uint32_t slot = (uint32_t)mix64((uintptr_t)ptr) & mask;
+
+    for (int i = 0; i < MAX_PROBE; i++, slot = (slot + 1) & mask) {
+        live_entry_t* entry = &live_table[slot];
+        uintptr_t current = atomic_load_explicit(&entry->ptr, memory_order_acquire);
+
+        if (current == SLOT_EMPTY) {
+            return; // não foi amostrado
+        }
+        if (current == (uintptr_t)ptr &&
+            atomic_compare_exchange_strong(&entry->ptr, &current, SLOT_TOMBSTONE)) {
+            site_entry_t* s = &site_table[entry->site];
+            atomic_fetch_sub_explicit(&s->live_bytes, entry->weight, memory_order_relaxed);
+            atomic_fetch_sub_explicit(&s->live_count, 1, memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+static inline uint64_t next_random() {
+    if (!sample_rng) {
+        sample_rng = mix64((uintptr_t)&sample_rng ^ (uint64_t)getpid());
+    }
+    sample_rng ^= sample_rng << 13;
+    sample_rng ^= sample_rng >> 7;
+    sample_rng ^= sample_rng << 17;
+    return sample_rng;
+}
+
+// Distância em bytes até o próximo ponto de amostragem: exponencial com
+// média sample_rate, então os pontos formam um processo de Poisson sobre os
+// bytes alocados, como no tcmalloc
+static inline long next_sample_interval() {
+    double u = ((next_random() >> 11) + 1) * 0x1.0p-53; // (0, 1]
+    return (long)(-(double)sample_rate * log(u)) + 1;
+}
+
+// Decide se esta alocação entra na amostra e quantos bytes ela representa
+static inline size_t sample_weight(size_t size) {
+    if (sample_rate <= 1) {
+        return size;
+    }
+    if (!sample_started) {
+        sample_started = 1;
+        sample_countdown = next_sample_interval();
+    }
+
+    sample_countdown -= (long)size;
+    if (sample_countdown > 0) {
+        return 0;
+    }
+    sample_countdown = next_sample_interval();
+
+    // Um bloco de s bytes entra na amostra com probabilidade 1 - e^(-s/N);
+    // dividir por ela deixa a estimativa sem viés para qualquer tamanho
+    double probability = -expm1(-(double)size / (double)sample_rate);
+    return (size_t)((double)size / probability + 0.5);
+}
+
+__attribute__((noinline))
+static void track_alloc(void* ptr, size_t size) {
+    if (!ptr || !tracker_ready || in_hook) {
+        return;
+    }
+
+    in_hook = 1;
+    atomic_fetch_add_explicit(&seen_count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&seen_bytes, size, memory_order_relaxed);
+
+    size_t weight = sample_weight(size);
+    if (weight) {
+        void* frames[TRACK_MAX_FRAMES];
+        int depth = capture_frames(frames);
+        uint32_t site = intern_site(frames, depth);
+        if (site != UINT32_MAX) {
+            live_insert(ptr, site, size, weight);
+        } else {
+            atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+        }
+    }
+    in_hook = 0;
+}
+
+static void track_free(void* ptr) {
+    if (ptr && tracker_ready && !in_hook) {
+        live_remove(ptr);
+    }
+}
+
+void* malloc(size_t size) {
+    void* ptr = __libc_malloc(size);
+    track_alloc(ptr, size);
+    return ptr;
+}
+
+void* calloc(size_t count, size_t size) {
+    void* ptr = __libc_calloc(count, size);
+    track_alloc(ptr, count * size);
+    return ptr;
+}
+
+void* realloc(void* old, size_t size) {
+    void* ptr = __libc_realloc(old, size);
+    // Se falhar, old continua vivo e rastreado; com size 0 a glibc o libera
+    if (ptr || size == 0) {
+        track_free(old);
+        track_alloc(ptr, size);
+    }
+    return ptr;
+}
+
+void free(void* ptr) {
+    track_free(ptr);
+    __libc_free(ptr);
+}
+
+// Alinhadas: sem elas, blocos guardados só por estes (os anéis do evlog,
+// por exemplo) pareceriam perdidos na varredura
+void* memalign(size_t alignment, size_t size) {
+    void* ptr = __libc_memalign(alignment, size);
+    track_alloc(ptr, size);
+    return ptr;
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    void* ptr = __libc_memalign(alignment, size);
+    track_alloc(ptr, size);
+    return ptr;
+}
+
+int posix_memalign(void** out, size_t alignment, size_t size) {
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1))) {
+        return EINVAL;
+    }
+    void* ptr = __libc_memalign(alignment, size);
+    if (!ptr) {
+        return ENOMEM;
+    }
+    track_alloc(ptr, size);
+    *out = ptr;
+    return 0;
+}
+
+static void print_report(const char* reason) {
+    FILE* out = stderr;
+    long live_bytes = 0, live_count = 0;
+    int site_count = 1 << SITE_TABLE_BITS;
+
+    for (int i = 0; i < site_count; i++) {
+        if (atomic_load(&site_table[i].ready)) {
+            live_bytes += atomic_load(&site_table[i].live_bytes);
+            live_count += atomic_load(&site_table[i].live_count);
+        }
+    }
+
+    fprintf(out, "\n=== ALLOCTRACK: RELATÓRIO DE VAZAMENTOS (%s, pid %d) ===\n", reason, getpid());
+    fprintf(out, "Amostragem: %s", sample_rate > 1 ? "" : "todas as alocações\n");
+    if (sample_rate > 1) {
+        fprintf(out, "1 a cada %ld bytes (valores abaixo são estimativas)\n", sample_rate);
+    }
+    fprintf(out, "Alocações vistas: %ld (%ld bytes)\n", atomic_load(&seen_count), atomic_load(&seen_bytes));
+    fprintf(out, "Ainda vivos: %ld blocos amostrados, ~%ld bytes\n", live_count, live_bytes);
+    if (atomic_load(&dropped)) {
+        fprintf(out, "Aviso: %ld amostras descartadas (tabelas cheias)\n", atomic_load(&dropped));
+    }
+
+    // Seleciona os maiores locais por bytes vivos sem alocar memória
+    static char printed[1 << SITE_TABLE_BITS];
+    memset(printed, 0, sizeof(printed));
+
+    for (int rank = 1; rank <= report_top; rank++) {
+        int best = -1;
+        long best_bytes = 0;
+        for (int i = 0; i < site_count; i++) {
+            long bytes = atomic_load(&site_table[i].live_bytes);
+            if (!printed[i] && atomic_load(&site_table[i].ready) && bytes > best_bytes) {
+                best = i;
+                best_bytes = bytes;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        printed[best] = 1;
+
+        site_entry_t* site = &site_table[best];
+        fprintf(out, "\n#%d  %ld bytes em %ld blocos vivos (%ld alocações neste local)\n",
+                rank, best_bytes, atomic_load(&site->live_count), atomic_load(&site->total_count));
+        fflush(out);
+        backtrace_symbols_fd(site->frames, site->depth, fileno(out));
+    }
+    fprintf(out, "\n");
+    fflush(out);
+}
+
+/*
+ * Varredura de alcançabilidade (no estilo do LeakSanitizer)
+ *
+ * Para o mundo: cada outra thread recebe STOP_SIGNAL e fica presa no
+ * tratador, cujo frame está logo abaixo do contexto salvo pelo kernel
+ * (registradores) e do resto da pilha. Com tudo parado, parte das raízes
+ * (segmentos graváveis dos módulos carregados, TLS estático da thread
+ * principal e pilhas das threads, da posição atual até o topo do
+ * mapeamento; o TLS das outras threads fica no topo da própria pilha) e
+ * marca, de forma
+ * conservadora, todo bloco da tabela de vivos para o qual alguma palavra
+ * aponte (no início ou no meio). Os blocos marcados são varridos do mesmo
+ * jeito até a lista de trabalho esvaziar. O que sobra está perdido: se só
+ * outro bloco perdido aponta para ele, a perda é indireta. Se alguma
+ * thread não para a tempo, a pilha dela fica sem varrer e qualquer bloco
+ * pode parecer perdido: a varredura é dada como inconclusiva.
+ *
+ * Enquanto o mundo está parado nada aqui usa malloc nem stdio (uma thread
+ * parada pode estar segurando os locks deles): os vetores de trabalho são
+ * mmap e a impressão só acontece depois de soltar as threads.
+ */
+
+#define STOP_SIGNAL (SIGRTMIN + 5)
+#define MAX_STOPPED 1024
+#define MAX_RANGES (1 << 17)
+#define MAX_GLOBALS 256
+#define STOP_TIMEOUT_NS 1000000000L
+
+#define BLOCK_REACHABLE 1
+#define BLOCK_INDIRECT 2
+
+typedef struct {
+    uintptr_t start;
+    uintptr_t end;
+} range_t;
+
+typedef struct {
+    uintptr_t start;
+    size_t size;
+    uint32_t site;
+    int flags;
+} block_t;
+
+typedef struct {
+    pid_t tid;
+    uintptr_t sp;
+    atomic_int stopped;
+} stopped_thread_t;
+
+static stopped_thread_t stopped_threads[MAX_STOPPED];
+static int stopped_count = 0;
+static atomic_long stop_generation = 0;
+static atomic_long resume_generation = 0;
+
+static range_t* maps = NULL;
+static long map_count = 0;
+static range_t globals[MAX_GLOBALS];
+static int global_count = 0;
+static range_t main_tls = {0, 0};   // TLS estático da thread principal (fora da pilha dela)
+static block_t* blocks = NULL;
+static long block_count = 0;
+static long* worklist = NULL;
+static long* site_lost_bytes = NULL;
+static long* site_lost_count = NULL;
+static long* site_indirect_bytes = NULL;
+static size_t scanned_bytes = 0;
+
+static long elapsed_ns(const struct timespec* a, const struct timespec* b) {
+    return (b->tv_sec - a->tv_sec) * 1000000000L + (b->tv_nsec - a->tv_nsec);
+}
+
+static void stop_handler(int sig) {
+    (void)sig;
+    int saved_errno = errno;
+    long generation = atomic_load(&stop_generation);
+    pid_t tid = (pid_t)syscall(SYS_gettid);
+
+    for (int i = 0; i < stopped_count; i++) {
+        if (stopped_threads[i].tid == tid) {
+            // Daqui até o topo da pilha estão o contexto salvo e os frames da thread
+            stopped_threads[i].sp = (uintptr_t)__builtin_frame_address(0);
+            atomic_store(&stopped_threads[i].stopped, 1);
+            break;
+        }
+    }
+    struct timespec pause = {0, 100000};
+    while (atomic_load(&resume_generation) < generation) {
+        nanosleep(&pause, NULL);
+    }
+    errno = saved_errno;
+}
+
+// Mapeamentos do processo, para achar os limites das pilhas
+static void read_maps() {
+    map_count = 0;
+    int fd = open("/proc/self/maps", O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    char buf[4096];
+    char line[512];
+    int len = 0;
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        for (ssize_t i = 0; i < n; i++) {
+            if (buf[i] != '\n') {
+                if (len < (int)sizeof(line) - 1) line[len++] = buf[i];
+                continue;
+            }
+            line[len] = 0;
+            len = 0;
+            unsigned long start, end;
+            if (map_count < MAX_RANGES && sscanf(line, "%lx-%lx", &start, &end) == 2) {
+                maps[map_count].start = start;
+                maps[map_count].end = end;
+                map_count++;
+            }
+        }
+    }
+    close(fd);
+}
+
+static uintptr_t mapping_end(uintptr_t addr) {
+    for (long i = 0; i < map_count; i++) {
+        if (addr >= maps[i].start && addr < maps[i].end) return maps[i].end;
+    }
+    return 0;
+}
+
+static int collect_globals(struct dl_phdr_info* info, size_t size, void* arg) {
+    (void)size;
+    (void)arg;
+    for (int i = 0; i < info->dlpi_phnum; i++) {
+        const ElfW(Phdr)* ph = &info->dlpi_phdr[i];
+        if (ph->p_type != PT_LOAD || !(ph->p_flags & PF_W) || global_count >= MAX_GLOBALS) {
+            continue;
+        }
+        uintptr_t start = info->dlpi_addr + ph->p_vaddr;
+        uintptr_t end = start + ph->p_memsz;
+        // Os globais do próprio rastreador só apontam para as tabelas dele
+        if ((uintptr_t)&leak_mode >= start && (uintptr_t)&leak_mode < end) {
+            continue;
+        }
+        globals[global_count].start = start;
+        globals[global_count].end = end;
+        global_count++;
+    }
+    return 0;
+}
+
+// Chamada da thread principal: dlpi_tls_data é o bloco dela para o módulo
+static int collect_main_tls(struct dl_phdr_info* info, size_t size, void* arg) {
+    (void)size;
+    (void)arg;
+    for (int i = 0; i < info->dlpi_phnum; i++) {
+        const ElfW(Phdr)* ph = &info->dlpi_phdr[i];
+        if (ph->p_type != PT_TLS || !info->dlpi_tls_data) {
+            continue;
+        }
+        // Os blocos dos módulos iniciais ficam lado a lado: um intervalo só
+        uintptr_t start = (uintptr_t)info->dlpi_tls_data;
+        uintptr_t end = start + ph->p_memsz;
+        if (!main_tls.start || start < main_tls.start) main_tls.start = start;
+        if (end > main_tls.end) main_tls.end = end;
+    }
+    return 0;
+}
+
+static void sift_down(long root, long count) {
+    while (2 * root + 1 < count) {
+        long child = 2 * root + 1;
+        if (child + 1 < count && blocks[child + 1].start > blocks[child].start) child++;
+        if (blocks[root].start >= blocks[child].start) return;
+        block_t tmp = blocks[root];
+        blocks[root] = blocks[child];
+        blocks[child] = tmp;
+        root = child;
+    }
+}
+
+// Heapsort por endereço: o qsort da glibc pode chamar malloc
+static void sort_blocks() {
+    for (long i = block_count / 2 - 1; i >= 0; i--) {
+        sift_down(i, block_count);
+    }
+    for (long end = block_count - 1; end > 0; end--) {
+        block_t tmp = blocks[0];
+        blocks[0] = blocks[end];
+        blocks[end] = tmp;
+        sift_down(0, end);
+    }
+}
+
+static long find_block(uintptr_t value) {
+    long lo = 0, hi = block_count - 1;
+    while (lo <= hi) {
+        long mid = (lo + hi) / 2;
+        if (value < blocks[mid].start) {
+            hi = mid - 1;
+        } else if (value >= blocks[mid].start + (blocks[mid].size ? blocks[mid].size : 1)) {
+            lo = mid + 1;
+        } else {
+            return mid;
+        }
+    }
+    return -1;
+}
+
+// Marca com 'flag' os blocos apontados por palavras de [start, end)
+static long scan_range(uintptr_t start, uintptr_t end, int flag, long self, long top) {
+    start = (start + sizeof(uintptr_t) - 1) & ~(uintptr_t)(sizeof(uintptr_t) - 1);
+    if (end > start) {
+        scanned_bytes += end - start;
+    }
+    for (uintptr_t p = start; p + sizeof(uintptr_t) <= end; p += sizeof(uintptr_t)) {
+        uintptr_t value = *(const uintptr_t*)p;
+        if (value < blocks[0].start) continue;
+        long i = find_block(value);
+        if (i >= 0 && i != self && !blocks[i].flags) {
+            blocks[i].flags = flag;
+            worklist[top++] = i;
+        }
+    }
+    return top;
+}
+
+static void drain(long top, int flag) {
+    while (top > 0) {
+        long i = worklist[--top];
+        top = scan_range(blocks[i].start, blocks[i].start + blocks[i].size, flag, i, top);
+    }
+}
+
+static int stop_the_world(pid_t self) {
+    stopped_count = 0;
+    atomic_fetch_add(&stop_generation, 1);
+
+    DIR* dir = opendir("/proc/self/task");
+    if (!dir) {
+        return -1;
+    }
+    struct dirent* entry;
+    int left_out = 0; // além de MAX_STOPPED: não param e contam como pendentes
+    while ((entry = readdir(dir))) {
+        pid_t tid = atoi(entry->d_name);
+        if (tid <= 0 || tid == self) continue;
+        if (stopped_count == MAX_STOPPED) {
+            left_out++;
+            continue;
+        }
+        stopped_threads[stopped_count].tid = tid;
+        stopped_threads[stopped_count].sp = 0;
+        atomic_store(&stopped_threads[stopped_count].stopped, 0);
+        stopped_count++;
+    }
+    closedir(dir);
+
+    pid_t pid = getpid();
+    for (int i = 0; i < stopped_count; i++) {
+        if (syscall(SYS_tgkill, pid, stopped_threads[i].tid, STOP_SIGNAL) != 0) {
+            stopped_threads[i].tid = 0; // já terminou
+        }
+    }
+
+    // Espera todas pararem; devolve quantas não pararam a tempo
+    struct timespec start, now, pause = {0, 50000};
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (;;) {
+        int pending = 0;
+        for (int i = 0; i < stopped_count; i++) {
+            if (stopped_threads[i].tid && !atomic_load(&stopped_threads[i].stopped)) pending++;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (!pending || elapsed_ns(&start, &now) > STOP_TIMEOUT_NS) {
+            return pending + left_out;
+        }
+        nanosleep(&pause, NULL);
+    }
+}
+
+static void resume_the_world() {
+    atomic_store(&resume_generation, atomic_load(&stop_generation));
+}
+
+static void leak_check(const char* reason, int include_self) {
+    if (!blocks) {
+        return;
+    }
+    FILE* out = stderr;
+    pid_t self = (pid_t)syscall(SYS_gettid);
+    struct timespec t0, t1, t2;
+
+    // Tudo que pode alocar ou pegar locks vem antes de parar o mundo
+    global_count = 0;
+    dl_iterate_phdr(collect_globals, NULL);
+    read_maps();
+    memset(site_lost_bytes, 0, sizeof(long) << SITE_TABLE_BITS);
+    memset(site_lost_count, 0, sizeof(long) << SITE_TABLE_BITS);
+    memset(site_indirect_bytes, 0, sizeof(long) << SITE_TABLE_BITS);
+    fflush(out);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int missing = stop_the_world(self);
+    if (missing != 0) {
+        // Sem as pilhas de todas as threads a lista de perdidos não vale nada
+        resume_the_world();
+        fprintf(out, "\n=== ALLOCTRACK: BLOCOS INALCANÇÁVEIS (%s, pid %d) ===\n", reason, getpid());
+        if (missing < 0) {
+            fprintf(out, "Varredura inconclusiva: não foi possível listar as threads em /proc/self/task\n\n");
+        } else {
+            fprintf(out, "Varredura inconclusiva: %d threads não pararam em %ld ms (sinal bloqueado ou\n"
+                         "presas no kernel) e suas pilhas não seriam varridas; nenhum bloco listado\n\n",
+                    missing, STOP_TIMEOUT_NS / 1000000);
+        }
+        fflush(out);
+        return;
+    }
+
+    // Retrato da tabela de vivos, ordenado por endereço
+    block_count = 0;
+    size_t heap_bytes = 0;
+    for (uint32_t i = 0; i < (1u << LIVE_TABLE_BITS); i++) {
+        uintptr_t ptr = atomic_load_explicit(&live_table[i].ptr, memory_order_acquire);
+        if (ptr > SLOT_RESERVED) {
+            blocks[block_count].start = ptr;
+            blocks[block_count].size = live_table[i].size;
+            blocks[block_count].site = live_table[i].site;
+            blocks[block_count].flags = 0;
+            heap_bytes += live_table[i].size;
+            block_count++;
+        }
+    }
+    sort_blocks();
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    scanned_bytes = 0;
+    int threads_scanned = 0;
+    if (block_count > 0) {
+        long top = 0;
+        for (int i = 0; i < global_count; i++) {
+            top = scan_range(globals[i].start, globals[i].end, BLOCK_REACHABLE, -1, top);
+        }
+        if (main_tls.start && mapping_end(main_tls.start)) {
+            top = scan_range(main_tls.start, main_tls.end, BLOCK_REACHABLE, -1, top);
+        }
+        for (int i = 0; i < stopped_count; i++) {
+            if (!stopped_threads[i].tid || !atomic_load(&stopped_threads[i].stopped)) continue;
+            uintptr_t sp = stopped_threads[i].sp;
+            top = scan_range(sp, mapping_end(sp), BLOCK_REACHABLE, -1, top);
+            threads_scanned++;
+        }
+        if (include_self) {
+            uintptr_t sp = (uintptr_t)__builtin_frame_address(0);
+            top = scan_range(sp, mapping_end(sp), BLOCK_REACHABLE, -1, top);
+            threads_scanned++;
+        }
+        drain(top, BLOCK_REACHABLE);
+
+        // Perdidos apontados só por outros perdidos são indiretos
+        for (long i = 0; i < block_count; i++) {
+            if (!blocks[i].flags) {
+                drain(scan_range(blocks[i].start, blocks[i].start + blocks[i].size, BLOCK_INDIRECT, i, 0),
+                      BLOCK_INDIRECT);
+            }
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    resume_the_world();
+
+    long lost_count = 0, lost_bytes = 0, indirect_count = 0, indirect_bytes = 0, reachable_bytes = 0;
+    for (long i = 0; i < block_count; i++) {
+        block_t* b = &blocks[i];
+        if (b->flags == BLOCK_REACHABLE) {
+            reachable_bytes += b->size;
+        } else if (b->flags == BLOCK_INDIRECT) {
+            indirect_count++;
+            indirect_bytes += b->size;
+            site_indirect_bytes[b->site] += b->size;
+        } else {
+            lost_count++;
+            lost_bytes += b->size;
+            site_lost_bytes[b->site] += b->size;
+            site_lost_count[b->site]++;
+        }
+    }
+
+    fprintf(out, "\n=== ALLOCTRACK: BLOCOS INALCANÇÁVEIS (%s, pid %d) ===\n", reason, getpid());
+    if (sample_rate > 1) {
+        fprintf(out, "Aviso: com ALLOCTRACK_SAMPLE os blocos fora da amostra não são varridos;\n"
+                     "ponteiros guardados neles não contam e pode haver falsos perdidos\n");
+    }
+    fprintf(out, "Perdidos: %ld bytes em %ld blocos diretos, %ld bytes em %ld blocos indiretos\n",
+            lost_bytes, lost_count, indirect_bytes, indirect_count);
+    fprintf(out, "Ainda alcançáveis: %ld bytes em %ld blocos\n",
+            reachable_bytes, block_count - lost_count - indirect_count);
+
+    static char printed[1 << SITE_TABLE_BITS];
+    memset(printed, 0, sizeof(printed));
+    for (int rank = 1; rank <= report_top; rank++) {
+        int best = -1;
+        for (int i = 0; i < (1 << SITE_TABLE_BITS); i++) {
+            if (!printed[i] && site_lost_bytes[i] > 0 && (best < 0 || site_lost_bytes[i] > site_lost_bytes[best])) {
+                best = i;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        printed[best] = 1;
+        fprintf(out, "\n#%d  %ld bytes perdidos em %ld blocos", rank, site_lost_bytes[best], site_lost_count[best]);
+        if (site_indirect_bytes[best]) {
+            fprintf(out, " (+ %ld bytes indiretos)", site_indirect_bytes[best]);
+        }
+        fprintf(out, "\n");
+        fflush(out);
+        backtrace_symbols_fd(site_table[best].frames, site_table[best].depth, fileno(out));
+    }
+
+    double stopped_ms = elapsed_ns(&t0, &t2) / 1e6;
+    double scan_ms = elapsed_ns(&t1, &t2) / 1e6;
+    fprintf(out, "\nVarredura: %.2f ms com o mundo parado (%d threads varridas), %.2f ms marcando;\n",
+            stopped_ms, threads_scanned, scan_ms);
+    fprintf(out, "heap de %ld blocos / %.1f KiB, %.1f KiB lidos (%.0f MiB/s)\n\n",
+            block_count, heap_bytes / 1024.0, scanned_bytes / 1024.0,
+            scan_ms > 0 ? scanned_bytes / 1048576.0 / (scan_ms / 1000) : 0);
+    fflush(out);
+}
+
+static void sigusr1_handler(int sig) {
+    (void)sig;
+    char byte = 1;
+    // Só acorda a thread de relatório: o handler fica async-signal-safe
+    if (write(report_pipe[1], &byte, 1) < 0) {
+        return;
+    }
+}
+
+static void* report_thread(void* arg) {
+    (void)arg;
+    in_hook = 1; // memória usada pelo próprio relatório não é rastreada
+
+    char byte;
+    while (read(report_pipe[0], &byte, 1) > 0) {
+        print_report("SIGUSR1");
+        if (leak_mode) {
+            leak_check("SIGUSR1", 0);
+        }
+    }
+    return NULL;
+}
+
+__attribute__((constructor))
+static void tracker_init() {
+    in_hook = 1;
+
+    const char* env = getenv("ALLOCTRACK_SAMPLE");
+    sample_rate = env ? atol(env) : 0;
+    env = getenv("ALLOCTRACK_TOP");
+    if (env && atoi(env) > 0) {
+        report_top = atoi(env);
+    }
+    env = getenv("ALLOCTRACK_LEAKS");
+    leak_mode = env && strcmp(env, "1") == 0;
+
+    live_table = map_table(sizeof(live_entry_t) << LIVE_TABLE_BITS);
+    site_table = map_table(sizeof(site_entry_t) << SITE_TABLE_BITS);
+    if (!live_table || !site_table) {
+        fprintf(stderr, "alloctrack: falha ao reservar tabelas, rastreamento desligado\n");
+        in_hook = 0;
+        return;
+    }
+
+    if (leak_mode) {
+        maps = map_table(sizeof(range_t) * MAX_RANGES);
+        blocks = map_table(sizeof(block_t) << LIVE_TABLE_BITS);
+        worklist = map_table(sizeof(long) << LIVE_TABLE_BITS);
+        site_lost_bytes = map_table(sizeof(long) << SITE_TABLE_BITS);
+        site_lost_count = map_table(sizeof(long) << SITE_TABLE_BITS);
+        site_indirect_bytes = map_table(sizeof(long) << SITE_TABLE_BITS);
+        if (!maps || !blocks || !worklist || !site_lost_bytes || !site_lost_count || !site_indirect_bytes) {
+            fprintf(stderr, "alloctrack: falha ao reservar vetores da varredura, ALLOCTRACK_LEAKS desligado\n");
+            blocks = NULL;
+        } else {
+            struct sigaction sa;
+            memset(&sa, 0, sizeof(sa));
+            sa.sa_handler = stop_handler;
+            sa.sa_flags = SA_RESTART;
+            sigfillset(&sa.sa_mask);
+            sigaction(STOP_SIGNAL, &sa, NULL);
+            dl_iterate_phdr(collect_main_tls, NULL); // o construtor roda na thread principal
+        }
+    }
+
+    // Força o carregamento do unwinder da libc antes de qualquer sinal
+    void* warmup[1];
+    backtrace(warmup, 1);
+
+    if (pipe(report_pipe) == 0) {
+        pthread_t thread;
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = sigusr1_handler;
+        sa.sa_flags = SA_RESTART;
+        sigaction(SIGUSR1, &sa, NULL);
+
+        if (pthread_create(&thread, NULL, report_thread, NULL) == 0) {
+            pthread_detach(thread);
+        }
+    }
+
+    tracker_ready = 1;
+    in_hook = 0;
+}
+
+__attribute__((destructor))
+static void tracker_fini() {
+    if (tracker_ready) {
+        in_hook = 1;
+        print_report("saída do processo");
+        if (leak_mode) {
+            leak_check("saída do processo", 1);
+        }
+        tracker_ready = 0;
+    }
+}
@@ -8,6 +8,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "perf_counters.h"
+#include "guard_alloc.h"
 
 void stack_buffer_overflow() {
     printf("Testando buffer overflow no stack...\n");
@@ -37,6 +42,137 @@ void heap_buffer_overflow() {
     free(buffer);
 }
 
+/* ---- custo do alocador com guarda ---- */
+
+#define BENCH_RING 64
+#define BENCH_LIVE 5000
+
+// (malloc)/(free) entre parênteses não passam pela macro de GUARD_ALLOC
+static void* glibc_alloc(size_t size) { return (malloc)(size); }
+static void glibc_release(void* ptr) { (free)(ptr); }
+
+typedef struct {
+    const char* name;
+    void* (*alloc)(size_t);
+    void (*release)(void*);
+    long sample;  // 0: glibc pura
+    long pool;
+} allocator_config_t;
+
+static double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long resident_kib() {
+    long size = 0, resident = 0;
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (f) {
+        if (fscanf(f, "%ld %ld", &size, &resident) != 2) resident = 0;
+        fclose(f);
+    }
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static long mapping_count() {
+    long lines = 0;
+    int c;
+    FILE* f = fopen("/proc/self/maps", "r");
+    if (f) {
+        while ((c = fgetc(f)) != EOF) {
+            if (c == '\n') lines++;
+        }
+        fclose(f);
+    }
+    return lines;
+}
+
+// Tamanhos entre 8 bytes e 4 KiB, sempre a mesma sequência
+static size_t bench_size(unsigned int* seed) {
+    *seed = *seed * 1103515245 + 12345;
+    return 8 + (*seed >> 8) % 4089;
+}
+
+void allocator_overhead(long operations, long sample) {
+    if (operations < BENCH_RING) operations = BENCH_RING;
+    if (sample < 1) sample = 1;
+    printf("Comparando o alocador com guarda com o malloc da glibc...\n");
+    printf("%ld operações (free + malloc num anel de %d blocos) e %d blocos vivos\n\n",
+           operations, BENCH_RING, BENCH_LIVE);
+
+    char sampled_name[48];
+    snprintf(sampled_name, sizeof(sampled_name), "guarda 1/%ld + pool", sample);
+    allocator_config_t configs[] = {
+        {"glibc malloc", glibc_alloc, glibc_release, 0, 0},
+        {"guarda sem pool", guard_malloc, guard_free, 1, 0},
+        {"guarda + pool", guard_malloc, guard_free, 1, 1024},
+        {sampled_name, guard_malloc, guard_free, sample, 1024},
+    };
+    int count = sizeof(configs) / sizeof(configs[0]);
+    double base_ns = 0;
+    void** live = (malloc)(BENCH_LIVE * sizeof(void*));
+    if (!live) {
+        printf("Erro ao alocar memória\n");
+        return;
+    }
+
+    printf("%-22s %10s %8s %10s %12s %10s %10s\n",
+           "alocador", "ns/op", "x glibc", "mmaps", "pool hits", "RSS(KiB)", "mapeam.");
+    for (int c = 0; c < count; c++) {
+        allocator_config_t* cfg = &configs[c];
+        if (cfg->sample) {
+            guard_alloc_configure(cfg->sample, 0); // esvazia o pool da rodada anterior
+            guard_alloc_configure(cfg->sample, cfg->pool);
+        }
+        guard_alloc_stats_t before, after;
+        guard_alloc_stats(&before);
+        unsigned int seed = 42;
+
+        // Rotatividade: cada operação libera o bloco mais velho do anel
+        void* ring[BENCH_RING] = {NULL};
+        double start = now_seconds();
+        for (long i = 0; i < operations; i++) {
+            int slot = i % BENCH_RING;
+            cfg->release(ring[slot]);
+            size_t size = bench_size(&seed);
+            char* p = cfg->alloc(size);
+            p[0] = 1;
+            p[size - 1] = 1;
+            ring[slot] = p;
+        }
+        double elapsed = now_seconds() - start;
+        for (int i = 0; i < BENCH_RING; i++) {
+            cfg->release(ring[i]);
+        }
+
+        // Memória: muitos blocos vivos ao mesmo tempo
+        long rss = resident_kib();
+        long maps = mapping_count();
+        for (int i = 0; i < BENCH_LIVE; i++) {
+            size_t size = bench_size(&seed);
+            live[i] = cfg->alloc(size);
+            memset(live[i], 1, size);
+        }
+        rss = resident_kib() - rss;
+        maps = mapping_count() - maps;
+        for (int i = 0; i < BENCH_LIVE; i++) {
+            cfg->release(live[i]);
+        }
+        guard_alloc_stats(&after);
+
+        double ns = elapsed * 1e9 / operations;
+        if (c == 0) base_ns = ns;
+        printf("%-22s %10.1f %7.1fx %10ld %12ld %10ld %10ld\n",
+               cfg->name, ns, base_ns > 0 ? ns / base_ns : 0, after.mmaps - before.mmaps,
+               after.pool_hits - before.pool_hits, rss, maps);
+    }
+    (free)(live);
+    printf("\nmmaps e pool hits contam só blocos guardados; RSS e mapeamentos são o\n");
+    printf("acréscimo com os %d blocos vivos (cada bloco guardado custa pelo menos\n", BENCH_LIVE);
+    printf("uma página de dados e divide o mapeamento em dois com a guarda)\n");
+}
+
 void format_string_vulnerability() {
     printf("Testando vulnerabilidade de format string...\n");
     
@@ -50,6 +186,7 @@ void format_string_vulnerability() {
 
 int main(int argc, char *argv[]) {
     printf("=== DEMONSTRAÇÃO: BUFFER OVERFLOW ===\n");
+    perf_counters_init();
     
     int option = 1;
     if (argc > 1) {
@@ -66,8 +203,11 @@ int main(int argc, char *argv[]) {
         case 3:
             format_string_vulnerability();
             break;
+        case 4:
+            allocator_overhead(argc > 2 ? atol(argv[2]) : 200000, argc > 3 ? atol(argv[3]) : 100);
+            break;
         default:
-            printf("Opções: 1=stack overflow, 2=heap overflow, 3=format string\n");
+            printf("Opções: 1=stack overflow, 2=heap overflow, 3=format string, 4=custo do alocador com guarda\n");
             stack_buffer_overflow();
     }
     
@@ -0,0 +1,333 @@
+/*
+ * Escalonador cooperativo determinístico - implementação
+ *
+ * A vez de rodar é um token: 'current' diz qual thread pode seguir e cada
+ * thread dorme na sua própria variável de condição até ser escolhida.
+ * Todas as decisões são tomadas sob o mesmo mutex, pela thread que está
+ * com o token, então a ordem das decisões só depende da política.
+ */
+
+#include "coop_sched.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#define SCHEDULE_MAGIC "COOPSCH1"
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t turn[COOP_MAX_THREADS];
+static int turn_ready = 0;
+
+static int active = 0;
+static coop_policy_t policy;
+static int thread_count;
+static int finished[COOP_MAX_THREADS];
+static int alive;
+static int current;
+static unsigned int seed;
+static long step;
+static int diverged;
+
+// PCT: prioridade de cada thread e passos em que a da vez é rebaixada
+static int priority[COOP_MAX_THREADS];
+static long change_points[8];
+static int change_count;
+
+// Gravação (trecho atual ainda não codificado) e leitura do replay
+static coop_schedule_t recording;
+static int run_thread = -1;
+static unsigned long run_length = 0;
+static const coop_schedule_t* replay_input;
+static size_t replay_pos;
+static int replay_thread = -1;
+static unsigned long replay_left = 0;
+
+static __thread int self = -1;
+
+/* ---- codificação ---- */
+
+static void put_byte(coop_schedule_t* s, unsigned char byte) {
+    if (s->size == s->capacity) {
+        s->capacity = s->capacity ? s->capacity * 2 : 256;
+        s->data = realloc(s->data, s->capacity);
+        if (!s->data) {
+            perror("coop_sched: realloc");
+            exit(1);
+        }
+    }
+    s->data[s->size++] = byte;
+}
+
+static void put_varint(coop_schedule_t* s, unsigned long value) {
+    while (value >= 0x80) {
+        put_byte(s, (unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    put_byte(s, (unsigned char)value);
+}
+
+static int get_varint(const coop_schedule_t* s, size_t* pos, unsigned long* value) {
+    *value = 0;
+    for (int shift = 0; *pos < s->size && shift < 64; shift += 7) {
+        unsigned char byte = s->data[(*pos)++];
+        *value |= (unsigned long)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static void flush_run() {
+    if (run_length) {
+        put_varint(&recording, run_thread);
+        put_varint(&recording, run_length);
+    }
+    run_length = 0;
+}
+
+static void record(int id) {
+    if (id != run_thread) {
+        flush_run();
+        run_thread = id;
+    }
+    run_length++;
+}
+
+/* ---- políticas ---- */
+
+static int first_alive() {
+    for (int i = 0; i < thread_count; i++) {
+        if (!finished[i]) return i;
+    }
+    return -1;
+}
+
+static int choose() {
+    switch (policy) {
+        case COOP_RANDOM: {
+            int k = rand_r(&seed) % alive;
+            for (int i = 0; i < thread_count; i++) {
+                if (!finished[i] && k-- == 0) return i;
+            }
+            break;
+        }
+        case COOP_PCT: {
+            // No passo de mudança i, quem está rodando cai para a prioridade i
+            for (int i = 0; i < change_count; i++) {
+                if (change_points[i] == step && self >= 0) {
+                    priority[self] = i;
+                }
+            }
+            int best = -1;
+            for (int i = 0; i < thread_count; i++) {
+                if (!finished[i] && (best < 0 || priority[i] > priority[best])) best = i;
+            }
+            return best;
+        }
+        case COOP_REPLAY:
+            if (replay_left == 0) {
+                unsigned long id, count;
+                if (get_varint(replay_input, &replay_pos, &id) < 0 ||
+                    get_varint(replay_input, &replay_pos, &count) < 0 || count == 0 ||
+                    id >= (unsigned long)thread_count) {
+                    diverged = 1;
+                    return first_alive();
+                }
+                replay_thread = (int)id;
+                replay_left = count;
+            }
+            replay_left--;
+            if (replay_thread >= thread_count || finished[replay_thread]) {
+                diverged = 1;
+                return first_alive();
+            }
+            return replay_thread;
+    }
+    return first_alive();
+}
+
+// Escolhe a próxima thread e passa o token; chamado com o lock
+static void schedule_next() {
+    if (alive == 0) {
+        return; // todas terminaram
+    }
+    step++;
+    int next = choose();
+    record(next);
+    current = next;
+    pthread_cond_signal(&turn[next]);
+}
+
+static void wait_turn() {
+    while (current != self) {
+        pthread_cond_wait(&turn[self], &lock);
+    }
+}
+
+/* ---- API ---- */
+
+void coop_begin(coop_policy_t p, int threads, unsigned int s, long steps, int depth,
+                const coop_schedule_t* replay) {
+    pthread_mutex_lock(&lock);
+    if (!turn_ready) {
+        for (int i = 0; i < COOP_MAX_THREADS; i++) {
+            pthread_cond_init(&turn[i], NULL);
+        }
+        turn_ready = 1;
+    }
+
+    policy = p;
+    thread_count = threads < COOP_MAX_THREADS ? threads : COOP_MAX_THREADS;
+    alive = thread_count;
+    seed = s;
+    step = 0;
+    diverged = 0;
+    memset(finished, 0, sizeof(finished));
+    recording.size = 0;
+    run_thread = -1;
+    run_length = 0;
+    replay_input = replay;
+    replay_pos = 0;
+    replay_left = 0;
+
+    if (policy == COOP_PCT) {
+        // Prioridades iniciais depth..depth+n-1 numa permutação aleatória
+        // (abaixo delas ficam as prioridades dos pontos de mudança)
+        for (int i = 0; i < thread_count; i++) {
+            priority[i] = depth + i;
+        }
+        for (int i = thread_count - 1; i > 0; i--) {
+            int j = rand_r(&seed) % (i + 1);
+            int tmp = priority[i];
+            priority[i] = priority[j];
+            priority[j] = tmp;
+        }
+        change_count = depth - 1;
+        if (change_count < 0) change_count = 0;
+        if (change_count > (int)(sizeof(change_points) / sizeof(change_points[0]))) {
+            change_count = sizeof(change_points) / sizeof(change_points[0]);
+        }
+        for (int i = 0; i < change_count; i++) {
+            change_points[i] = 1 + rand_r(&seed) % (steps > 0 ? steps : 1);
+        }
+    }
+
+    active = 1;
+    schedule_next(); // quem roda primeiro
+    pthread_mutex_unlock(&lock);
+}
+
+void coop_thread_begin(int id) {
+    if (!active) {
+        return;
+    }
+    pthread_mutex_lock(&lock);
+    self = id;
+    wait_turn();
+    pthread_mutex_unlock(&lock);
+}
+
+void coop_yield() {
+    if (!active || self < 0) {
+        return;
+    }
+    pthread_mutex_lock(&lock);
+    schedule_next();
+    wait_turn();
+    pthread_mutex_unlock(&lock);
+}
+
+void coop_thread_end() {
+    if (!active || self < 0) {
+        return;
+    }
+    pthread_mutex_lock(&lock);
+    finished[self] = 1;
+    alive--;
+    schedule_next();
+    self = -1;
+    pthread_mutex_unlock(&lock);
+}
+
+int coop_end(coop_schedule_t* recorded) {
+    pthread_mutex_lock(&lock);
+    flush_run();
+    active = 0;
+    if (policy == COOP_REPLAY && replay_pos != replay_input->size) {
+        diverged = 1; // sobrou cronograma: a execução seguiu outro caminho
+    }
+    if (recorded) {
+        recorded->size = 0;
+        for (size_t i = 0; i < recording.size; i++) {
+            put_byte(recorded, recording.data[i]);
+        }
+    }
+    int result = diverged ? -1 : 0;
+    pthread_mutex_unlock(&lock);
+    return result;
+}
+
+void coop_schedule_free(coop_schedule_t* schedule) {
+    free(schedule->data);
+    schedule->data = NULL;
+    schedule->size = schedule->capacity = 0;
+}
+
+int coop_schedule_save(const char* path, const coop_schedule_t* schedule, int threads, long param) {
+    coop_schedule_t header = {NULL, 0, 0};
+    put_varint(&header, threads);
+    put_varint(&header, param);
+    put_varint(&header, schedule->size);
+
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        perror(path);
+        coop_schedule_free(&header);
+        return -1;
+    }
+    int ok = fwrite(SCHEDULE_MAGIC, 1, 8, f) == 8 &&
+             fwrite(header.data, 1, header.size, f) == header.size &&
+             fwrite(schedule->data, 1, schedule->size, f) == schedule->size;
+    ok &= fclose(f) == 0;
+    coop_schedule_free(&header);
+    if (!ok) {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+int coop_schedule_load(const char* path, coop_schedule_t* schedule, int* threads, long* param) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    coop_schedule_t file = {NULL, 0, 0};
+    int c;
+    while ((c = fgetc(f)) != EOF) {
+        put_byte(&file, (unsigned char)c);
+    }
+    fclose(f);
+
+    size_t pos = 8;
+    unsigned long t, p, size;
+    if (file.size < 8 || memcmp(file.data, SCHEDULE_MAGIC, 8) != 0 ||
+        get_varint(&file, &pos, &t) < 0 || get_varint(&file, &pos, &p) < 0 ||
+        get_varint(&file, &pos, &size) < 0 || file.size - pos != size || t == 0 || t > COOP_MAX_THREADS) {
+        fprintf(stderr, "%s: não é um cronograma válido\n", path);
+        coop_schedule_free(&file);
+        return -1;
+    }
+    *threads = (int)t;
+    *param = (long)p;
+    schedule->size = 0;
+    for (size_t i = pos; i < file.size; i++) {
+        put_byte(schedule, file.data[i]);
+    }
+    coop_schedule_free(&file);
+    return 0;
+}
@@ -0,0 +1,68 @@
+/*
+ * Escalonador cooperativo determinístico para reproduzir races
+ *
+ * Em modo cooperativo só uma thread instrumentada roda por vez: ela
+ * passa a vez em cada coop_yield() (colocado antes de cada acesso
+ * compartilhado) e o escalonador, com uma semente, decide quem continua.
+ * A sequência de decisões é o cronograma da execução: gravado, ele
+ * reproduz a mesma intercalação, e portanto o mesmo resultado, byte a
+ * byte.
+ *
+ * Políticas:
+ *   COOP_RANDOM  cada decisão sorteia uma thread ainda viva
+ *   COOP_PCT     Probabilistic Concurrency Testing (Burckhardt et al.,
+ *                ASPLOS 2010): prioridades aleatórias distintas, roda
+ *                sempre a thread de maior prioridade e, em depth-1 passos
+ *                sorteados entre 1 e steps, rebaixa a thread que está
+ *                rodando. Acha um bug de profundidade d com probabilidade
+ *                >= 1/(n * steps^(d-1)) por execução
+ *   COOP_REPLAY  segue um cronograma gravado
+ *
+ * Formato do cronograma: pares (thread, repetições) em varint, ou seja,
+ * cada trecho em que a mesma thread é escolhida seguidamente ocupa dois
+ * ou três bytes.
+ *
+ * Fora de coop_begin()/coop_end() coop_yield() não faz nada, então o
+ * mesmo código roda livre (com threads de verdade em paralelo).
+ */
+
+#ifndef COOP_SCHED_H
+#define COOP_SCHED_H
+
+#include <stddef.h>
+
+#define COOP_MAX_THREADS 64
+
+typedef enum {
+    COOP_RANDOM,
+    COOP_PCT,
+    COOP_REPLAY
+} coop_policy_t;
+
+typedef struct {
+    unsigned char* data;
+    size_t size;
+    size_t capacity;
+} coop_schedule_t;
+
+// Prepara uma execução com 'threads' threads (ids 0..threads-1). steps é
+// a estimativa de passos para o PCT; replay só é usado com COOP_REPLAY.
+void coop_begin(coop_policy_t policy, int threads, unsigned int seed,
+                long steps, int depth, const coop_schedule_t* replay);
+
+// Chamadas pelas threads instrumentadas
+void coop_thread_begin(int id);  // espera a primeira vez da thread
+void coop_yield();               // ponto de escalonamento
+void coop_thread_end();
+
+// Depois do join: copia o cronograma gravado (se recorded != NULL) e
+// devolve 0, ou -1 se o replay divergiu do cronograma
+int coop_end(coop_schedule_t* recorded);
+
+void coop_schedule_free(coop_schedule_t* schedule);
+
+// Arquivo: cabeçalho com threads e um parâmetro do cenário + cronograma
+int coop_schedule_save(const char* path, const coop_schedule_t* schedule, int threads, long param);
+int coop_schedule_load(const char* path, coop_schedule_t* schedule, int* threads, long* param);
+
+#endif
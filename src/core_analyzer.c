@@ -0,0 +1,798 @@
+/*
+ * Analisador de core dumps ELF sem gdb
+ *
+ * Faz à máquina o roteiro de core_dumps/core_dump_analysis.md: mapeia o
+ * core com mmap, percorre as notas do segmento PT_NOTE
+ *   NT_PRSTATUS  registradores e pid de cada thread (a primeira é a que falhou)
+ *   NT_SIGINFO   sinal, si_code e endereço da falha
+ *   NT_FILE      arquivos mapeados (executável, bibliotecas) e seus endereços
+ *   NT_AUXV      vetor auxiliar (AT_ENTRY, para conferir o executável)
+ * segue a pilha da thread que falhou pelos frame pointers lendo a memória
+ * dos segmentos PT_LOAD e simboliza cada endereço com a tabela de símbolos
+ * do executável em bin/ (ou da biblioteca indicada em NT_FILE). O resumo
+ * termina com uma assinatura de uma linha: sinal + funções do topo da pilha.
+ *
+ * Com um diretório, analisa todos os cores em paralelo e agrupa os que têm
+ * a mesma assinatura.
+ *
+ * Uso: core_analyzer [-b dir_bin] [-j threads] <core | diretório>
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <libgen.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/procfs.h>
+#include <sys/stat.h>
+
+#define MAX_FRAMES 32
+#define MAX_MODULES 64
+#define SIGNATURE_FRAMES 3
+#define SCAN_WORDS 512
+#define MAX_CORES 4096
+
+#ifndef NT_SIGINFO
+#define NT_SIGINFO 0x53494749
+#endif
+#ifndef NT_FILE
+#define NT_FILE 0x46494c45
+#endif
+
+// Índices em elf_gregset_t (struct user_regs_struct / user_pt_regs)
+#if defined(__x86_64__)
+#define REG_PC 16
+#define REG_SP 19
+#define REG_FP 4
+#define CORE_MACHINE EM_X86_64
+#elif defined(__aarch64__)
+#define REG_PC 32
+#define REG_SP 31
+#define REG_FP 29
+#define CORE_MACHINE EM_AARCH64
+#endif
+
+typedef struct {
+    uint64_t addr;
+    uint64_t size;
+    const char* name;
+} symbol_t;
+
+// Símbolos de um executável/biblioteca, carregados uma vez e compartilhados
+typedef struct {
+    char path[4096];
+    void* map;
+    size_t map_size;
+    uint64_t first_load_vaddr;
+    symbol_t* symbols;
+    int symbol_count;
+} module_t;
+
+typedef struct {
+    uint64_t start;
+    uint64_t end;
+    uint64_t file_offset;
+    const char* path;
+} mapped_file_t;
+
+typedef struct {
+    uint64_t pc;
+    const char* function;
+    uint64_t offset;
+    const char* module;
+    int scanned; // encontrado por varredura da pilha, não pela cadeia de frames
+} frame_t;
+
+typedef struct {
+    const char* path;
+    unsigned char* data;
+    size_t size;
+    const Elf64_Ehdr* ehdr;
+
+    int pid;
+    int signo;
+    int si_code;
+    uint64_t fault_addr;
+    uint64_t regs[64];
+    int thread_count;
+    char process_name[17];
+    uint64_t entry;
+
+    mapped_file_t files[1024];
+    int file_count;
+
+    frame_t frames[MAX_FRAMES];
+    int frame_count;
+    char signature[512];
+    char error[256];
+} core_t;
+
+static const char* bin_dir = "bin";
+static module_t modules[MAX_MODULES];
+static int module_count = 0;
+static pthread_mutex_t module_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void* map_file(const char* path, size_t* size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    void* map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        *size = st.st_size;
+    }
+    close(fd);
+    return map == MAP_FAILED ? NULL : map;
+}
+
+// Cabeçalho ELF64 com a tabela de program headers inteira dentro do arquivo:
+// daqui em diante e_phoff/e_phnum são usados sem conferir de novo
+static int valid_elf(const unsigned char* data, size_t size) {
+    if (size < sizeof(Elf64_Ehdr) || memcmp(data, ELFMAG, SELFMAG) != 0 || data[EI_CLASS] != ELFCLASS64) {
+        return 0;
+    }
+    const Elf64_Ehdr* ehdr = (const Elf64_Ehdr*)data;
+    return ehdr->e_phentsize == sizeof(Elf64_Phdr) && ehdr->e_phoff <= size &&
+           (uint64_t)ehdr->e_phnum * sizeof(Elf64_Phdr) <= size - ehdr->e_phoff;
+}
+
+// O segmento inteiro cabe no arquivo mapeado
+static int segment_in_file(const Elf64_Phdr* p, size_t map_size) {
+    return p->p_offset <= map_size && p->p_filesz <= map_size - p->p_offset;
+}
+
+/* ---- símbolos ---- */
+
+static int compare_symbols(const void* a, const void* b) {
+    const symbol_t* x = a;
+    const symbol_t* y = b;
+    return x->addr < y->addr ? -1 : x->addr > y->addr;
+}
+
+// A seção inteira cabe no arquivo mapeado (binário truncado ou corrompido)
+static int section_in_file(const Elf64_Shdr* sh, size_t map_size) {
+    return sh->sh_offset <= map_size && sh->sh_size <= map_size - sh->sh_offset;
+}
+
+static void load_symbols(module_t* m) {
+    const unsigned char* data = m->map;
+    const Elf64_Ehdr* ehdr = m->map;
+    if (ehdr->e_shoff == 0 || ehdr->e_shoff > m->map_size ||
+        (size_t)ehdr->e_shnum * sizeof(Elf64_Shdr) > m->map_size - ehdr->e_shoff) {
+        return;
+    }
+    const Elf64_Shdr* sections = (const Elf64_Shdr*)(data + ehdr->e_shoff);
+
+    // Prefere .symtab (funções estáticas também); sem ela, .dynsym
+    const Elf64_Shdr* symtab = NULL;
+    for (int pass = 0; pass < 2 && !symtab; pass++) {
+        for (int i = 0; i < ehdr->e_shnum; i++) {
+            if (sections[i].sh_type == (pass == 0 ? SHT_SYMTAB : SHT_DYNSYM)) {
+                symtab = &sections[i];
+                break;
+            }
+        }
+    }
+    if (!symtab || symtab->sh_link >= ehdr->e_shnum) {
+        return;
+    }
+
+    // Qualquer offset fora do mapeamento: o módulo fica sem símbolos
+    const Elf64_Shdr* strtab = &sections[symtab->sh_link];
+    if (!section_in_file(symtab, m->map_size) || !section_in_file(strtab, m->map_size) ||
+        strtab->sh_size == 0 || data[strtab->sh_offset + strtab->sh_size - 1] != 0) {
+        return;
+    }
+    const Elf64_Sym* syms = (const Elf64_Sym*)(data + symtab->sh_offset);
+    int count = symtab->sh_size / sizeof(Elf64_Sym);
+
+    m->symbols = malloc(count * sizeof(symbol_t));
+    for (int i = 0; i < count; i++) {
+        if (ELF64_ST_TYPE(syms[i].st_info) != STT_FUNC || syms[i].st_value == 0) {
+            continue;
+        }
+        if (syms[i].st_name >= strtab->sh_size) {
+            free(m->symbols);
+            m->symbols = NULL;
+            m->symbol_count = 0;
+            return;
+        }
+        symbol_t* s = &m->symbols[m->symbol_count++];
+        s->addr = syms[i].st_value;
+        s->size = syms[i].st_size;
+        s->name = (const char*)data + strtab->sh_offset + syms[i].st_name;
+    }
+    qsort(m->symbols, m->symbol_count, sizeof(symbol_t), compare_symbols);
+}
+
+static module_t* get_module(const char* path) {
+    pthread_mutex_lock(&module_lock);
+    for (int i = 0; i < module_count; i++) {
+        if (strcmp(modules[i].path, path) == 0) {
+            pthread_mutex_unlock(&module_lock);
+            return modules[i].map ? &modules[i] : NULL;
+        }
+    }
+
+    module_t* m = NULL;
+    if (module_count < MAX_MODULES) {
+        m = &modules[module_count++];
+        snprintf(m->path, sizeof(m->path), "%s", path);
+        m->map = map_file(path, &m->map_size);
+        if (m->map && !valid_elf(m->map, m->map_size)) {
+            munmap(m->map, m->map_size);
+            m->map = NULL;
+        }
+        if (m->map) {
+            const Elf64_Ehdr* ehdr = m->map;
+            const Elf64_Phdr* phdrs = (const Elf64_Phdr*)((const char*)m->map + ehdr->e_phoff);
+            for (int i = 0; i < ehdr->e_phnum; i++) {
+                if (phdrs[i].p_type == PT_LOAD) {
+                    m->first_load_vaddr = phdrs[i].p_vaddr - phdrs[i].p_offset;
+                    break;
+                }
+            }
+            load_symbols(m);
+        } else {
+            m = NULL;
+        }
+    }
+    pthread_mutex_unlock(&module_lock);
+    return m;
+}
+
+static const symbol_t* find_symbol(const module_t* m, uint64_t addr) {
+    int lo = 0, hi = m->symbol_count - 1, best = -1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (m->symbols[mid].addr <= addr) {
+            best = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    if (best < 0) {
+        return NULL;
+    }
+    const symbol_t* s = &m->symbols[best];
+    if (s->size && addr >= s->addr + s->size) {
+        return NULL;
+    }
+    return s;
+}
+
+/* ---- leitura do core ---- */
+
+static const void* core_memory(const core_t* core, uint64_t addr, size_t size) {
+    const Elf64_Phdr* phdrs = (const Elf64_Phdr*)(core->data + core->ehdr->e_phoff);
+    for (int i = 0; i < core->ehdr->e_phnum; i++) {
+        const Elf64_Phdr* p = &phdrs[i];
+        if (p->p_type == PT_LOAD && segment_in_file(p, core->size) && addr >= p->p_vaddr &&
+            addr - p->p_vaddr <= p->p_filesz && size <= p->p_filesz - (addr - p->p_vaddr)) {
+            return core->data + p->p_offset + (addr - p->p_vaddr);
+        }
+    }
+    return NULL;
+}
+
+static void parse_file_note(core_t* core, const unsigned char* desc, size_t size) {
+    // {count, page_size}, count triplas {start, end, offset} e os nomes
+    if (size < 16) {
+        return;
+    }
+    const uint64_t* header = (const uint64_t*)desc;
+    uint64_t count = header[0];
+    if (count > (size - 16) / 24) {
+        return;
+    }
+    uint64_t page_size = header[1];
+    const uint64_t* entries = header + 2;
+    const char* name = (const char*)(entries + count * 3);
+    const char* end = (const char*)desc + size;
+
+    for (uint64_t i = 0; i < count && name < end; i++) {
+        if (core->file_count < (int)(sizeof(core->files) / sizeof(core->files[0]))) {
+            mapped_file_t* f = &core->files[core->file_count++];
+            f->start = entries[i * 3];
+            f->end = entries[i * 3 + 1];
+            f->file_offset = entries[i * 3 + 2] * page_size;
+            f->path = name;
+        }
+        name += strnlen(name, end - name) + 1;
+    }
+}
+
+static void parse_notes(core_t* core, const unsigned char* notes, size_t size) {
+    size_t pos = 0;
+    while (pos + sizeof(Elf64_Nhdr) <= size) {
+        const Elf64_Nhdr* note = (const Elf64_Nhdr*)(notes + pos);
+        size_t name_size = (note->n_namesz + 3) & ~3UL;
+        size_t desc_size = (note->n_descsz + 3) & ~3UL;
+        const unsigned char* desc = notes + pos + sizeof(Elf64_Nhdr) + name_size;
+        if (pos + sizeof(Elf64_Nhdr) + name_size + note->n_descsz > size) {
+            break;
+        }
+
+        switch (note->n_type) {
+            case NT_PRSTATUS: {
+                if (note->n_descsz < sizeof(struct elf_prstatus)) break;
+                // Só a primeira thread interessa para o backtrace: é a que falhou
+                const struct elf_prstatus* status = (const struct elf_prstatus*)desc;
+                if (core->thread_count++ == 0) {
+                    core->pid = status->pr_pid;
+                    if (!core->signo) core->signo = status->pr_cursig;
+                    memcpy(core->regs, &status->pr_reg, sizeof(status->pr_reg));
+                }
+                break;
+            }
+            case NT_PRPSINFO: {
+                if (note->n_descsz < sizeof(struct elf_prpsinfo)) break;
+                const struct elf_prpsinfo* info = (const struct elf_prpsinfo*)desc;
+                snprintf(core->process_name, sizeof(core->process_name), "%s", info->pr_fname);
+                break;
+            }
+            case NT_SIGINFO: {
+                if (note->n_descsz < sizeof(siginfo_t)) break;
+                const siginfo_t* info = (const siginfo_t*)desc;
+                core->signo = info->si_signo;
+                core->si_code = info->si_code;
+                core->fault_addr = (uint64_t)info->si_addr;
+                break;
+            }
+            case NT_FILE:
+                parse_file_note(core, desc, note->n_descsz);
+                break;
+            case NT_AUXV: {
+                const Elf64_auxv_t* aux = (const Elf64_auxv_t*)desc;
+                for (size_t i = 0; i < note->n_descsz / sizeof(*aux) && aux[i].a_type != AT_NULL; i++) {
+                    if (aux[i].a_type == AT_ENTRY) {
+                        core->entry = aux[i].a_un.a_val;
+                    }
+                }
+                break;
+            }
+        }
+        pos += sizeof(Elf64_Nhdr) + name_size + desc_size;
+    }
+}
+
+/* ---- backtrace e simbolização ---- */
+
+static const mapped_file_t* file_for(const core_t* core, uint64_t addr) {
+    for (int i = 0; i < core->file_count; i++) {
+        if (addr >= core->files[i].start && addr < core->files[i].end) {
+            return &core->files[i];
+        }
+    }
+    return NULL;
+}
+
+// O executável do core é procurado primeiro em bin/ (pelo nome do arquivo)
+static module_t* module_for_file(const core_t* core, const mapped_file_t* file) {
+    char copy[4096];
+    snprintf(copy, sizeof(copy), "%s", file->path);
+    const char* base = basename(copy);
+
+    if (strncmp(base, core->process_name, 15) == 0) {
+        char local[4096];
+        snprintf(local, sizeof(local), "%s/%s", bin_dir, base);
+        if (access(local, R_OK) == 0) {
+            module_t* m = get_module(local);
+            if (m) return m;
+        }
+    }
+    return get_module(file->path);
+}
+
+// Endereço onde o arquivo foi carregado: mapeamento que começa no offset 0
+static uint64_t load_bias(const core_t* core, const mapped_file_t* file, const module_t* m) {
+    uint64_t base = file->start - file->file_offset;
+    for (int i = 0; i < core->file_count; i++) {
+        if (strcmp(core->files[i].path, file->path) == 0 && core->files[i].file_offset == 0) {
+            base = core->files[i].start;
+            break;
+        }
+    }
+    return base - m->first_load_vaddr;
+}
+
+// Dados executados como código (ex.: string em .rodata) não ganham nome de função
+static int in_code(const module_t* m, uint64_t relative) {
+    const Elf64_Ehdr* ehdr = m->map;
+    const Elf64_Phdr* phdrs = (const Elf64_Phdr*)((const char*)m->map + ehdr->e_phoff);
+    for (int i = 0; i < ehdr->e_phnum; i++) {
+        if (phdrs[i].p_type == PT_LOAD && (phdrs[i].p_flags & PF_X) && relative >= phdrs[i].p_vaddr &&
+            relative < phdrs[i].p_vaddr + phdrs[i].p_memsz) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int symbolize(const core_t* core, frame_t* frame, int return_address) {
+    const mapped_file_t* file = file_for(core, frame->pc);
+    if (!file) {
+        return 0;
+    }
+    frame->module = strrchr(file->path, '/') ? strrchr(file->path, '/') + 1 : file->path;
+
+    module_t* m = module_for_file(core, file);
+    if (!m) {
+        return 0;
+    }
+    // Endereço de retorno aponta para depois da call: pc - 1 cai dentro dela
+    uint64_t relative = frame->pc - load_bias(core, file, m);
+    const symbol_t* s = find_symbol(m, relative - (return_address ? 1 : 0));
+    if (!s || !in_code(m, relative)) {
+        return 0;
+    }
+    frame->function = s->name;
+    frame->offset = relative - s->addr;
+    return 1;
+}
+
+static void add_frame(core_t* core, uint64_t pc, int return_address, int scanned) {
+    frame_t* f = &core->frames[core->frame_count++];
+    f->pc = pc;
+    f->function = NULL;
+    f->module = NULL;
+    f->offset = 0;
+    f->scanned = scanned;
+    symbolize(core, f, return_address);
+}
+
+// Confere no arquivo do módulo se a instrução anterior ao endereço é uma call
+static int preceded_by_call(const module_t* m, uint64_t relative) {
+    const Elf64_Ehdr* ehdr = m->map;
+    const Elf64_Phdr* phdrs = (const Elf64_Phdr*)((const char*)m->map + ehdr->e_phoff);
+    for (int i = 0; i < ehdr->e_phnum; i++) {
+        const Elf64_Phdr* p = &phdrs[i];
+        if (p->p_type != PT_LOAD || !(p->p_flags & PF_X) || relative < p->p_vaddr + 8 ||
+            relative >= p->p_vaddr + p->p_filesz || !segment_in_file(p, m->map_size)) {
+            continue;
+        }
+        const unsigned char* code = (const unsigned char*)m->map + p->p_offset + (relative - p->p_vaddr);
+#if defined(__x86_64__)
+        // call rel32 (E8) ou call indireto (FF /2) com 2, 3, 6 ou 7 bytes
+        if (code[-5] == 0xE8) return 1;
+        if (code[-2] == 0xFF && (code[-1] & 0x38) == 0x10) return 1;
+        if (code[-3] == 0xFF && (code[-2] & 0x38) == 0x10) return 1;
+        if (code[-6] == 0xFF && (code[-5] & 0x38) == 0x10) return 1;
+        if (code[-7] == 0xFF && (code[-6] & 0x38) == 0x10) return 1;
+#elif defined(__aarch64__)
+        uint32_t insn;
+        memcpy(&insn, code - 4, 4);
+        if ((insn & 0xFC000000) == 0x94000000 || (insn & 0xFFFFFC1F) == 0xD63F0000) return 1;
+#endif
+        return 0;
+    }
+    return 0;
+}
+
+// Endereço de retorno plausível: dentro de uma função conhecida, logo após uma call
+static int is_return_address(const core_t* core, uint64_t addr) {
+    const mapped_file_t* file = file_for(core, addr);
+    if (!file) {
+        return 0;
+    }
+    module_t* m = module_for_file(core, file);
+    if (!m) {
+        return 0;
+    }
+    uint64_t relative = addr - load_bias(core, file, m);
+    const symbol_t* s = find_symbol(m, relative - 1);
+    return s && s->size && preceded_by_call(m, relative);
+}
+
+static void walk_frame_chain(core_t* core, uint64_t fp) {
+    while (core->frame_count < MAX_FRAMES && fp && (fp & 7) == 0) {
+        const uint64_t* record = core_memory(core, fp, 16);
+        if (!record || record[1] == 0 || !file_for(core, record[1])) {
+            break;
+        }
+        add_frame(core, record[1], 1, 0);
+        if (record[0] <= fp) {
+            break;
+        }
+        fp = record[0];
+    }
+}
+
+static void unwind(core_t* core) {
+    uint64_t pc = core->regs[REG_PC];
+    uint64_t sp = core->regs[REG_SP];
+
+    add_frame(core, pc, 0, 0);
+    walk_frame_chain(core, core->regs[REG_FP]);
+
+    int symbolized = 0;
+    for (int i = 1; i < core->frame_count; i++) {
+        symbolized += core->frames[i].function != NULL;
+    }
+    if (symbolized > 0) {
+        return;
+    }
+
+    // Falha dentro de código sem frame pointer (abort, raise na libc): a
+    // cadeia não leva a lugar nenhum. Varre a pilha a partir do sp atrás do
+    // primeiro endereço de retorno válido e, acima dele, do primeiro frame
+    // record [fp anterior, retorno] para retomar a cadeia normal.
+    core->frame_count = 1;
+    const uint64_t* stack = NULL;
+    int words = SCAN_WORDS;
+    while (words > 1 && !(stack = core_memory(core, sp, words * 8))) {
+        words /= 2;
+    }
+
+    int found = -1;
+    for (int i = 0; stack && i < words; i++) {
+        if (is_return_address(core, stack[i])) {
+            add_frame(core, stack[i], 1, 1);
+            found = i;
+            break;
+        }
+    }
+    for (int j = found + 1; found >= 0 && j + 1 < words; j++) {
+        uint64_t record_addr = sp + j * 8;
+        if (stack[j] > record_addr && stack[j] - record_addr < (1 << 20) &&
+            is_return_address(core, stack[j + 1])) {
+            walk_frame_chain(core, record_addr);
+            break;
+        }
+    }
+}
+
+static const char* signal_name(int sig) {
+    const char* name = sigabbrev_np(sig);
+    return name ? name : "?";
+}
+
+static void build_signature(core_t* core) {
+    int len = snprintf(core->signature, sizeof(core->signature), "%s:%s", core->process_name,
+                       core->signo ? "SIG" : "");
+    len += snprintf(core->signature + len, sizeof(core->signature) - len, "%s",
+                    core->signo ? signal_name(core->signo) : "?");
+
+    // Recursão vira uma entrada só, para não ocupar a assinatura inteira
+    int used = 0;
+    const char* previous = NULL;
+    int recursive = 0;
+    for (int i = 0; i < core->frame_count && used < SIGNATURE_FRAMES; i++) {
+        const frame_t* f = &core->frames[i];
+        if (!f->function) {
+            if (i == 0) {
+                len += snprintf(core->signature + len, sizeof(core->signature) - len, " ??");
+                used++;
+            }
+            continue;
+        }
+        if (previous && strcmp(previous, f->function) == 0) {
+            if (!recursive) {
+                len += snprintf(core->signature + len, sizeof(core->signature) - len, " (recursão)");
+                recursive = 1;
+            }
+            continue;
+        }
+        len += snprintf(core->signature + len, sizeof(core->signature) - len, "%s%s",
+                        used == 0 ? " " : " < ", f->function);
+        previous = f->function;
+        recursive = 0;
+        used++;
+    }
+}
+
+static int analyze_core(core_t* core, const char* path) {
+    memset(core, 0, sizeof(*core));
+    core->path = path;
+
+    core->data = map_file(path, &core->size);
+    if (!core->data) {
+        snprintf(core->error, sizeof(core->error), "não foi possível abrir");
+        return -1;
+    }
+    core->ehdr = (const Elf64_Ehdr*)core->data;
+    if (!valid_elf(core->data, core->size) || core->ehdr->e_type != ET_CORE) {
+        snprintf(core->error, sizeof(core->error), "não é um core ELF de 64 bits");
+        return -1;
+    }
+#ifdef CORE_MACHINE
+    if (core->ehdr->e_machine != CORE_MACHINE) {
+        snprintf(core->error, sizeof(core->error), "arquitetura %d diferente da máquina local",
+                 core->ehdr->e_machine);
+        return -1;
+    }
+#endif
+
+    const Elf64_Phdr* phdrs = (const Elf64_Phdr*)(core->data + core->ehdr->e_phoff);
+    for (int i = 0; i < core->ehdr->e_phnum; i++) {
+        if (phdrs[i].p_type == PT_NOTE && segment_in_file(&phdrs[i], core->size)) {
+            parse_notes(core, core->data + phdrs[i].p_offset, phdrs[i].p_filesz);
+        }
+    }
+    if (core->thread_count == 0) {
+        snprintf(core->error, sizeof(core->error), "sem NT_PRSTATUS");
+        return -1;
+    }
+
+#ifdef REG_PC
+    unwind(core);
+#endif
+    build_signature(core);
+    return 0;
+}
+
+static void release_core(core_t* core) {
+    if (core->data) {
+        munmap(core->data, core->size);
+        core->data = NULL;
+    }
+}
+
+static void print_core(const core_t* core) {
+    printf("core: %s\n", core->path);
+    printf("processo: %s (pid %d), %d thread(s)\n", core->process_name, core->pid, core->thread_count);
+    printf("sinal: %d (SIG%s) si_code %d endereço 0x%lx\n", core->signo, signal_name(core->signo),
+           core->si_code, (unsigned long)core->fault_addr);
+#ifdef REG_PC
+    printf("registradores: pc=0x%lx sp=0x%lx fp=0x%lx\n", (unsigned long)core->regs[REG_PC],
+           (unsigned long)core->regs[REG_SP], (unsigned long)core->regs[REG_FP]);
+#endif
+    printf("backtrace:\n");
+    for (int i = 0; i < core->frame_count; i++) {
+        const frame_t* f = &core->frames[i];
+        printf("  #%-2d 0x%016lx %s", i, (unsigned long)f->pc, f->function ? f->function : "??");
+        if (f->function) printf("+0x%lx", (unsigned long)f->offset);
+        printf(" (%s)%s\n", f->module ? f->module : "?", f->scanned ? " [varredura]" : "");
+    }
+    printf("assinatura: %s\n", core->signature);
+}
+
+/* ---- modo diretório ---- */
+
+typedef struct {
+    char** paths;
+    int count;
+    int next;
+    char (*signatures)[512];
+    pthread_mutex_t lock;
+} work_t;
+
+static void* analyze_worker(void* arg) {
+    work_t* work = arg;
+    core_t* core = malloc(sizeof(core_t));
+
+    for (;;) {
+        pthread_mutex_lock(&work->lock);
+        int index = work->next++;
+        pthread_mutex_unlock(&work->lock);
+        if (index >= work->count) {
+            break;
+        }
+
+        if (analyze_core(core, work->paths[index]) == 0) {
+            snprintf(work->signatures[index], 512, "%s", core->signature);
+        } else {
+            snprintf(work->signatures[index], 512, "(inválido: %s)", core->error);
+        }
+        release_core(core);
+    }
+    free(core);
+    return NULL;
+}
+
+typedef struct {
+    const char* signature;
+    const char* example;
+    int count;
+} bucket_t;
+
+static int compare_buckets(const void* a, const void* b) {
+    return ((const bucket_t*)b)->count - ((const bucket_t*)a)->count;
+}
+
+static int analyze_directory(const char* dir, int threads) {
+    DIR* d = opendir(dir);
+    if (!d) {
+        perror(dir);
+        return 1;
+    }
+
+    work_t work = {.paths = malloc(MAX_CORES * sizeof(char*)), .lock = PTHREAD_MUTEX_INITIALIZER};
+    struct dirent* entry;
+    while ((entry = readdir(d)) != NULL && work.count < MAX_CORES) {
+        if (entry->d_name[0] == '.') continue;
+        char path[4096];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        if (stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
+            work.paths[work.count++] = strdup(path);
+        }
+    }
+    closedir(d);
+    work.signatures = calloc(work.count, 512);
+
+    double start = now_seconds();
+    pthread_t workers[64];
+    if (threads > 64) threads = 64;
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&workers[i], NULL, analyze_worker, &work);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    double elapsed = now_seconds() - start;
+
+    bucket_t* buckets = calloc(work.count, sizeof(bucket_t));
+    int bucket_count = 0;
+    for (int i = 0; i < work.count; i++) {
+        int b = 0;
+        while (b < bucket_count && strcmp(buckets[b].signature, work.signatures[i]) != 0) b++;
+        if (b == bucket_count) {
+            buckets[bucket_count].signature = work.signatures[i];
+            buckets[bucket_count].example = work.paths[i];
+            bucket_count++;
+        }
+        buckets[b].count++;
+    }
+    qsort(buckets, bucket_count, sizeof(bucket_t), compare_buckets);
+
+    printf("=== %d arquivos em %.3f s com %d threads (%.1f cores/s), %d assinaturas distintas ===\n",
+           work.count, elapsed, threads, elapsed > 0 ? work.count / elapsed : 0.0, bucket_count);
+    printf("%-6s %-60s %s\n", "qtd", "assinatura", "exemplo");
+    for (int i = 0; i < bucket_count; i++) {
+        printf("%-6d %-60s %s\n", buckets[i].count, buckets[i].signature, buckets[i].example);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int opt;
+
+    while ((opt = getopt(argc, argv, "b:j:h")) != -1) {
+        switch (opt) {
+            case 'b': bin_dir = optarg; break;
+            case 'j': threads = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Uso: %s [-b dir_bin] [-j threads] <core | diretório>\n", argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "Uso: %s [-b dir_bin] [-j threads] <core | diretório>\n", argv[0]);
+        return 2;
+    }
+    if (threads < 1) threads = 1;
+
+    struct stat st;
+    if (stat(argv[optind], &st) == 0 && S_ISDIR(st.st_mode)) {
+        return analyze_directory(argv[optind], threads);
+    }
+
+    core_t* core = malloc(sizeof(core_t));
+    if (analyze_core(core, argv[optind]) < 0) {
+        fprintf(stderr, "%s: %s\n", argv[optind], core->error);
+        return 1;
+    }
+    print_core(core);
+    release_core(core);
+    return 0;
+}
@@ -5,36 +5,74 @@
  * e outros tipos de erros de execução.
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <signal.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
 #include <string.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <libgen.h>
+#include <time.h>
 #include <math.h>
 
+#include "crash_handler.h"
+#include "perf_counters.h"
+
 void enable_core_dumps() {
     struct rlimit core_limit;
-    core_limit.rlim_cur = RLIM_INFINITY;
-    core_limit.rlim_max = RLIM_INFINITY;
+    getrlimit(RLIMIT_CORE, &core_limit);
+
+    // Sobe até o máximo permitido: quem zerou o limite máximo de propósito
+    // (scenario_runner, forkserver) continua sem core
+    core_limit.rlim_cur = core_limit.rlim_max;
     
-    if (setrlimit(RLIMIT_CORE, &core_limit) == 0) {
+    if (core_limit.rlim_max != 0 && setrlimit(RLIMIT_CORE, &core_limit) == 0) {
         printf("Core dumps habilitados\n");
     } else {
         printf("Falha ao habilitar core dumps\n");
     }
 }
 
-void signal_handler(int sig) {
-    printf("Sinal recebido: %d\n", sig);
-    exit(sig);
+/*
+ * CORE_BULK_MB=N simula um processo grande: metade do buffer com dados
+ * (cache recalculável) e metade zerada (pool pré-alocado). O buffer é
+ * registrado no tratador, que o marca com MADV_DONTDUMP na falha se
+ * CORE_DONTDUMP=1.
+ */
+static void allocate_bulk_buffer() {
+    const char* env = getenv("CORE_BULK_MB");
+    size_t len = env ? (size_t)atol(env) << 20 : 0;
+    if (len == 0) {
+        return;
+    }
+
+    uint64_t* bulk = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (bulk == MAP_FAILED) {
+        perror("mmap");
+        return;
+    }
+    size_t words = len / sizeof(uint64_t);
+    for (size_t i = 0; i < words / 2; i++) {
+        bulk[i] = (i * 0x9E3779B97F4A7C15ULL) >> 40;
+    }
+    memset(bulk + words / 2, 0, len / 2);
+
+    crash_handler_register_bulk(bulk, len);
+    printf("Buffer de %zu MB alocado (CORE_BULK_MB)\n", len >> 20);
 }
 
 void cause_sigsegv() {
     printf("=== CAUSANDO SIGSEGV (Core Dump) ===\n");
     
-    // Registra handler para capturar o sinal
-    signal(SIGSEGV, signal_handler);
+    // Registra o tratador (pilha alternativa + minidump) para o sinal
+    crash_handler_watch(SIGSEGV);
     
     // Acesso a ponteiro nulo - causa SIGSEGV
     int *null_ptr = NULL;
@@ -45,7 +83,7 @@ void cause_sigsegv() {
 void cause_sigfpe() {
     printf("=== CAUSANDO SIGFPE (Floating Point Exception) ===\n");
     
-    signal(SIGFPE, signal_handler);
+    crash_handler_watch(SIGFPE);
     
     int a = 10;
     int b = 0;
@@ -59,7 +97,7 @@ void cause_sigfpe() {
 void cause_sigill() {
     printf("=== CAUSANDO SIGILL (Illegal Instruction) ===\n");
     
-    signal(SIGILL, signal_handler);
+    crash_handler_watch(SIGILL);
     
     // Executa instrução inválida (específica da arquitetura)
     // Em x86/x64, podemos tentar executar código inválido
@@ -73,7 +111,7 @@ void cause_sigill() {
 void cause_sigabrt() {
     printf("=== CAUSANDO SIGABRT (Abort) ===\n");
     
-    signal(SIGABRT, signal_handler);
+    crash_handler_watch(SIGABRT);
     
     printf("Chamando abort()...\n");
     abort(); // SIGABRT aqui!
@@ -90,7 +128,7 @@ void recursive_bomb() {
 void cause_stackoverflow_signal() {
     printf("=== CAUSANDO SIGSEGV por Stack Overflow ===\n");
     
-    signal(SIGSEGV, signal_handler);
+    crash_handler_watch(SIGSEGV);
     
     recursive_bomb();
 }
@@ -98,7 +136,7 @@ void cause_stackoverflow_signal() {
 void cause_bus_error() {
     printf("=== CAUSANDO SIGBUS (Bus Error) ===\n");
     
-    signal(SIGBUS, signal_handler);
+    crash_handler_watch(SIGBUS);
     
     // Tenta acessar memória com alinhamento incorreto
     // Isso pode causar SIGBUS em algumas arquiteturas
@@ -144,19 +182,350 @@ void test_use_after_free() {
     }
 }
 
+typedef enum {
+    DUMP_MINIDUMP,
+    DUMP_FULL_CORE,
+    DUMP_NONE
+} dump_mode_t;
+
+static const char* dump_mode_name(dump_mode_t mode) {
+    switch (mode) {
+        case DUMP_MINIDUMP:  return "minidump";
+        case DUMP_FULL_CORE: return "core completo";
+        case DUMP_NONE:      return "sem dump";
+    }
+    return "?";
+}
+
+static double now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// Soma e apaga os arquivos gerados (core*, crash-*.mdmp) no diretório
+static long collect_dump_files(const char* dir, long* disk_bytes) {
+    long total = 0;
+    *disk_bytes = 0;
+    DIR* d = opendir(dir);
+    if (!d) {
+        return 0;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(d)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        char path[4096];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        if (stat(path, &st) == 0) {
+            total += st.st_size;
+            *disk_bytes += st.st_blocks * 512L; // cores têm buracos (páginas não tocadas)
+        }
+        unlink(path);
+    }
+    closedir(d);
+    return total;
+}
+
+/*
+ * Filho com heap_mb de heap tocado falha com SIGSEGV. O pai mede do
+ * instante da falha até o wait4 devolver, o que inclui a escrita do dump
+ * (o kernel só libera o processo depois de gravar o core).
+ */
+static double crash_child(dump_mode_t mode, size_t heap_mb, const char* dir) {
+    int ready[2];
+    if (pipe(ready) < 0) {
+        perror("pipe");
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(ready[0]);
+        if (chdir(dir) < 0) _exit(1);
+
+        struct rlimit core_limit = {0, 0};
+        if (mode == DUMP_FULL_CORE) {
+            core_limit.rlim_cur = core_limit.rlim_max = RLIM_INFINITY;
+        }
+        setrlimit(RLIMIT_CORE, &core_limit);
+
+        char* heap = malloc(heap_mb << 20);
+        if (!heap) _exit(1);
+        memset(heap, 0x5a, heap_mb << 20);
+
+        if (mode == DUMP_MINIDUMP) {
+            crash_handler_init(dir);
+            crash_handler_watch(SIGSEGV);
+        } else {
+            signal(SIGSEGV, SIG_DFL);
+        }
+
+        char byte = 1;
+        if (write(ready[1], &byte, 1) != 1) _exit(1);
+        *(volatile int*)NULL = 42; // SIGSEGV aqui!
+        _exit(0);
+    }
+
+    close(ready[1]);
+    char byte;
+    if (read(ready[0], &byte, 1) != 1) {
+        close(ready[0]);
+        waitpid(pid, NULL, 0);
+        return -1;
+    }
+    double start = now_ms();
+    int status;
+    waitpid(pid, &status, 0);
+    double elapsed = now_ms() - start;
+    close(ready[0]);
+    return elapsed;
+}
+
+void compare_dump_cost(size_t heap_mb) {
+    printf("=== MINIDUMP x CORE COMPLETO (heap de %zu MB) ===\n", heap_mb);
+
+    char pattern[256] = "";
+    FILE* f = fopen("/proc/sys/kernel/core_pattern", "r");
+    if (f) {
+        if (fgets(pattern, sizeof(pattern), f)) {
+            pattern[strcspn(pattern, "\n")] = '\0';
+        }
+        fclose(f);
+    }
+    printf("core_pattern: %s\n", pattern);
+    if (pattern[0] == '|') {
+        printf("(core enviado para um programa: o tamanho não pode ser medido aqui)\n");
+    }
+
+    char dir[] = "/tmp/core_cmp.XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return;
+    }
+
+    printf("\n%-14s %12s %16s %14s\n", "modo", "tempo(ms)", "tamanho(bytes)", "em disco(KB)");
+    dump_mode_t modes[] = {DUMP_NONE, DUMP_MINIDUMP, DUMP_FULL_CORE};
+    for (int i = 0; i < 3; i++) {
+        double elapsed = crash_child(modes[i], heap_mb, dir);
+        long disk_bytes;
+        long bytes = collect_dump_files(dir, &disk_bytes);
+        printf("%-14s %12.3f %16ld %14.1f\n", dump_mode_name(modes[i]), elapsed, bytes,
+               disk_bytes / 1024.0);
+    }
+    rmdir(dir);
+
+    printf("\nTempo medido da falha até o wait4 devolver o filho; \"sem dump\"\n");
+    printf("é o custo de só encerrar o processo (liberar %zu MB).\n", heap_mb);
+}
+
+typedef enum {
+    CAPTURE_NO_CORE,
+    CAPTURE_FULL,
+    CAPTURE_LEAN
+} capture_policy_t;
+
+// Executa "core_dump <opção>" num filho dentro de dir; devolve ms do fork ao wait
+static double run_option_child(int option, capture_policy_t policy, size_t bulk_mb,
+                               const char* dir, int* status) {
+    double start = now_ms();
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (chdir(dir) < 0) _exit(1);
+
+        struct rlimit core_limit;
+        getrlimit(RLIMIT_CORE, &core_limit);
+        if (policy == CAPTURE_NO_CORE) {
+            core_limit.rlim_cur = core_limit.rlim_max = 0;
+        }
+        setrlimit(RLIMIT_CORE, &core_limit);
+
+        char bulk[32], option_str[16];
+        snprintf(bulk, sizeof(bulk), "%zu", bulk_mb);
+        snprintf(option_str, sizeof(option_str), "%d", option);
+        setenv("NO_COUNTDOWN", "1", 1);
+        setenv("CRASH_CORE", "1", 1);
+        setenv("CORE_BULK_MB", bulk, 1);
+        setenv("CRASH_DUMP_DIR", dir, 1);
+        if (policy == CAPTURE_LEAN) {
+            setenv("CORE_DONTDUMP", "1", 1);
+            setenv("CORE_FILTER", "0x13", 1);
+        } else {
+            unsetenv("CORE_DONTDUMP");
+            unsetenv("CORE_FILTER");
+        }
+
+        int null_fd = open("/dev/null", O_WRONLY);
+        dup2(null_fd, STDOUT_FILENO);
+        dup2(null_fd, STDERR_FILENO);
+        execl("/proc/self/exe", "core_dump", option_str, (char*)NULL);
+        _exit(127);
+    }
+
+    waitpid(pid, status, 0);
+    return now_ms() - start;
+}
+
+// Procura o core gerado pelo kernel (core_pattern relativo: core, core.%p...)
+static int find_core_file(const char* dir, char* path, size_t size) {
+    DIR* d = opendir(dir);
+    if (!d) {
+        return 0;
+    }
+    int found = 0;
+    struct dirent* entry;
+    while (!found && (entry = readdir(d)) != NULL) {
+        if (strncmp(entry->d_name, "core", 4) == 0) {
+            snprintf(path, size, "%s/%s", dir, entry->d_name);
+            found = 1;
+        }
+    }
+    closedir(d);
+    return found;
+}
+
+// Passa o core pelo coletor como o kernel faria com core_pattern "|..."
+static double run_collector(const char* collector, const char* core_path, const char* dir) {
+    double start = now_ms();
+    pid_t pid = fork();
+    if (pid == 0) {
+        int in = open(core_path, O_RDONLY);
+        int null_fd = open("/dev/null", O_WRONLY);
+        dup2(in, STDIN_FILENO);
+        dup2(null_fd, STDERR_FILENO);
+        execl(collector, "core_collector", dir, "coletado", (char*)NULL);
+        _exit(127);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        return -1;
+    }
+    return now_ms() - start;
+}
+
+static void format_status(int status, char* buf, size_t size) {
+    if (WIFSIGNALED(status)) {
+        snprintf(buf, size, "SIG%s%s", sigabbrev_np(WTERMSIG(status)),
+                 WCOREDUMP(status) ? "+core" : "");
+    } else {
+        snprintf(buf, size, "exit %d", WEXITSTATUS(status));
+    }
+}
+
+/*
+ * Para cada opção 1..8, com um buffer de bulk_mb MB: core completo, core
+ * enxuto (coredump_filter + MADV_DONTDUMP) e os dois passando pelo
+ * core_collector. "durável" = tempo até o core estar em disco (fsync),
+ * descontado o tempo da mesma execução sem core.
+ */
+void report_core_capture(size_t bulk_mb) {
+    printf("=== CAPTURA DE CORE: COMPLETO x ENXUTO x COLETOR (buffer de %zu MB) ===\n", bulk_mb);
+
+    char collector[4096];
+    ssize_t n = readlink("/proc/self/exe", collector, sizeof(collector) - 32);
+    collector[n > 0 ? n : 0] = '\0';
+    snprintf(collector + strlen(dirname(collector)), 32, "/core_collector");
+    int have_collector = access(collector, X_OK) == 0;
+    if (!have_collector) {
+        printf("(core_collector não encontrado em %s: colunas do coletor omitidas)\n", collector);
+    }
+
+    char dir[] = "/tmp/core_capture.XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return;
+    }
+
+    printf("\n%-6s %-9s %-14s %14s %12s %14s %12s\n", "opção", "política", "resultado",
+           "core(bytes)", "durável(ms)", "zcore(bytes)", "coletor(ms)");
+
+    const char* policy_names[] = {"", "completo", "enxuto"};
+    for (int option = 1; option <= 8; option++) {
+        int status;
+        long unused;
+        double baseline = run_option_child(option, CAPTURE_NO_CORE, bulk_mb, dir, &status);
+        collect_dump_files(dir, &unused);
+
+        for (capture_policy_t policy = CAPTURE_FULL; policy <= CAPTURE_LEAN; policy++) {
+            double elapsed = run_option_child(option, policy, bulk_mb, dir, &status);
+            char result[32];
+            format_status(status, result, sizeof(result));
+
+            char core_path[4096];
+            if (!find_core_file(dir, core_path, sizeof(core_path))) {
+                printf("%-6d %-9s %-14s %14s %12s %14s %12s\n", option, policy_names[policy],
+                       result, "-", "-", "-", "-");
+                collect_dump_files(dir, &unused);
+                continue;
+            }
+
+            struct stat st;
+            stat(core_path, &st);
+            double fsync_start = now_ms();
+            int fd = open(core_path, O_RDONLY);
+            fsync(fd);
+            close(fd);
+            double durable = elapsed - baseline + (now_ms() - fsync_start);
+
+            double collector_ms = -1;
+            long zcore_bytes = 0;
+            if (have_collector) {
+                collector_ms = run_collector(collector, core_path, dir);
+                char zcore_path[4096];
+                struct stat zst;
+                snprintf(zcore_path, sizeof(zcore_path), "%s/coletado.zcore", dir);
+                if (stat(zcore_path, &zst) == 0) {
+                    zcore_bytes = zst.st_size;
+                }
+            }
+
+            printf("%-6d %-9s %-14s %14ld %12.1f %14ld %12.1f\n", option, policy_names[policy],
+                   result, (long)st.st_size, durable < 0 ? 0 : durable, zcore_bytes, collector_ms);
+            collect_dump_files(dir, &unused);
+        }
+    }
+    rmdir(dir);
+
+    printf("\ncompleto: RLIMIT_CORE máximo, sem filtro; enxuto: CORE_FILTER=0x13 e\n");
+    printf("CORE_DONTDUMP=1 (buffer fora do core). coletor: tempo do core_collector lendo o\n");
+    printf("core bruto, descartando páginas zeradas, comprimindo em paralelo e fazendo fsync.\n");
+    printf("Opções que terminam com exit 0 (6 e 8 em x86) não geram core.\n");
+}
+
 int main(int argc, char *argv[]) {
     printf("=== DEMONSTRAÇÃO: CORE DUMPS E OUTROS ERROS ===\n");
     printf("Este programa causará terminação anormal\n\n");
     
     enable_core_dumps();
+    crash_handler_init(NULL);
+    allocate_bulk_buffer();
+    // O tratador de falha imprime também os contadores (PERF_COUNTERS=1)
+    perf_counters_init();
+    crash_handler_set_hook(perf_counters_crash_report);
+
+    // Com CRASH_CORE=1 todo sinal fatal passa pela política antes do core
+    if (getenv("CRASH_CORE")) {
+        crash_handler_watch(SIGSEGV);
+        crash_handler_watch(SIGBUS);
+        crash_handler_watch(SIGFPE);
+        crash_handler_watch(SIGILL);
+        crash_handler_watch(SIGABRT);
+    }
     
     int option = 1;
     if (argc > 1) {
         option = atoi(argv[1]);
     }
     
-    printf("Executando teste %d em 3 segundos...\n", option);
-    sleep(3);
+    // O executor paralelo (scenario_runner) dispensa a contagem regressiva
+    if (!getenv("NO_COUNTDOWN")) {
+        printf("Executando teste %d em 3 segundos...\n", option);
+        sleep(3);
+    }
     
     switch(option) {
         case 1:
@@ -183,10 +552,18 @@ int main(int argc, char *argv[]) {
         case 8:
             test_use_after_free();
             break;
+        case 9:
+            compare_dump_cost(argc > 2 ? (size_t)atol(argv[2]) : 256);
+            return 0;
+        case 10:
+            report_core_capture(argc > 2 ? (size_t)atol(argv[2]) : 64);
+            return 0;
         default:
             printf("Opções:\n");
             printf("1=SIGSEGV, 2=SIGFPE, 3=SIGILL, 4=SIGABRT\n");
             printf("5=Stack overflow, 6=Bus error, 7=Double free, 8=Use after free\n");
+            printf("9=Custo do minidump x core completo (core_dump 9 [heap_mb])\n");
+            printf("10=Captura de core completo x enxuto x coletor (core_dump 10 [buffer_mb])\n");
             cause_sigsegv();
     }
     
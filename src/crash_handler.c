@@ -0,0 +1,420 @@
+/*
+ * Tratador de falhas com pilha alternativa e minidump - implementação
+ *
+ * Nada aqui dentro chama printf, malloc ou funções com locks: a saída é
+ * formatada à mão num buffer estático e enviada com write(). Leituras de
+ * memória durante o backtrace passam por process_vm_readv(), que devolve
+ * EFAULT em vez de gerar uma segunda falha se o frame pointer for lixo.
+ */
+
+#define _GNU_SOURCE
+#include "crash_handler.h"
+#include "sigsafe.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/uio.h>
+
+#define ALT_STACK_SIZE (64 * 1024)
+#define MAX_FRAMES 64
+#define MAX_MODULE_PATH 128
+#define EXCERPT_SIZE 8192
+#define MAX_BULK_REGIONS 16
+
+typedef struct {
+    unsigned long pc;
+    unsigned long module_offset;
+    char module[MAX_MODULE_PATH];
+} frame_t;
+
+static char dump_dir[1024] = ".";
+static int dump_to_stderr = 0;
+
+// Política de core lida do ambiente em crash_handler_init()
+static int chain_core = 0;
+static char core_filter[32];
+static int dontdump = 0;
+static struct { void* addr; size_t len; } bulk_regions[MAX_BULK_REGIONS];
+static int bulk_count = 0;
+static void (*crash_hook)(int fd) = NULL;
+
+static sig_writer_t out;
+static frame_t frames[MAX_FRAMES];
+static int frame_count;
+static char excerpt[EXCERPT_SIZE];
+static int excerpt_len;
+
+static const char* signal_name(int sig) {
+    switch (sig) {
+        case SIGSEGV: return "SIGSEGV";
+        case SIGBUS:  return "SIGBUS";
+        case SIGFPE:  return "SIGFPE";
+        case SIGILL:  return "SIGILL";
+        case SIGABRT: return "SIGABRT";
+        case SIGTRAP: return "SIGTRAP";
+        default:      return "?";
+    }
+}
+
+static long monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+/* ---- registradores e backtrace ---- */
+
+#if defined(__x86_64__)
+static const struct { const char* name; int reg; } register_table[] = {
+    {"rip", REG_RIP}, {"rsp", REG_RSP}, {"rbp", REG_RBP}, {"efl", REG_EFL},
+    {"rax", REG_RAX}, {"rbx", REG_RBX}, {"rcx", REG_RCX}, {"rdx", REG_RDX},
+    {"rsi", REG_RSI}, {"rdi", REG_RDI}, {"r8",  REG_R8},  {"r9",  REG_R9},
+    {"r10", REG_R10}, {"r11", REG_R11}, {"r12", REG_R12}, {"r13", REG_R13},
+    {"r14", REG_R14}, {"r15", REG_R15}, {"err", REG_ERR}, {"trapno", REG_TRAPNO},
+    {"cr2", REG_CR2},
+};
+
+static void context_registers(const ucontext_t* uc, unsigned long* pc, unsigned long* sp, unsigned long* fp) {
+    *pc = uc->uc_mcontext.gregs[REG_RIP];
+    *sp = uc->uc_mcontext.gregs[REG_RSP];
+    *fp = uc->uc_mcontext.gregs[REG_RBP];
+}
+
+static void write_registers(sig_writer_t* w, const ucontext_t* uc) {
+    int n = sizeof(register_table) / sizeof(register_table[0]);
+    for (int i = 0; i < n; i++) {
+        sig_str(w, "  ");
+        sig_str(w, register_table[i].name);
+        sig_str(w, "=");
+        sig_hex(w, (unsigned long)uc->uc_mcontext.gregs[register_table[i].reg]);
+        if (i % 4 == 3 || i == n - 1) sig_str(w, "\n");
+    }
+}
+#elif defined(__aarch64__)
+static void context_registers(const ucontext_t* uc, unsigned long* pc, unsigned long* sp, unsigned long* fp) {
+    *pc = uc->uc_mcontext.pc;
+    *sp = uc->uc_mcontext.sp;
+    *fp = uc->uc_mcontext.regs[29];
+}
+
+static void write_registers(sig_writer_t* w, const ucontext_t* uc) {
+    sig_str(w, "  pc=");
+    sig_hex(w, uc->uc_mcontext.pc);
+    sig_str(w, "  sp=");
+    sig_hex(w, uc->uc_mcontext.sp);
+    sig_str(w, "  pstate=");
+    sig_hex(w, uc->uc_mcontext.pstate);
+    sig_str(w, "\n");
+    for (int i = 0; i < 31; i++) {
+        sig_str(w, "  x");
+        sig_dec(w, i);
+        sig_str(w, "=");
+        sig_hex(w, uc->uc_mcontext.regs[i]);
+        if (i % 4 == 3 || i == 30) sig_str(w, "\n");
+    }
+}
+#else
+static void context_registers(const ucontext_t* uc, unsigned long* pc, unsigned long* sp, unsigned long* fp) {
+    (void)uc;
+    *pc = *sp = *fp = 0;
+}
+
+static void write_registers(sig_writer_t* w, const ucontext_t* uc) {
+    (void)uc;
+    sig_str(w, "  (arquitetura sem suporte)\n");
+}
+#endif
+
+// Lê memória do próprio processo sem risco de uma nova falha
+static int safe_read(unsigned long addr, void* dst, size_t size) {
+    struct iovec local = {dst, size};
+    struct iovec remote = {(void*)addr, size};
+    return process_vm_readv(getpid(), &local, 1, &remote, 1, 0) == (ssize_t)size ? 0 : -1;
+}
+
+// Segue a cadeia de frame records [fp anterior, endereço de retorno]
+static void collect_frames(unsigned long pc, unsigned long fp) {
+    frame_count = 0;
+    frames[frame_count++].pc = pc;
+
+    while (frame_count < MAX_FRAMES && fp && (fp & (sizeof(void*) - 1)) == 0) {
+        unsigned long record[2];
+        if (safe_read(fp, record, sizeof(record)) < 0 || record[1] == 0) {
+            break;
+        }
+        frames[frame_count++].pc = record[1];
+        if (record[0] <= fp) {
+            break; // a pilha cresce para baixo: frames anteriores ficam acima
+        }
+        fp = record[0];
+    }
+}
+
+/* ---- trecho de /proc/self/maps ---- */
+
+static unsigned long parse_hex(const char** p) {
+    unsigned long v = 0;
+    for (;;) {
+        char c = **p;
+        if (c >= '0' && c <= '9') v = v * 16 + (c - '0');
+        else if (c >= 'a' && c <= 'f') v = v * 16 + (c - 'a' + 10);
+        else break;
+        (*p)++;
+    }
+    return v;
+}
+
+static void process_maps_line(const char* line, int len, unsigned long fault_addr, unsigned long sp) {
+    const char* p = line;
+    unsigned long start = parse_hex(&p);
+    p++; // '-'
+    unsigned long end = parse_hex(&p);
+    p += 6; // " rwxp "
+    unsigned long offset = parse_hex(&p);
+
+    // Caminho: sexto campo, depois de dev e inode
+    const char* path = line;
+    int fields = 0;
+    for (int i = 0; i < len && fields < 5; i++) {
+        if (line[i] == ' ' && (i + 1 < len && line[i + 1] != ' ')) {
+            fields++;
+            path = line + i + 1;
+        }
+    }
+    int path_len = fields == 5 ? (int)(line + len - path) : 0;
+
+    int interesting = (fault_addr >= start && fault_addr < end) || (sp >= start && sp < end);
+    for (int i = 0; i < frame_count; i++) {
+        if (frames[i].pc >= start && frames[i].pc < end) {
+            interesting = 1;
+            frames[i].module_offset = frames[i].pc - start + offset;
+            int n = path_len < MAX_MODULE_PATH - 1 ? path_len : MAX_MODULE_PATH - 1;
+            memcpy(frames[i].module, path, n);
+            frames[i].module[n] = '\0';
+        }
+    }
+
+    if (interesting && excerpt_len + len + 3 < EXCERPT_SIZE) {
+        excerpt[excerpt_len++] = ' ';
+        excerpt[excerpt_len++] = ' ';
+        memcpy(excerpt + excerpt_len, line, len);
+        excerpt_len += len;
+        excerpt[excerpt_len++] = '\n';
+    }
+}
+
+static void scan_maps(unsigned long fault_addr, unsigned long sp) {
+    static char chunk[4096];
+    static char line[512];
+    int line_len = 0;
+
+    excerpt_len = 0;
+    int fd = open("/proc/self/maps", O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    ssize_t n;
+    while ((n = read(fd, chunk, sizeof(chunk))) > 0) {
+        for (ssize_t i = 0; i < n; i++) {
+            if (chunk[i] == '\n') {
+                process_maps_line(line, line_len, fault_addr, sp);
+                line_len = 0;
+            } else if (line_len < (int)sizeof(line)) {
+                line[line_len++] = chunk[i];
+            }
+        }
+    }
+    close(fd);
+}
+
+/* ---- política de core ---- */
+
+// Aplicada só na falha: em operação normal nada muda no processo
+static void apply_core_policy() {
+    if (core_filter[0]) {
+        int fd = open("/proc/self/coredump_filter", O_WRONLY);
+        if (fd >= 0) {
+            ssize_t written = write(fd, core_filter, strlen(core_filter));
+            (void)written; // filtro inválido: o kernel mantém o anterior
+            close(fd);
+        }
+    }
+    if (dontdump) {
+        for (int i = 0; i < bulk_count; i++) {
+            madvise(bulk_regions[i].addr, bulk_regions[i].len, MADV_DONTDUMP);
+        }
+    }
+}
+
+/* ---- tratador ---- */
+
+static int open_dump_file(char* path, size_t size) {
+    sig_writer_t name = {.fd = -1};
+    sig_str(&name, dump_dir);
+    sig_str(&name, "/crash-");
+    sig_dec(&name, getpid());
+    sig_str(&name, ".mdmp");
+    if (name.len >= (int)sizeof(name.buf) - 1 || name.len >= (int)size) {
+        return -1; // truncado
+    }
+    memcpy(path, sig_text(&name), name.len + 1);
+    return open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+}
+
+static void crash_handler(int sig, siginfo_t* info, void* context) {
+    long start_ns = monotonic_ns();
+    const ucontext_t* uc = context;
+
+    unsigned long pc, sp, fp;
+    context_registers(uc, &pc, &sp, &fp);
+    unsigned long fault_addr = (unsigned long)info->si_addr;
+
+    collect_frames(pc, fp);
+    for (int i = 0; i < frame_count; i++) {
+        frames[i].module[0] = '\0';
+    }
+    scan_maps(fault_addr, sp);
+
+    char path[1100];
+    out.fd = dump_to_stderr ? -1 : open_dump_file(path, sizeof(path));
+    int to_file = out.fd >= 0;
+    if (!to_file) {
+        out.fd = STDERR_FILENO;
+    }
+    out.len = 0;
+    out.total = 0;
+
+    sig_str(&out, "=== MINIDUMP ===\npid ");
+    sig_dec(&out, getpid());
+    sig_str(&out, " tid ");
+    sig_dec(&out, gettid());
+    sig_str(&out, "\nsinal ");
+    sig_dec(&out, sig);
+    sig_str(&out, " (");
+    sig_str(&out, signal_name(sig));
+    sig_str(&out, ") si_code ");
+    sig_dec(&out, info->si_code);
+    sig_str(&out, " endereço ");
+    sig_hex(&out, fault_addr);
+
+    sig_str(&out, "\nregistradores:\n");
+    write_registers(&out, uc);
+
+    sig_str(&out, "backtrace:\n");
+    for (int i = 0; i < frame_count; i++) {
+        sig_str(&out, "  #");
+        sig_dec(&out, i);
+        sig_str(&out, " ");
+        sig_hex(&out, frames[i].pc);
+        if (frames[i].module[0]) {
+            sig_str(&out, " ");
+            sig_str(&out, frames[i].module);
+            sig_str(&out, "+");
+            sig_hex(&out, frames[i].module_offset);
+        }
+        sig_str(&out, "\n");
+    }
+
+    sig_str(&out, "maps (regiões com o endereço da falha, a pilha e o backtrace):\n");
+    sig_bytes(&out, excerpt, excerpt_len);
+    sig_flush(&out);
+
+    long bytes = out.total;
+    if (to_file) {
+        close(out.fd);
+    }
+    long elapsed_ns = monotonic_ns() - start_ns;
+
+    sig_writer_t summary = {.fd = STDERR_FILENO};
+    sig_str(&summary, "[crash_handler] ");
+    sig_str(&summary, signal_name(sig));
+    sig_str(&summary, " em ");
+    sig_hex(&summary, fault_addr);
+    sig_str(&summary, ": minidump ");
+    sig_str(&summary, to_file ? path : "(stderr)");
+    sig_str(&summary, ", ");
+    sig_dec(&summary, bytes);
+    sig_str(&summary, " bytes, escrito em ");
+    sig_dec(&summary, elapsed_ns / 1000);
+    sig_str(&summary, " us\n");
+    sig_flush(&summary);
+
+    if (crash_hook) {
+        crash_hook(STDERR_FILENO);
+    }
+
+    if (chain_core) {
+        // Falha de hardware: ao retornar, a instrução falha de novo com o
+        // siginfo original e a ação padrão gera o core. Sinal enviado (abort,
+        // kill): reenvia, e ele fica pendente até o tratador retornar.
+        apply_core_policy();
+        sig_chain(sig, info, context, NULL);
+        return;
+    }
+    _exit(sig);
+}
+
+int crash_handler_init(const char* dir) {
+    stack_t alt;
+    alt.ss_sp = mmap(NULL, ALT_STACK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (alt.ss_sp == MAP_FAILED) {
+        return -1;
+    }
+    alt.ss_size = ALT_STACK_SIZE;
+    alt.ss_flags = 0;
+    if (sigaltstack(&alt, NULL) < 0) {
+        return -1;
+    }
+
+    const char* env = getenv("CRASH_DUMP_DIR");
+    if (!dir) {
+        dir = env;
+    }
+    if (dir) {
+        strncpy(dump_dir, dir, sizeof(dump_dir) - 1);
+        dump_to_stderr = 0;
+    } else {
+        struct rlimit core_limit;
+        dump_to_stderr = getrlimit(RLIMIT_CORE, &core_limit) == 0 && core_limit.rlim_cur == 0;
+    }
+
+    const char* chain = getenv("CRASH_CORE");
+    chain_core = chain && strcmp(chain, "1") == 0;
+    const char* filter = getenv("CORE_FILTER");
+    if (filter) {
+        strncpy(core_filter, filter, sizeof(core_filter) - 1);
+    }
+    const char* skip = getenv("CORE_DONTDUMP");
+    dontdump = skip && strcmp(skip, "1") == 0;
+    return 0;
+}
+
+void crash_handler_set_hook(void (*hook)(int fd)) {
+    crash_hook = hook;
+}
+
+void crash_handler_register_bulk(void* addr, size_t len) {
+    if (bulk_count < MAX_BULK_REGIONS) {
+        bulk_regions[bulk_count].addr = addr;
+        bulk_regions[bulk_count].len = len;
+        bulk_count++;
+    }
+}
+
+void crash_handler_watch(int sig) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = crash_handler;
+    // SA_RESETHAND: uma falha dentro do próprio tratador cai na ação padrão
+    sa.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_RESETHAND;
+    sigemptyset(&sa.sa_mask);
+    sigaction(sig, &sa, NULL);
+}
@@ -0,0 +1,46 @@
+/*
+ * Tratador de falhas com pilha alternativa e minidump
+ *
+ * Substitui o par signal()+printf()+exit() por um tratador instalado com
+ * sigaction(SA_SIGINFO | SA_ONSTACK) que só usa chamadas seguras em
+ * contexto de sinal (open/write/close/clock_gettime/process_vm_readv).
+ * Como roda numa pilha alternativa (sigaltstack), funciona também quando
+ * a falha é o próprio estouro da pilha.
+ *
+ * O minidump é um arquivo texto de poucos KB com: sinal, si_code e
+ * endereço da falha, registradores do ucontext_t, backtrace pelos frame
+ * pointers (com módulo+offset de cada endereço) e o trecho de
+ * /proc/self/maps que contém esses endereços. Depois de escrito, o
+ * processo termina com _exit(número do sinal).
+ *
+ * Destino do minidump:
+ *   crash_handler_init(dir)        grava <dir>/crash-<pid>.mdmp
+ *   crash_handler_init(NULL)       usa CRASH_DUMP_DIR ou o diretório atual;
+ *                                  se RLIMIT_CORE for 0 e CRASH_DUMP_DIR não
+ *                                  estiver definido, escreve em stderr
+ *
+ * Política de core (lida em crash_handler_init e aplicada só na falha):
+ *   CRASH_CORE=1      depois do minidump, deixa o kernel gerar o core também
+ *   CORE_FILTER=0x13  valor escrito em /proc/self/coredump_filter
+ *   CORE_DONTDUMP=1   marca os buffers registrados com MADV_DONTDUMP
+ */
+
+#ifndef CRASH_HANDLER_H
+#define CRASH_HANDLER_H
+
+#include <stddef.h>
+
+// Aloca a pilha alternativa da thread atual e define o destino do minidump
+int crash_handler_init(const char* dump_dir);
+
+// Instala o tratador para um sinal (SIGSEGV, SIGFPE, SIGILL, SIGABRT, SIGBUS...)
+void crash_handler_watch(int sig);
+
+// Função chamada no tratador depois do minidump (deve ser segura em contexto
+// de sinal); recebe o descritor de stderr
+void crash_handler_set_hook(void (*hook)(int fd));
+
+// Registra um buffer grande (cache, dados recalculáveis) que pode ficar fora do core
+void crash_handler_register_bulk(void* addr, size_t len);
+
+#endif
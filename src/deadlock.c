@@ -7,12 +7,24 @@
 
  #include <stdio.h>
  #include <stdlib.h>
+ #include <string.h>
  #include <pthread.h>
  #include <unistd.h>
+ #include <time.h>
+ #include <stdatomic.h>
+ 
+ #include "lockdep.h"
+ #include "perf_counters.h"
+ #include "mutex_prof.h"
+ #include "evlog.h"
+ #include "trace.h"
+ #include "workload.h"
+ #include "stack_probe.h"
  
  // Dois mutex para demonstrar deadlock clássico
- pthread_mutex_t mutex_a = PTHREAD_MUTEX_INITIALIZER;
- pthread_mutex_t mutex_b = PTHREAD_MUTEX_INITIALIZER;
+ // (instrumentados: o lockdep detecta o ciclo em vez de travar para sempre)
+ lockdep_mutex_t mutex_a = LOCKDEP_MUTEX_INITIALIZER("mutex_a");
+ lockdep_mutex_t mutex_b = LOCKDEP_MUTEX_INITIALIZER("mutex_b");
  
  // Recursos compartilhados protegidos pelos mutex
  int resource_a = 0;
@@ -24,97 +36,116 @@
  
  void* thread_function_1(void* arg) {
      thread_data_t* data = (thread_data_t*)arg;
+     perf_thread_begin("thread_1");
+     trace_thread_begin("thread_1");
+     stack_probe_thread_begin("thread_1");
      
-     printf("Thread %d: Tentando adquirir mutex A...\n", data->thread_id);
-     pthread_mutex_lock(&mutex_a);
-     printf("Thread %d: Mutex A adquirido!\n", data->thread_id);
+     evlog("Thread %d: Tentando adquirir mutex A...\n", data->thread_id);
+     lockdep_lock(&mutex_a);
+     evlog("Thread %d: Mutex A adquirido!\n", data->thread_id);
      
      resource_a++;
-     printf("Thread %d: Modificando recurso A = %d\n", data->thread_id, resource_a);
+     evlog("Thread %d: Modificando recurso A = %d\n", data->thread_id, resource_a);
      
      // Simula algum processamento
      sleep(2);
      
-     printf("Thread %d: Tentando adquirir mutex B...\n", data->thread_id);
-     pthread_mutex_lock(&mutex_b); // DEADLOCK! Thread 2 já tem mutex_b
-     printf("Thread %d: Mutex B adquirido!\n", data->thread_id);
+     evlog("Thread %d: Tentando adquirir mutex B...\n", data->thread_id);
+     lockdep_lock(&mutex_b); // DEADLOCK! Thread 2 já tem mutex_b
+     evlog("Thread %d: Mutex B adquirido!\n", data->thread_id);
      
      resource_b++;
-     printf("Thread %d: Modificando recurso B = %d\n", data->thread_id, resource_b);
+     evlog("Thread %d: Modificando recurso B = %d\n", data->thread_id, resource_b);
      
-     pthread_mutex_unlock(&mutex_b);
-     pthread_mutex_unlock(&mutex_a);
+     lockdep_unlock(&mutex_b);
+     lockdep_unlock(&mutex_a);
      
-     printf("Thread %d: Finalizando\n", data->thread_id);
+     evlog("Thread %d: Finalizando\n", data->thread_id);
+     stack_probe_thread_end();
+     trace_thread_end();
+     perf_thread_end();
      return NULL;
  }
  
  void* thread_function_2(void* arg) {
      thread_data_t* data = (thread_data_t*)arg;
+     perf_thread_begin("thread_2");
+     trace_thread_begin("thread_2");
+     stack_probe_thread_begin("thread_2");
      
-     printf("Thread %d: Tentando adquirir mutex B...\n", data->thread_id);
-     pthread_mutex_lock(&mutex_b);
-     printf("Thread %d: Mutex B adquirido!\n", data->thread_id);
+     evlog("Thread %d: Tentando adquirir mutex B...\n", data->thread_id);
+     lockdep_lock(&mutex_b);
+     evlog("Thread %d: Mutex B adquirido!\n", data->thread_id);
      
      resource_b += 10;
-     printf("Thread %d: Modificando recurso B = %d\n", data->thread_id, resource_b);
+     evlog("Thread %d: Modificando recurso B = %d\n", data->thread_id, resource_b);
      
      // Simula algum processamento
      sleep(2);
      
-     printf("Thread %d: Tentando adquirir mutex A...\n", data->thread_id);
-     pthread_mutex_lock(&mutex_a); // DEADLOCK! Thread 1 já tem mutex_a
-     printf("Thread %d: Mutex A adquirido!\n", data->thread_id);
+     evlog("Thread %d: Tentando adquirir mutex A...\n", data->thread_id);
+     lockdep_lock(&mutex_a); // DEADLOCK! Thread 1 já tem mutex_a
+     evlog("Thread %d: Mutex A adquirido!\n", data->thread_id);
      
      resource_a += 10;
-     printf("Thread %d: Modificando recurso A = %d\n", data->thread_id, resource_a);
+     evlog("Thread %d: Modificando recurso A = %d\n", data->thread_id, resource_a);
      
-     pthread_mutex_unlock(&mutex_a);
-     pthread_mutex_unlock(&mutex_b);
+     lockdep_unlock(&mutex_a);
+     lockdep_unlock(&mutex_b);
      
-     printf("Thread %d: Finalizando\n", data->thread_id);
+     evlog("Thread %d: Finalizando\n", data->thread_id);
+     stack_probe_thread_end();
+     trace_thread_end();
+     perf_thread_end();
      return NULL;
  }
  
  // Deadlock mais complexo com múltiplos recursos
- pthread_mutex_t mutex_pool[5] = {
-     PTHREAD_MUTEX_INITIALIZER,
-     PTHREAD_MUTEX_INITIALIZER,
-     PTHREAD_MUTEX_INITIALIZER,
-     PTHREAD_MUTEX_INITIALIZER,
-     PTHREAD_MUTEX_INITIALIZER
+ lockdep_mutex_t mutex_pool[5] = {
+     LOCKDEP_MUTEX_INITIALIZER("mutex_pool[0]"),
+     LOCKDEP_MUTEX_INITIALIZER("mutex_pool[1]"),
+     LOCKDEP_MUTEX_INITIALIZER("mutex_pool[2]"),
+     LOCKDEP_MUTEX_INITIALIZER("mutex_pool[3]"),
+     LOCKDEP_MUTEX_INITIALIZER("mutex_pool[4]")
  };
  
  void* complex_deadlock_thread(void* arg) {
      thread_data_t* data = (thread_data_t*)arg;
+     perf_thread_begin("complexa");
+     trace_thread_begin("complexa");
+     stack_probe_thread_begin("complexa");
+     workload_pin_thread(data->thread_id);
      int first_mutex = data->thread_id % 5;
      int second_mutex = (data->thread_id + 2) % 5;
      int third_mutex = (data->thread_id + 3) % 5;
      
-     printf("Thread %d: Tentando adquirir mutex %d, %d, %d\n", 
+     evlog("Thread %d: Tentando adquirir mutex %d, %d, %d\n", 
             data->thread_id, first_mutex, second_mutex, third_mutex);
      
      // Adquire os mutex em ordem que pode causar deadlock
-     pthread_mutex_lock(&mutex_pool[first_mutex]);
-     printf("Thread %d: Adquiriu mutex %d\n", data->thread_id, first_mutex);
+     lockdep_lock(&mutex_pool[first_mutex]);
+     evlog("Thread %d: Adquiriu mutex %d\n", data->thread_id, first_mutex);
      sleep(1);
      
-     pthread_mutex_lock(&mutex_pool[second_mutex]);
-     printf("Thread %d: Adquiriu mutex %d\n", data->thread_id, second_mutex);
+     lockdep_lock(&mutex_pool[second_mutex]);
+     evlog("Thread %d: Adquiriu mutex %d\n", data->thread_id, second_mutex);
      sleep(1);
      
-     pthread_mutex_lock(&mutex_pool[third_mutex]);
-     printf("Thread %d: Adquiriu mutex %d\n", data->thread_id, third_mutex);
+     lockdep_lock(&mutex_pool[third_mutex]);
+     evlog("Thread %d: Adquiriu mutex %d\n", data->thread_id, third_mutex);
      
      // Simula trabalho crítico
      sleep(2);
      
      // Libera os mutex
-     pthread_mutex_unlock(&mutex_pool[third_mutex]);
-     pthread_mutex_unlock(&mutex_pool[second_mutex]);
-     pthread_mutex_unlock(&mutex_pool[first_mutex]);
-     
-     printf("Thread %d: Liberou todos os mutex\n", data->thread_id);
+     lockdep_unlock(&mutex_pool[third_mutex]);
+     lockdep_unlock(&mutex_pool[second_mutex]);
+     lockdep_unlock(&mutex_pool[first_mutex]);
+     
+     evlog("Thread %d: Liberou todos os mutex\n", data->thread_id);
+     stack_probe_thread_end();
+     trace_thread_end();
+     perf_thread_end();
      return NULL;
  }
  
@@ -127,12 +158,12 @@
      printf("Criando duas threads que adquirem mutex em ordem diferente...\n");
      
      // Cria as duas threads que causarão deadlock
-     if (pthread_create(&thread1, NULL, thread_function_1, &data1) != 0) {
+     if (pthread_create(&thread1, stack_probe_attr(), thread_function_1, &data1) != 0) {
          perror("Erro ao criar thread 1");
          exit(1);
      }
      
-     if (pthread_create(&thread2, NULL, thread_function_2, &data2) != 0) {
+     if (pthread_create(&thread2, stack_probe_attr(), thread_function_2, &data2) != 0) {
          perror("Erro ao criar thread 2");
          exit(1);
      }
@@ -146,7 +177,7 @@
  }
  
  void test_complex_deadlock() {
-     const int num_threads = 5;
+     const int num_threads = workload_threads(5) < LOCKDEP_MAX_THREADS ? workload_threads(5) : LOCKDEP_MAX_THREADS;
      pthread_t threads[num_threads];
      thread_data_t thread_data[num_threads];
      
@@ -157,7 +188,7 @@
      for (int i = 0; i < num_threads; i++) {
          thread_data[i].thread_id = i;
          
-         if (pthread_create(&threads[i], NULL, complex_deadlock_thread, &thread_data[i]) != 0) {
+         if (pthread_create(&threads[i], stack_probe_attr(), complex_deadlock_thread, &thread_data[i]) != 0) {
              perror("Erro ao criar thread");
              exit(1);
          }
@@ -172,10 +203,381 @@
      }
  }
  
+ // Mesmas duas funções, mas uma thread só começa depois da outra terminar:
+ // não trava, e mesmo assim o lockdep aponta a inversão A->B / B->A
+ void test_order_inversion() {
+     pthread_t thread1, thread2;
+     thread_data_t data1 = {1};
+     thread_data_t data2 = {2};
+     
+     printf("=== TESTE 3: INVERSÃO DE ORDEM SEM DEADLOCK ===\n");
+     printf("Executando as threads uma depois da outra...\n");
+     
+     if (pthread_create(&thread1, stack_probe_attr(), thread_function_1, &data1) != 0) {
+         perror("Erro ao criar thread 1");
+         exit(1);
+     }
+     pthread_join(thread1, NULL);
+     evlog_flush();
+     
+     if (pthread_create(&thread2, stack_probe_attr(), thread_function_2, &data2) != 0) {
+         perror("Erro ao criar thread 2");
+         exit(1);
+     }
+     pthread_join(thread2, NULL);
+     evlog_flush();
+     
+     lockdep_print_order_graph();
+ }
+ 
+ static double now_ns() {
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return ts.tv_sec * 1e9 + ts.tv_nsec;
+ }
+ 
+ // Custo do lock/unlock sem disputa: pthread puro x camada instrumentada
+ void test_lockdep_overhead(long iterations) {
+     pthread_mutex_t plain_outer = PTHREAD_MUTEX_INITIALIZER;
+     pthread_mutex_t plain_inner = PTHREAD_MUTEX_INITIALIZER;
+     // static: lockdep e mutex_prof guardam o endereço do lock até o fim
+     static lockdep_mutex_t outer = LOCKDEP_MUTEX_INITIALIZER("bench_outer");
+     static lockdep_mutex_t inner = LOCKDEP_MUTEX_INITIALIZER("bench_inner");
+     
+     printf("=== TESTE 4: CUSTO DO LOCKDEP SEM DISPUTA ===\n");
+     printf("%ld pares lock/unlock por medição\n\n", iterations);
+     
+     double start = now_ns();
+     for (long i = 0; i < iterations; i++) {
+         pthread_mutex_lock(&plain_outer);
+         pthread_mutex_unlock(&plain_outer);
+     }
+     double plain_single = (now_ns() - start) / iterations;
+     
+     start = now_ns();
+     for (long i = 0; i < iterations; i++) {
+         lockdep_lock(&outer);
+         lockdep_unlock(&outer);
+     }
+     double lockdep_single = (now_ns() - start) / iterations;
+     
+     // Aninhado: exercita a checagem do grafo de ordem a cada aquisição
+     start = now_ns();
+     for (long i = 0; i < iterations; i++) {
+         pthread_mutex_lock(&plain_outer);
+         pthread_mutex_lock(&plain_inner);
+         pthread_mutex_unlock(&plain_inner);
+         pthread_mutex_unlock(&plain_outer);
+     }
+     double plain_nested = (now_ns() - start) / iterations;
+     
+     start = now_ns();
+     for (long i = 0; i < iterations; i++) {
+         lockdep_lock(&outer);
+         lockdep_lock(&inner);
+         lockdep_unlock(&inner);
+         lockdep_unlock(&outer);
+     }
+     double lockdep_nested = (now_ns() - start) / iterations;
+     
+     printf("%-22s %12s %12s %10s\n", "caso", "pthread(ns)", "lockdep(ns)", "overhead");
+     printf("%-22s %12.1f %12.1f %9.0f%%\n", "1 lock", plain_single, lockdep_single,
+            (lockdep_single / plain_single - 1) * 100);
+     printf("%-22s %12.1f %12.1f %9.0f%%\n", "2 locks aninhados", plain_nested, lockdep_nested,
+            (lockdep_nested / plain_nested - 1) * 100);
+ }
+ 
+ /*
+  * Estratégias para evitar o deadlock de complex_deadlock_thread: cada
+  * thread continua pegando três recursos em rodízio, mas por um tempo fixo
+  * e com trabalho configurável no lugar dos sleep().
+  */
+ 
+ typedef enum {
+     AVOID_ORDERED,  // ordem global: sempre do menor para o maior índice
+     AVOID_BACKOFF,  // trylock + recuo exponencial aleatório
+     AVOID_ARBITER,  // gerenciador único concede os três recursos de uma vez
+     AVOID_STRATEGY_COUNT
+ } avoid_strategy_t;
+ 
+ static const char* avoid_strategy_names[AVOID_STRATEGY_COUNT] = {
+     "ordered", "backoff", "arbiter"
+ };
+ 
+ #define MAX_AVOID_THREADS 256
+ 
+ static pthread_mutex_t* avoid_pool = NULL;
+ static int avoid_resources = 0;
+ static atomic_int avoid_running = 0;
+ 
+ // Estado do árbitro: quais recursos estão ocupados
+ static pthread_mutex_t arbiter_lock = PTHREAD_MUTEX_INITIALIZER;
+ static pthread_cond_t arbiter_cond = PTHREAD_COND_INITIALIZER;
+ static char* arbiter_busy = NULL;
+ 
+ typedef struct {
+     int thread_id;
+     avoid_strategy_t strategy;
+     long work_ns;
+     long completed;
+     long retries;
+     double* waits_ns;   // latência de cada aquisição dos três recursos
+     long wait_count;
+     long wait_capacity;
+ } avoid_data_t;
+ 
+ // Trabalho ocupando a CPU (substitui o sleep sem liberar o processador)
+ static void busy_work(long ns) {
+     double end = now_ns() + ns;
+     while (now_ns() < end) {
+     }
+ }
+ 
+ static void record_wait(avoid_data_t* data, double wait_ns) {
+     if (data->wait_count == data->wait_capacity) {
+         data->wait_capacity = data->wait_capacity ? data->wait_capacity * 2 : 4096;
+         data->waits_ns = realloc(data->waits_ns, data->wait_capacity * sizeof(double));
+         if (!data->waits_ns) {
+             perror("Erro ao alocar amostras");
+             exit(1);
+         }
+     }
+     data->waits_ns[data->wait_count++] = wait_ns;
+ }
+ 
+ static void sort3(int r[3]) {
+     for (int i = 0; i < 2; i++) {
+         for (int j = 0; j < 2 - i; j++) {
+             if (r[j] > r[j + 1]) {
+                 int tmp = r[j];
+                 r[j] = r[j + 1];
+                 r[j + 1] = tmp;
+             }
+         }
+     }
+ }
+ 
+ static void acquire_backoff(avoid_data_t* data, int r[3], unsigned int* seed) {
+     long backoff_ns = 1000;
+     
+     for (;;) {
+         pthread_mutex_lock(&avoid_pool[r[0]]);
+         if (pthread_mutex_trylock(&avoid_pool[r[1]]) == 0) {
+             if (pthread_mutex_trylock(&avoid_pool[r[2]]) == 0) {
+                 return;
+             }
+             pthread_mutex_unlock(&avoid_pool[r[1]]);
+         }
+         pthread_mutex_unlock(&avoid_pool[r[0]]);
+         
+         // Libera tudo e espera um tempo aleatório antes de tentar de novo
+         data->retries++;
+         struct timespec pause = {0, rand_r(seed) % backoff_ns};
+         nanosleep(&pause, NULL);
+         if (backoff_ns < 1000000) {
+             backoff_ns *= 2;
+         }
+     }
+ }
+ 
+ static void acquire_arbiter(avoid_data_t* data, int r[3]) {
+     pthread_mutex_lock(&arbiter_lock);
+     while (arbiter_busy[r[0]] || arbiter_busy[r[1]] || arbiter_busy[r[2]]) {
+         pthread_cond_wait(&arbiter_cond, &arbiter_lock);
+         data->retries++;
+     }
+     arbiter_busy[r[0]] = arbiter_busy[r[1]] = arbiter_busy[r[2]] = 1;
+     pthread_mutex_unlock(&arbiter_lock);
+ }
+ 
+ static void release_arbiter(int r[3]) {
+     pthread_mutex_lock(&arbiter_lock);
+     arbiter_busy[r[0]] = arbiter_busy[r[1]] = arbiter_busy[r[2]] = 0;
+     pthread_cond_broadcast(&arbiter_cond);
+     pthread_mutex_unlock(&arbiter_lock);
+ }
+ 
+ void* avoidance_thread(void* arg) {
+     avoid_data_t* data = (avoid_data_t*)arg;
+     unsigned int seed = (unsigned int)data->thread_id * 2654435761u + 7;
+     perf_thread_begin("evitação");
+     trace_thread_begin("evitação");
+     stack_probe_thread_begin("evitação");
+     workload_pin_thread(data->thread_id);
+     long work = workload.work;
+     
+     for (long round = 0; atomic_load_explicit(&avoid_running, memory_order_relaxed); round++) {
+         // Mesmo padrão de complex_deadlock_thread (id, id+2, id+3), girando a cada rodada
+         int base = data->thread_id + (int)round;
+         int r[3] = {
+             base % avoid_resources,
+             (base + 2) % avoid_resources,
+             (base + 3) % avoid_resources
+         };
+         
+         if (work) workload_spin(work); // trabalho fora da seção crítica
+         
+         double start = now_ns();
+         switch (data->strategy) {
+             case AVOID_ORDERED:
+                 sort3(r);
+                 pthread_mutex_lock(&avoid_pool[r[0]]);
+                 pthread_mutex_lock(&avoid_pool[r[1]]);
+                 pthread_mutex_lock(&avoid_pool[r[2]]);
+                 break;
+             case AVOID_BACKOFF:
+                 acquire_backoff(data, r, &seed);
+                 break;
+             case AVOID_ARBITER:
+                 acquire_arbiter(data, r);
+                 break;
+             default:
+                 break;
+         }
+         record_wait(data, now_ns() - start);
+         
+         // Seção crítica com os três recursos
+         busy_work(data->work_ns);
+         data->completed++;
+         
+         if (data->strategy == AVOID_ARBITER) {
+             release_arbiter(r);
+         } else {
+             pthread_mutex_unlock(&avoid_pool[r[2]]);
+             pthread_mutex_unlock(&avoid_pool[r[1]]);
+             pthread_mutex_unlock(&avoid_pool[r[0]]);
+         }
+     }
+     
+     stack_probe_thread_end();
+     trace_thread_end();
+     perf_thread_end();
+     return NULL;
+ }
+ 
+ static int compare_double(const void* a, const void* b) {
+     double x = *(const double*)a, y = *(const double*)b;
+     return (x > y) - (x < y);
+ }
+ 
+ static void run_avoidance(avoid_strategy_t strategy, int num_threads, int duration_ms, long work_ns) {
+     pthread_t threads[MAX_AVOID_THREADS];
+     avoid_data_t thread_data[MAX_AVOID_THREADS];
+     
+     memset(thread_data, 0, sizeof(thread_data));
+     memset(arbiter_busy, 0, avoid_resources);
+     atomic_store(&avoid_running, 1);
+     perf_phase_begin(avoid_strategy_names[strategy]);
+     
+     double start = now_ns();
+     for (int i = 0; i < num_threads; i++) {
+         thread_data[i].thread_id = i;
+         thread_data[i].strategy = strategy;
+         thread_data[i].work_ns = work_ns;
+         
+         if (pthread_create(&threads[i], stack_probe_attr(), avoidance_thread, &thread_data[i]) != 0) {
+             perror("Erro ao criar thread");
+             exit(1);
+         }
+     }
+     
+     usleep(duration_ms * 1000);
+     atomic_store(&avoid_running, 0);
+     
+     long completed = 0, retries = 0, samples = 0;
+     for (int i = 0; i < num_threads; i++) {
+         pthread_join(threads[i], NULL);
+         completed += thread_data[i].completed;
+         retries += thread_data[i].retries;
+         samples += thread_data[i].wait_count;
+     }
+     perf_phase_end();
+     double elapsed_s = (now_ns() - start) / 1e9;
+     
+     // Junta as latências de todas as threads para os percentis
+     double* waits = malloc((samples ? samples : 1) * sizeof(double));
+     if (!waits) {
+         perror("Erro ao alocar amostras");
+         exit(1);
+     }
+     long offset = 0;
+     for (int i = 0; i < num_threads; i++) {
+         memcpy(waits + offset, thread_data[i].waits_ns, thread_data[i].wait_count * sizeof(double));
+         offset += thread_data[i].wait_count;
+         free(thread_data[i].waits_ns);
+     }
+     qsort(waits, samples, sizeof(double), compare_double);
+     
+     double p50 = samples ? waits[samples / 2] : 0;
+     double p99 = samples ? waits[(long)(samples * 0.99)] : 0;
+     double max = samples ? waits[samples - 1] : 0;
+     
+     printf("%-9s %8d %9d %14.0f %10ld %10.3f %10.1f %10.1f %10.1f\n",
+            avoid_strategy_names[strategy], num_threads, avoid_resources,
+            completed / elapsed_s, retries, completed ? (double)retries / completed : 0,
+            p50 / 1e3, p99 / 1e3, max / 1e3);
+     workload_result("deadlock", avoid_strategy_names[strategy], num_threads, completed, elapsed_s, 0);
+     free(waits);
+ }
+ 
+ void test_deadlock_avoidance(const char* strategy, int num_threads, int resources,
+                              int duration_ms, long work_us) {
+     printf("=== TESTE 5: ESTRATÉGIAS PARA EVITAR DEADLOCK ===\n");
+     printf("%d threads, %d recursos, %d ms por estratégia, %ld us de trabalho na seção crítica\n\n",
+            num_threads, resources, duration_ms, work_us);
+     
+     avoid_resources = resources;
+     avoid_pool = malloc(resources * sizeof(pthread_mutex_t));
+     arbiter_busy = malloc(resources);
+     if (!avoid_pool || !arbiter_busy) {
+         perror("Erro ao alocar recursos");
+         exit(1);
+     }
+     for (int i = 0; i < resources; i++) {
+         pthread_mutex_init(&avoid_pool[i], NULL);
+     }
+     
+     printf("%-9s %8s %9s %14s %10s %10s %10s %10s %10s\n", "estratégia", "threads", "recursos",
+            "seções/s", "retries", "retry/seç", "p50(us)", "p99(us)", "max(us)");
+     
+     int ran = 0;
+     for (int s = 0; s < AVOID_STRATEGY_COUNT; s++) {
+         if (strcmp(strategy, "todas") == 0 || strcmp(strategy, avoid_strategy_names[s]) == 0) {
+             run_avoidance((avoid_strategy_t)s, num_threads, duration_ms, work_us * 1000);
+             ran++;
+         }
+     }
+     if (!ran) {
+         printf("Estratégia desconhecida: %s (use ordered, backoff, arbiter ou todas)\n", strategy);
+     }
+     
+     free(avoid_pool);
+     free(arbiter_busy);
+ }
+ 
+ static void report_before_exit() {
+     evlog_flush();
+     perf_counters_report();
+     mutex_prof_report();
+     stack_probe_report();
+ }
+ 
  int main(int argc, char *argv[]) {
      printf("=== DEMONSTRAÇÃO: DEADLOCKS ===\n");
      printf("Este programa demonstra diferentes tipos de deadlocks\n");
-     printf("AVISO: O programa pode travar indefinidamente!\n\n");
+     printf("AVISO: O programa pode travar indefinidamente!\n");
+     printf("(com LOCKDEP=0 o detector de deadlock fica desligado;\n");
+     printf(" com MUTEX_PROF=1, kill -USR2 %d mostra quem segura cada lock)\n\n", getpid());
+     
+     workload_init(&argc, argv);
+     lockdep_init();
+     perf_counters_init();
+     trace_init();
+     stack_probe_init();
+     mutex_prof_init();
+     evlog_init();
+     // O lockdep termina com _exit() ao achar um ciclo: imprime os relatórios antes
+     lockdep_set_report_hook(report_before_exit);
      
      int option = 1;
      if (argc > 1) {
@@ -184,13 +586,39 @@
      
      switch(option) {
          case 1:
+             perf_phase_begin("simples");
              test_simple_deadlock();
+             perf_phase_end();
              break;
          case 2:
+             perf_phase_begin("complexo");
              test_complex_deadlock();
+             perf_phase_end();
              break;
+         case 3:
+             test_order_inversion();
+             return 0;
+         case 4:
+             test_lockdep_overhead(argc > 2 ? atol(argv[2]) : 10000000);
+             return 0;
+         case 5: {
+             // Uso: deadlock 5 [estratégia] [threads] [recursos] [duração_ms] [trabalho_us]
+             const char* strategy = argc > 2 ? argv[2] : "todas";
+             int num_threads = workload_threads(argc > 3 ? atoi(argv[3]) : 5);
+             int resources = argc > 4 ? atoi(argv[4]) : 5;
+             int duration_ms = argc > 5 ? atoi(argv[5]) : 1000;
+             long work_us = argc > 6 ? atol(argv[6]) : 10;
+             if (num_threads < 1) num_threads = 1;
+             if (num_threads > MAX_AVOID_THREADS) num_threads = MAX_AVOID_THREADS;
+             if (resources < 4) resources = 4; // id, id+2 e id+3 precisam ser distintos
+             test_deadlock_avoidance(strategy, num_threads, resources, duration_ms, work_us);
+             return 0;
+         }
          default:
              printf("Opções: 1=deadlock simples, 2=deadlock complexo\n");
+             printf("        3=inversão de ordem sem deadlock, 4=custo do lockdep\n");
+             printf("        5=estratégias para evitar deadlock (ordered, backoff, arbiter)\n");
+             printf("Carga: --threads=N --work=N --pin[=cpus] --results=arquivo.tsv\n");
              test_simple_deadlock();
      }
      
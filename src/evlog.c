@@ -0,0 +1,387 @@
+/*
+ * Log de eventos por thread sem locks - implementação
+ *
+ * Cada anel tem um único produtor (a thread dona, que avança head) e é
+ * esvaziado pela thread de descarga (que avança tail). A descarga faz um
+ * merge por instante entre os anéis e formata direto num buffer na pilha
+ * com write(), o que deixa o mesmo código utilizável no tratador de sinal.
+ * No caminho de falha a descarga não espera a thread de descarga: um
+ * evento que ela já estava escrevendo pode sair duas vezes, mas nenhum
+ * evento publicado se perde.
+ */
+
+#define _GNU_SOURCE
+#include "evlog.h"
+#include "sigsafe.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#define EVLOG_MAX_ARGS 6
+#define EVLOG_MAX_THREADS 256
+#define FLUSH_INTERVAL_MS 10
+
+typedef struct {
+    uint64_t ts_ns;
+    const char* fmt;
+    uint64_t args[EVLOG_MAX_ARGS];
+    int tid;
+} record_t;
+
+typedef struct {
+    _Alignas(64) atomic_ulong head;  // só a thread dona escreve
+    _Alignas(64) atomic_ulong tail;  // só quem esvazia escreve
+    _Alignas(64) atomic_int alive;
+    int tid;
+    unsigned long dropped;
+    record_t* slots;
+} ring_t;
+
+static int enabled = 0;
+static int out_fd = STDOUT_FILENO;
+static unsigned long ring_size = 4096;
+static uint64_t start_ns;
+
+static ring_t* rings[EVLOG_MAX_THREADS];
+static atomic_int ring_count = 0;
+static __thread ring_t* self = NULL;
+static pthread_mutex_t attach_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t drain_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t exit_key;
+
+static pthread_t flusher;
+static atomic_int flusher_running = 0;
+
+static const int fatal_signals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+static struct sigaction previous[NSIG];
+
+static uint64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* ---- produtor ---- */
+
+static void thread_exit(void* arg) {
+    ring_t* r = arg;
+    atomic_store(&r->alive, 0);
+}
+
+static ring_t* attach() {
+    ring_t* r = NULL;
+
+    // Reaproveita o anel já esvaziado de uma thread que terminou
+    pthread_mutex_lock(&attach_lock);
+    int count = atomic_load(&ring_count);
+    for (int i = 0; i < count && !r; i++) {
+        ring_t* candidate = rings[i];
+        if (!atomic_load(&candidate->alive) &&
+            atomic_load(&candidate->head) == atomic_load(&candidate->tail)) {
+            r = candidate;
+        }
+    }
+    if (!r && count < EVLOG_MAX_THREADS) {
+        r = aligned_alloc(64, sizeof(ring_t));
+        record_t* slots = calloc(ring_size, sizeof(record_t));
+        if (r && slots) {
+            memset(r, 0, sizeof(ring_t));
+            r->slots = slots;
+            rings[count] = r;
+            atomic_store(&ring_count, count + 1);
+        } else {
+            free(r);
+            free(slots);
+            r = NULL;
+        }
+    }
+    if (r) {
+        r->tid = gettid();
+        atomic_store(&r->alive, 1);
+    }
+    pthread_mutex_unlock(&attach_lock);
+
+    if (r) {
+        self = r;
+        pthread_setspecific(exit_key, r);
+    }
+    return r;
+}
+
+// Lê os argumentos com o tipo que o formato indica (int, long, ponteiro)
+static void collect_args(const char* fmt, va_list ap, uint64_t args[EVLOG_MAX_ARGS]) {
+    int n = 0;
+    for (const char* p = fmt; *p && n < EVLOG_MAX_ARGS; p++) {
+        if (*p != '%') continue;
+        p++;
+        while (*p == '-' || *p == '+' || *p == ' ' || *p == '0' || *p == '#' || *p == '.' ||
+               (*p >= '1' && *p <= '9')) {
+            p++;
+        }
+        int longs = 0;
+        while (*p == 'l') {
+            longs++;
+            p++;
+        }
+        switch (*p) {
+            case 'd':
+            case 'i':
+                args[n++] = longs ? (uint64_t)va_arg(ap, long) : (uint64_t)(long)va_arg(ap, int);
+                break;
+            case 'u':
+            case 'x':
+            case 'c':
+                args[n++] = longs ? va_arg(ap, unsigned long) : va_arg(ap, unsigned int);
+                break;
+            case 's':
+            case 'p':
+                args[n++] = (uint64_t)(uintptr_t)va_arg(ap, void*);
+                break;
+            case '\0':
+                return;
+            default:
+                break; // %% e conversões desconhecidas não consomem argumento
+        }
+    }
+}
+
+void evlog(const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+
+    ring_t* r = enabled ? (self ? self : attach()) : NULL;
+    if (!r) {
+        vprintf(fmt, ap);
+        va_end(ap);
+        return;
+    }
+
+    unsigned long head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    unsigned long tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    if (head - tail >= ring_size) {
+        r->dropped++;
+        va_end(ap);
+        return;
+    }
+
+    record_t* rec = &r->slots[head & (ring_size - 1)];
+    rec->ts_ns = monotonic_ns();
+    rec->fmt = fmt;
+    rec->tid = r->tid;
+    collect_args(fmt, ap, rec->args);
+    va_end(ap);
+
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+}
+
+/* ---- formatação e descarga (seguras em contexto de sinal) ---- */
+
+static void format_record(sig_writer_t* w, const record_t* rec) {
+    uint64_t rel = rec->ts_ns > start_ns ? rec->ts_ns - start_ns : 0;
+    sig_str(w, "[+");
+    sig_unsigned(w, rel / 1000000000ULL, 10, 1);
+    sig_char(w, '.');
+    sig_unsigned(w, rel % 1000000000ULL / 1000, 10, 6);
+    sig_str(w, "] ");
+
+    int n = 0;
+    const char* p = rec->fmt;
+    for (; *p; p++) {
+        if (*p != '%') {
+            sig_char(w, *p);
+            continue;
+        }
+        p++;
+        while (*p == '-' || *p == '+' || *p == ' ' || *p == '0' || *p == '#' || *p == '.' ||
+               (*p >= '1' && *p <= '9')) {
+            p++;
+        }
+        int longs = 0;
+        while (*p == 'l') {
+            longs++;
+            p++;
+        }
+        if (*p == '\0') break;
+        if (*p == '%') {
+            sig_char(w, '%');
+            continue;
+        }
+        uint64_t v = n < EVLOG_MAX_ARGS ? rec->args[n++] : 0;
+        switch (*p) {
+            case 'd':
+            case 'i':
+                if ((int64_t)v < 0) {
+                    sig_char(w, '-');
+                    v = -(int64_t)v;
+                }
+                sig_unsigned(w, v, 10, 1);
+                break;
+            case 'u':
+                sig_unsigned(w, longs ? v : (uint32_t)v, 10, 1);
+                break;
+            case 'x':
+                sig_unsigned(w, longs ? v : (uint32_t)v, 16, 1);
+                break;
+            case 'p':
+                sig_hex(w, v);
+                break;
+            case 'c':
+                sig_char(w, (char)v);
+                break;
+            case 's':
+                sig_str(w, v ? (const char*)(uintptr_t)v : "(null)");
+                break;
+            default:
+                sig_char(w, '%');
+                sig_char(w, *p);
+                break;
+        }
+    }
+    if (w->buf[w->len - 1] != '\n') { // "[+" já saiu: len nunca é 0 aqui
+        sig_char(w, '\n');
+    }
+}
+
+// Merge pelos instantes: a cada passo sai o registro mais antigo entre os anéis
+static void drain(int fd) {
+    sig_writer_t out = {.fd = fd};
+    unsigned long pos[EVLOG_MAX_THREADS], limit[EVLOG_MAX_THREADS];
+
+    int count = atomic_load(&ring_count);
+    for (int i = 0; i < count; i++) {
+        pos[i] = atomic_load_explicit(&rings[i]->tail, memory_order_relaxed);
+        limit[i] = atomic_load_explicit(&rings[i]->head, memory_order_acquire);
+    }
+
+    for (;;) {
+        int best = -1;
+        uint64_t best_ts = 0;
+        for (int i = 0; i < count; i++) {
+            if (pos[i] == limit[i]) continue;
+            uint64_t ts = rings[i]->slots[pos[i] & (ring_size - 1)].ts_ns;
+            if (best < 0 || ts < best_ts) {
+                best = i;
+                best_ts = ts;
+            }
+        }
+        if (best < 0) break;
+
+        format_record(&out, &rings[best]->slots[pos[best] & (ring_size - 1)]);
+        pos[best]++;
+        atomic_store_explicit(&rings[best]->tail, pos[best], memory_order_release);
+    }
+    sig_flush(&out);
+}
+
+void evlog_crash_drain(int fd) {
+    if (enabled) {
+        drain(fd);
+    }
+}
+
+void evlog_flush() {
+    if (!enabled) {
+        return;
+    }
+    pthread_mutex_lock(&drain_lock);
+    if (out_fd == STDOUT_FILENO) {
+        fflush(stdout); // o que a thread principal já imprimiu sai antes
+    }
+    drain(out_fd);
+    pthread_mutex_unlock(&drain_lock);
+}
+
+static void* flusher_thread(void* arg) {
+    (void)arg;
+    struct timespec interval = {0, FLUSH_INTERVAL_MS * 1000000L};
+    while (atomic_load(&flusher_running)) {
+        nanosleep(&interval, NULL);
+        evlog_flush();
+    }
+    return NULL;
+}
+
+static void shutdown_at_exit() {
+    if (!enabled) {
+        return;
+    }
+    atomic_store(&flusher_running, 0);
+    pthread_join(flusher, NULL);
+    evlog_flush();
+
+    unsigned long dropped = 0;
+    int count = atomic_load(&ring_count);
+    for (int i = 0; i < count; i++) {
+        dropped += rings[i]->dropped;
+    }
+    if (dropped) {
+        fprintf(stderr, "[evlog] %lu eventos descartados com o anel cheio (aumente EVLOG_RING)\n", dropped);
+    }
+    if (out_fd != STDOUT_FILENO) {
+        close(out_fd);
+    }
+    enabled = 0;
+}
+
+// Esvazia os anéis e repassa o sinal para quem estava instalado antes
+static void crash_signal(int sig, siginfo_t* info, void* context) {
+    sig_writer_t banner = {.fd = out_fd};
+    sig_str(&banner, "\n[evlog] últimos eventos antes da falha:\n");
+    sig_flush(&banner);
+    evlog_crash_drain(out_fd);
+    enabled = 0;
+
+    sig_chain(sig, info, context, &previous[sig]);
+}
+
+void evlog_init() {
+    const char* env = getenv("EVLOG");
+    if (env && strcmp(env, "0") == 0) {
+        return;
+    }
+
+    const char* ring = getenv("EVLOG_RING");
+    if (ring) {
+        unsigned long wanted = strtoul(ring, NULL, 10);
+        ring_size = 16;
+        while (ring_size < wanted && ring_size < (1UL << 24)) ring_size <<= 1;
+    }
+    const char* path = getenv("EVLOG_OUT");
+    if (path) {
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+        if (fd < 0) {
+            perror("evlog: EVLOG_OUT");
+        } else {
+            out_fd = fd;
+        }
+    }
+
+    start_ns = monotonic_ns();
+    pthread_key_create(&exit_key, thread_exit);
+    enabled = 1;
+
+    atomic_store(&flusher_running, 1);
+    if (pthread_create(&flusher, NULL, flusher_thread, NULL) != 0) {
+        enabled = 0;
+        return;
+    }
+    atexit(shutdown_at_exit);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = crash_signal;
+    sa.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_RESETHAND;
+    sigemptyset(&sa.sa_mask);
+    for (int i = 0; i < (int)(sizeof(fatal_signals) / sizeof(fatal_signals[0])); i++) {
+        sigaction(fatal_signals[i], &sa, &previous[fatal_signals[i]]);
+    }
+}
@@ -0,0 +1,40 @@
+/*
+ * Log de eventos por thread sem locks
+ *
+ * Substitui printf nos laços das threads: evlog() só copia o instante
+ * (CLOCK_MONOTONIC), o tid, o ponteiro do formato (que é o id do evento)
+ * e os argumentos para um anel SPSC da própria thread. Uma thread de
+ * descarga junta os anéis em ordem de tempo e só então formata o texto,
+ * então as threads instrumentadas não disputam o lock do stdout e a
+ * intercalação observada não depende de a saída ser um terminal.
+ *
+ * O formato aceita %d %i %u %x %c %s %p e %% (com l/ll), sem largura
+ * nem precisão; %s precisa apontar para uma string que continue válida
+ * (literais, nomes estáticos).
+ *
+ * Ambiente:
+ *   EVLOG=0            volta ao printf síncrono, para comparar o efeito
+ *   EVLOG_OUT=arquivo  destino (padrão: stdout)
+ *   EVLOG_RING=N       registros por thread, potência de 2 (padrão 4096);
+ *                      com o anel cheio o evento é descartado e contado
+ *
+ * Se o processo receber SIGSEGV/SIGBUS/SIGFPE/SIGILL/SIGABRT, o tratador
+ * esvazia os anéis (só chamadas seguras em contexto de sinal) e depois
+ * repassa o sinal ao tratador instalado antes de evlog_init().
+ */
+
+#ifndef EVLOG_H
+#define EVLOG_H
+
+// Inicia a thread de descarga e registra a descarga final no atexit
+void evlog_init();
+
+void evlog(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+
+// Esvazia os anéis agora (antes de _exit, hooks de relatório)
+void evlog_flush();
+
+// Esvazia os anéis em fd; seguro em contexto de sinal
+void evlog_crash_drain(int fd);
+
+#endif
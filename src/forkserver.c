@@ -0,0 +1,381 @@
+/*
+ * Fork-server para milhares de execuções dos cenários
+ *
+ * Para estimar com que frequência cada erro acontece (quantas execuções
+ * da race condition perdem incrementos, quantas vezes "deadlock 2" trava)
+ * são necessárias milhares de execuções, e execve + ligação dinâmica +
+ * banner dominam o custo de cada uma. Como no forkserver do AFL, um
+ * processo servidor já inicializado (bibliotecas carregadas, saída
+ * redirecionada) recebe pedidos por um pipe, cria um filho com fork()
+ * que chama direto a função main do cenário e devolve pelo outro pipe o
+ * resultado de cada execução: sinal, código de saída e duração.
+ *
+ * Os oito arquivos src/<cenário>.c são ligados neste binário com main renomeada para
+ * scenario_<nome>_main (veja o Makefile).
+ *
+ * Uso: forkserver [-n execuções] [-j servidores] [-t prazo_ms] [-e dir_bin] [-v]
+ *                 <cenário> [argumentos...]
+ *   -e  modo de comparação: cada execução faz fork+exec de dir_bin/<cenário>
+ *   -v  imprime cada execução (TSV) assim que o resultado chega
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+typedef int (*scenario_main_t)(int argc, char** argv);
+
+int scenario_stack_overflow_main(int argc, char** argv);
+int scenario_segmentation_fault_main(int argc, char** argv);
+int scenario_buffer_overflow_main(int argc, char** argv);
+int scenario_memory_leak_main(int argc, char** argv);
+int scenario_race_condition_main(int argc, char** argv);
+int scenario_deadlock_main(int argc, char** argv);
+int scenario_core_dump_main(int argc, char** argv);
+int scenario_memory_pressure_main(int argc, char** argv);
+
+typedef struct {
+    const char* name;
+    scenario_main_t entry;
+} scenario_entry_t;
+
+// Registro de todos os pontos de entrada dos cenários
+static const scenario_entry_t registry[] = {
+    {"stack_overflow",     scenario_stack_overflow_main},
+    {"segmentation_fault", scenario_segmentation_fault_main},
+    {"buffer_overflow",    scenario_buffer_overflow_main},
+    {"memory_leak",        scenario_memory_leak_main},
+    {"race_condition",     scenario_race_condition_main},
+    {"deadlock",           scenario_deadlock_main},
+    {"core_dump",          scenario_core_dump_main},
+    {"memory_pressure",    scenario_memory_pressure_main},
+};
+
+#define REGISTRY_SIZE ((int)(sizeof(registry) / sizeof(registry[0])))
+#define MAX_SERVERS 64
+#define MAX_OUTCOMES 64
+
+// Registro binário enviado do servidor para o controlador
+typedef struct {
+    int trial;
+    int status;
+    int timed_out;
+    long duration_ns;
+} trial_result_t;
+
+typedef struct {
+    pid_t pid;
+    int command_fd;   // controlador -> servidor
+    int result_fd;    // servidor -> controlador
+    int busy;
+} server_t;
+
+typedef struct {
+    char label[32];
+    long count;
+    double total_ms;
+    double max_ms;
+} outcome_t;
+
+static long monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static int write_full(int fd, const void* buf, size_t size) {
+    const char* p = buf;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        size -= n;
+    }
+    return 0;
+}
+
+static int read_full(int fd, void* buf, size_t size) {
+    char* p = buf;
+    while (size > 0) {
+        ssize_t n = read(fd, p, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        size -= n;
+    }
+    return 0;
+}
+
+// Espera o filho até o prazo; SIGCHLD fica bloqueado e é consumido aqui
+static int wait_trial(pid_t child, long deadline_ns, int* status) {
+    sigset_t chld;
+    sigemptyset(&chld);
+    sigaddset(&chld, SIGCHLD);
+
+    for (;;) {
+        if (waitpid(child, status, WNOHANG) == child) {
+            return 0;
+        }
+
+        long remaining = deadline_ns - monotonic_ns();
+        if (remaining <= 0) {
+            kill(-child, SIGKILL);
+            waitpid(child, status, 0);
+            return 1;
+        }
+
+        struct timespec timeout = {remaining / 1000000000L, remaining % 1000000000L};
+        sigtimedwait(&chld, NULL, &timeout);
+    }
+}
+
+static void server_loop(int command_fd, int result_fd, const scenario_entry_t* scenario,
+                        const char* exec_path, int argc, char** argv, long timeout_ns) {
+    // Pré-inicialização feita uma vez: banners e saídas vão para /dev/null
+    int null_fd = open("/dev/null", O_RDWR);
+    dup2(null_fd, STDIN_FILENO);
+    dup2(null_fd, STDOUT_FILENO);
+    dup2(null_fd, STDERR_FILENO);
+    setenv("NO_COUNTDOWN", "1", 1);
+
+    struct rlimit no_core = {0, 0};
+    setrlimit(RLIMIT_CORE, &no_core);
+
+    sigset_t chld, old_mask;
+    sigemptyset(&chld);
+    sigaddset(&chld, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &chld, &old_mask);
+
+    int trial;
+    while (read_full(command_fd, &trial, sizeof(trial)) == 0 && trial >= 0) {
+        long start = monotonic_ns();
+        pid_t child = fork();
+
+        if (child == 0) {
+            setpgid(0, 0);
+            sigprocmask(SIG_SETMASK, &old_mask, NULL);
+            if (exec_path) {
+                execv(exec_path, argv);
+                _exit(127);
+            }
+            exit(scenario->entry(argc, argv));
+        }
+        if (child < 0) {
+            _exit(1);
+        }
+        setpgid(child, child);
+
+        trial_result_t result = {trial, 0, 0, 0};
+        result.timed_out = wait_trial(child, start + timeout_ns, &result.status);
+        result.duration_ns = monotonic_ns() - start;
+
+        if (write_full(result_fd, &result, sizeof(result)) < 0) {
+            break;
+        }
+    }
+    _exit(0);
+}
+
+static void outcome_label(const trial_result_t* r, char* buf, size_t size) {
+    if (r->timed_out) {
+        snprintf(buf, size, "prazo (travou)");
+    } else if (WIFSIGNALED(r->status)) {
+        snprintf(buf, size, "SIG%s", sigabbrev_np(WTERMSIG(r->status)));
+    } else {
+        snprintf(buf, size, "exit %d", WEXITSTATUS(r->status));
+    }
+}
+
+static void add_outcome(outcome_t* outcomes, int* count, const trial_result_t* r) {
+    char label[32];
+    outcome_label(r, label, sizeof(label));
+    double ms = r->duration_ns / 1e6;
+
+    for (int i = 0; i < *count; i++) {
+        if (strcmp(outcomes[i].label, label) == 0) {
+            outcomes[i].count++;
+            outcomes[i].total_ms += ms;
+            if (ms > outcomes[i].max_ms) outcomes[i].max_ms = ms;
+            return;
+        }
+    }
+    if (*count < MAX_OUTCOMES) {
+        outcome_t* o = &outcomes[(*count)++];
+        snprintf(o->label, sizeof(o->label), "%s", label);
+        o->count = 1;
+        o->total_ms = ms;
+        o->max_ms = ms;
+    }
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr, "Uso: %s [-n execuções] [-j servidores] [-t prazo_ms] [-e dir_bin] [-v] <cenário> [args...]\n", prog);
+    fprintf(stderr, "Cenários:");
+    for (int i = 0; i < REGISTRY_SIZE; i++) {
+        fprintf(stderr, " %s", registry[i].name);
+    }
+    fprintf(stderr, "\nExemplo: %s -n 1000 -t 3000 race_condition 1\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    long trials = 100;
+    int num_servers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    long timeout_ms = 5000;
+    const char* exec_dir = NULL;
+    int verbose = 0;
+    int opt;
+
+    // '+' para parar no nome do cenário e deixar os argumentos dele intactos
+    while ((opt = getopt(argc, argv, "+n:j:t:e:vh")) != -1) {
+        switch (opt) {
+            case 'n': trials = atol(optarg); break;
+            case 'j': num_servers = atoi(optarg); break;
+            case 't': timeout_ms = atol(optarg); break;
+            case 'e': exec_dir = optarg; break;
+            case 'v': verbose = 1; break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    const scenario_entry_t* scenario = NULL;
+    for (int i = 0; i < REGISTRY_SIZE; i++) {
+        if (strcmp(argv[optind], registry[i].name) == 0) {
+            scenario = &registry[i];
+        }
+    }
+    if (!scenario) {
+        fprintf(stderr, "Cenário desconhecido: %s\n", argv[optind]);
+        usage(argv[0]);
+        return 2;
+    }
+
+    char exec_path[4096];
+    if (exec_dir) {
+        snprintf(exec_path, sizeof(exec_path), "%s/%s", exec_dir, scenario->name);
+    }
+
+    if (num_servers < 1) num_servers = 1;
+    if (num_servers > MAX_SERVERS) num_servers = MAX_SERVERS;
+    if (num_servers > trials) num_servers = (int)trials;
+
+    int scenario_argc = argc - optind;
+    char** scenario_argv = &argv[optind];
+
+    fflush(stdout);
+    server_t servers[MAX_SERVERS];
+    for (int i = 0; i < num_servers; i++) {
+        int command_pipe[2], result_pipe[2];
+        if (pipe(command_pipe) < 0 || pipe(result_pipe) < 0) {
+            perror("pipe");
+            return 1;
+        }
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(command_pipe[1]);
+            close(result_pipe[0]);
+            server_loop(command_pipe[0], result_pipe[1], scenario, exec_dir ? exec_path : NULL,
+                        scenario_argc, scenario_argv, timeout_ms * 1000000L);
+        }
+        close(command_pipe[0]);
+        close(result_pipe[1]);
+        servers[i].pid = pid;
+        servers[i].command_fd = command_pipe[1];
+        servers[i].result_fd = result_pipe[0];
+        servers[i].busy = 0;
+    }
+
+    printf("=== FORK-SERVER: %s", scenario->name);
+    for (int i = 1; i < scenario_argc; i++) {
+        printf(" %s", scenario_argv[i]);
+    }
+    printf(" (%s) ===\n", exec_dir ? "fork+exec" : "fork sem exec");
+    if (verbose) {
+        printf("trial\tresultado\tduracao_ms\n");
+    }
+
+    outcome_t outcomes[MAX_OUTCOMES];
+    int outcome_count = 0;
+    long sent = 0, received = 0;
+    long start = monotonic_ns();
+
+    for (int i = 0; i < num_servers && sent < trials; i++) {
+        int trial = (int)sent++;
+        write_full(servers[i].command_fd, &trial, sizeof(trial));
+        servers[i].busy = 1;
+    }
+
+    // Recebe resultados conforme chegam e reabastece o servidor que liberou
+    while (received < trials) {
+        struct pollfd fds[MAX_SERVERS];
+        for (int i = 0; i < num_servers; i++) {
+            fds[i].fd = servers[i].result_fd;
+            fds[i].events = POLLIN;
+        }
+        if (poll(fds, num_servers, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("poll");
+            break;
+        }
+
+        for (int i = 0; i < num_servers; i++) {
+            if (!(fds[i].revents & (POLLIN | POLLHUP))) {
+                continue;
+            }
+
+            trial_result_t result;
+            if (read_full(servers[i].result_fd, &result, sizeof(result)) < 0) {
+                fprintf(stderr, "Servidor %d encerrou inesperadamente\n", i);
+                return 1;
+            }
+            received++;
+            add_outcome(outcomes, &outcome_count, &result);
+
+            if (verbose) {
+                char label[32];
+                outcome_label(&result, label, sizeof(label));
+                printf("%d\t%s\t%.3f\n", result.trial, label, result.duration_ns / 1e6);
+            }
+
+            if (sent < trials) {
+                int trial = (int)sent++;
+                write_full(servers[i].command_fd, &trial, sizeof(trial));
+            }
+        }
+    }
+
+    double elapsed = (monotonic_ns() - start) / 1e9;
+
+    for (int i = 0; i < num_servers; i++) {
+        int stop = -1;
+        write_full(servers[i].command_fd, &stop, sizeof(stop));
+        close(servers[i].command_fd);
+        waitpid(servers[i].pid, NULL, 0);
+    }
+
+    printf("%ld execuções em %.3f s com %d servidores: %.1f execuções/s\n\n",
+           received, elapsed, num_servers, received / elapsed);
+    printf("%-16s %10s %8s %12s %12s\n", "resultado", "execuções", "%", "média(ms)", "max(ms)");
+    for (int i = 0; i < outcome_count; i++) {
+        printf("%-16s %10ld %7.2f%% %12.3f %12.3f\n", outcomes[i].label, outcomes[i].count,
+               100.0 * outcomes[i].count / received, outcomes[i].total_ms / outcomes[i].count,
+               outcomes[i].max_ms);
+    }
+    return 0;
+}
@@ -0,0 +1,316 @@
+/*
+ * Alocador com página de guarda - implementação
+ *
+ * Layout de um bloco guardado de n páginas de dados:
+ *
+ *   base                                   guarda
+ *   |  ... folga ... | bloco (size bytes) |  PROT_NONE  |
+ *
+ * Os blocos vivos ficam numa tabela de endereçamento aberto indexada pelo
+ * ponteiro entregue; free() de um ponteiro que não está lá é da glibc.
+ * O pool guarda mapeamentos inteiros (com a guarda ainda protegida) em
+ * listas por número de páginas, encadeadas pelo primeiro word do
+ * mapeamento.
+ */
+
+#define _GNU_SOURCE
+#include "guard_alloc.h"
+#include "sigsafe.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+
+#define TABLE_SIZE (1 << 17)      // potência de 2; ocupação máxima de metade
+#define POOL_CLASSES 16           // blocos de até 16 páginas voltam ao pool
+#define TOMBSTONE ((void*)1)
+
+typedef struct {
+    void* ptr;       // o que foi entregue (NULL: livre, TOMBSTONE: removido)
+    char* base;      // início do mapeamento
+    size_t pages;    // páginas de dados (a guarda vem depois)
+    size_t size;     // tamanho pedido
+} guard_entry_t;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static atomic_int initialized = 0;
+static size_t page_size;
+static long sample_rate = 1;
+static long pool_max = 1024;
+static size_t alignment = 16;
+
+static guard_entry_t table[TABLE_SIZE];
+static long table_used = 0;  // entradas vivas + tombstones
+
+static void* pool[POOL_CLASSES + 1];
+static long pool_count = 0;
+
+static atomic_long alloc_counter = 0;
+static atomic_long sampled_out = 0;
+static guard_alloc_stats_t stats;
+
+static struct sigaction previous_segv;
+
+/* ---- tabela de blocos vivos ---- */
+
+static size_t slot_of(const void* ptr) {
+    uintptr_t h = (uintptr_t)ptr;
+    h ^= h >> 17;
+    h *= 0x9E3779B97F4A7C15ULL;
+    return (h >> 20) & (TABLE_SIZE - 1);
+}
+
+// Chamadas com o lock
+static guard_entry_t* table_find(const void* ptr) {
+    for (size_t i = slot_of(ptr), n = 0; n < TABLE_SIZE; i = (i + 1) & (TABLE_SIZE - 1), n++) {
+        if (table[i].ptr == NULL) return NULL;
+        if (table[i].ptr == ptr) return &table[i];
+    }
+    return NULL;
+}
+
+static guard_entry_t* table_insert(void* ptr) {
+    if (table_used >= TABLE_SIZE / 2) {
+        // Muitos tombstones: reconstrói no lugar
+        static guard_entry_t live_entries[TABLE_SIZE / 2];
+        long n = 0;
+        for (size_t i = 0; i < TABLE_SIZE; i++) {
+            if (table[i].ptr && table[i].ptr != TOMBSTONE) live_entries[n++] = table[i];
+        }
+        if (n >= TABLE_SIZE / 2) {
+            return NULL; // cheia de verdade
+        }
+        memset(table, 0, sizeof(table));
+        table_used = 0;
+        for (long k = 0; k < n; k++) {
+            guard_entry_t* e = table_insert(live_entries[k].ptr);
+            *e = live_entries[k];
+        }
+    }
+    size_t i = slot_of(ptr);
+    while (table[i].ptr != NULL && table[i].ptr != TOMBSTONE) {
+        i = (i + 1) & (TABLE_SIZE - 1);
+    }
+    if (table[i].ptr == NULL) table_used++;
+    table[i].ptr = ptr;
+    return &table[i];
+}
+
+/* ---- mapeamentos ---- */
+
+// Chamadas com o lock
+static char* mapping_get(size_t pages) {
+    if (pages <= POOL_CLASSES && pool[pages]) {
+        char* base = pool[pages];
+        pool[pages] = *(void**)base;
+        pool_count--;
+        stats.pool_hits++;
+        return base;
+    }
+    size_t length = (pages + 1) * page_size;
+    char* base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+    if (mprotect(base + pages * page_size, page_size, PROT_NONE) != 0) {
+        munmap(base, length);
+        return NULL;
+    }
+    stats.mmaps++;
+    return base;
+}
+
+static void mapping_put(char* base, size_t pages) {
+    if (pages <= POOL_CLASSES && pool_count < pool_max) {
+        *(void**)base = pool[pages];
+        pool[pages] = base;
+        pool_count++;
+        return;
+    }
+    munmap(base, (pages + 1) * page_size);
+}
+
+static void pool_trim() {
+    for (size_t pages = 1; pages <= POOL_CLASSES; pages++) {
+        while (pool[pages] && pool_count > pool_max) {
+            char* base = pool[pages];
+            pool[pages] = *(void**)base;
+            pool_count--;
+            munmap(base, (pages + 1) * page_size);
+        }
+    }
+}
+
+/* ---- relatório da falha (seguro em contexto de sinal) ---- */
+
+static void guard_signal(int sig, siginfo_t* info, void* context) {
+    char* addr = info->si_addr;
+    // Sem lock: o processo está morrendo e a tabela só é lida
+    for (size_t i = 0; i < TABLE_SIZE; i++) {
+        guard_entry_t* e = &table[i];
+        if (!e->ptr || e->ptr == TOMBSTONE) continue;
+        char* guard = e->base + e->pages * page_size;
+        if (addr >= guard && addr < guard + page_size) {
+            sig_writer_t w = {.fd = STDERR_FILENO};
+            sig_str(&w, "\n[guard] acesso em ");
+            sig_hex(&w, (uintptr_t)addr);
+            sig_str(&w, ": ");
+            sig_unsigned(&w, addr - ((char*)e->ptr + e->size), 10, 1);
+            sig_str(&w, " bytes depois do fim do bloco de ");
+            sig_unsigned(&w, e->size, 10, 1);
+            sig_str(&w, " bytes em ");
+            sig_hex(&w, (uintptr_t)e->ptr);
+            sig_str(&w, "\n");
+            sig_flush(&w);
+            break;
+        }
+    }
+
+    sig_chain(sig, info, context, &previous_segv);
+}
+
+/* ---- API ---- */
+
+// Chamada com o lock
+static void init_locked() {
+    if (initialized) {
+        return;
+    }
+    page_size = sysconf(_SC_PAGESIZE);
+
+    const char* env = getenv("GUARD_SAMPLE");
+    if (env && atol(env) > 0) sample_rate = atol(env);
+    env = getenv("GUARD_POOL");
+    if (env && atol(env) >= 0) pool_max = atol(env);
+    env = getenv("GUARD_ALIGN");
+    if (env && atol(env) > 0 && (atol(env) & (atol(env) - 1)) == 0) alignment = atol(env);
+
+    // Instalado na primeira alocação, depois do perf_counters e afins,
+    // então o relatório do bloco sai antes do deles
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = guard_signal;
+    sa.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_RESETHAND;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGSEGV, &sa, &previous_segv);
+    initialized = 1;
+}
+
+void guard_alloc_configure(long sample, long pool_size) {
+    pthread_mutex_lock(&lock);
+    init_locked();
+    if (sample > 0) sample_rate = sample;
+    if (pool_size >= 0) pool_max = pool_size;
+    pool_trim();
+    pthread_mutex_unlock(&lock);
+}
+
+void guard_alloc_stats(guard_alloc_stats_t* out) {
+    pthread_mutex_lock(&lock);
+    *out = stats;
+    out->sampled_out = atomic_load(&sampled_out);
+    pthread_mutex_unlock(&lock);
+}
+
+void* guard_malloc(size_t size) {
+    if (!initialized) {
+        pthread_mutex_lock(&lock);
+        init_locked();
+        pthread_mutex_unlock(&lock);
+    }
+    if (size == 0) {
+        size = 1;
+    }
+    if (sample_rate > 1 && atomic_fetch_add_explicit(&alloc_counter, 1, memory_order_relaxed) % sample_rate != 0) {
+        atomic_fetch_add_explicit(&sampled_out, 1, memory_order_relaxed);
+        return malloc(size);
+    }
+
+    // Arredondar para o alinhamento e para páginas daria a volta em 0
+    if (size > SIZE_MAX - alignment - page_size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    size_t span = (size + alignment - 1) & ~(alignment - 1);
+    size_t pages = (span + page_size - 1) / page_size;
+
+    pthread_mutex_lock(&lock);
+    char* base = mapping_get(pages);
+    if (!base) {
+        pthread_mutex_unlock(&lock);
+        return NULL;
+    }
+    char* ptr = base + pages * page_size - span;
+    guard_entry_t* e = table_insert(ptr);
+    if (!e) {
+        // Tabela cheia: este bloco fica sem guarda
+        mapping_put(base, pages);
+        atomic_fetch_add_explicit(&sampled_out, 1, memory_order_relaxed);
+        pthread_mutex_unlock(&lock);
+        return malloc(size);
+    }
+    e->base = base;
+    e->pages = pages;
+    e->size = size;
+    stats.guarded++;
+    stats.live++;
+    pthread_mutex_unlock(&lock);
+    return ptr;
+}
+
+void* guard_calloc(size_t count, size_t size) {
+    if (size && count > SIZE_MAX / size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    void* ptr = guard_malloc(count * size);
+    if (ptr) {
+        memset(ptr, 0, count * size); // mapeamentos do pool voltam sujos
+    }
+    return ptr;
+}
+
+void* guard_realloc(void* ptr, size_t size) {
+    if (!ptr) {
+        return guard_malloc(size);
+    }
+    pthread_mutex_lock(&lock);
+    guard_entry_t* e = table_find(ptr);
+    size_t old_size = e ? e->size : 0;
+    pthread_mutex_unlock(&lock);
+    if (!e) {
+        return realloc(ptr, size);
+    }
+    void* fresh = guard_malloc(size);
+    if (fresh) {
+        memcpy(fresh, ptr, old_size < size ? old_size : size);
+        guard_free(ptr);
+    }
+    return fresh;
+}
+
+void guard_free(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+    pthread_mutex_lock(&lock);
+    guard_entry_t* e = initialized ? table_find(ptr) : NULL;
+    if (!e) {
+        pthread_mutex_unlock(&lock);
+        free(ptr);
+        return;
+    }
+    char* base = e->base;
+    size_t pages = e->pages;
+    e->ptr = TOMBSTONE;
+    stats.live--;
+    mapping_put(base, pages);
+    pthread_mutex_unlock(&lock);
+}
@@ -0,0 +1,58 @@
+/*
+ * Alocador de depuração com página de guarda (estilo Electric Fence)
+ *
+ * Cada bloco guardado ocupa páginas próprias e termina encostado numa
+ * página sem permissão (mprotect PROT_NONE): a primeira escrita ou
+ * leitura além do fim falha na hora, na instrução culpada, em vez de
+ * corromper o bloco vizinho em silêncio. O tratador de SIGSEGV diz qual
+ * bloco foi estourado e por quantos bytes, e repassa o sinal.
+ *
+ * Para ficar barato:
+ *   - os mapeamentos liberados voltam para um pool por número de páginas
+ *     e são reaproveitados sem mmap/mprotect (a guarda continua no lugar);
+ *   - com GUARD_SAMPLE=N só uma a cada N alocações é guardada (como o
+ *     GWP-ASan); as outras vão para o malloc da glibc.
+ *
+ * Ambiente:
+ *   GUARD_SAMPLE=N   guarda 1 a cada N alocações (padrão 1: todas)
+ *   GUARD_POOL=N     mapeamentos mantidos no pool (padrão 1024; 0 desliga)
+ *   GUARD_ALIGN=N    alinhamento do bloco (padrão 16); com 1 o fim do bloco
+ *                    encosta exatamente na guarda, mas o ponteiro pode não
+ *                    ser alinhado
+ *
+ * Compilando o cenário com -DGUARD_ALLOC (make GUARD_ALLOC=1), malloc,
+ * calloc, realloc e free do arquivo que inclui este header passam a usar
+ * o alocador com guarda.
+ */
+
+#ifndef GUARD_ALLOC_H
+#define GUARD_ALLOC_H
+
+#include <stddef.h>
+
+void* guard_malloc(size_t size);
+void* guard_calloc(size_t count, size_t size);
+void* guard_realloc(void* ptr, size_t size);
+void guard_free(void* ptr);
+
+// Troca amostragem e tamanho do pool em tempo de execução (benchmarks)
+void guard_alloc_configure(long sample, long pool_max);
+
+typedef struct {
+    long guarded;      // alocações com guarda
+    long sampled_out;  // alocações entregues à glibc pela amostragem
+    long mmaps;        // mapeamentos novos (mmap + mprotect da guarda)
+    long pool_hits;    // mapeamentos reaproveitados do pool
+    long live;         // blocos guardados ainda não liberados
+} guard_alloc_stats_t;
+
+void guard_alloc_stats(guard_alloc_stats_t* stats);
+
+#ifdef GUARD_ALLOC
+#define malloc(size) guard_malloc(size)
+#define calloc(count, size) guard_calloc(count, size)
+#define realloc(ptr, size) guard_realloc(ptr, size)
+#define free(ptr) guard_free(ptr)
+#endif
+
+#endif
@@ -0,0 +1,352 @@
+/*
+ * Camada de locks instrumentada - implementação
+ *
+ * Caminho rápido (lock livre): um trylock, a atualização do dono e um
+ * teste de bit por lock já segurado no grafo de ordem. Só quando o lock
+ * está ocupado a thread publica em quem está esperando e percorre o
+ * grafo wait-for procurando um ciclo.
+ */
+
+#define _GNU_SOURCE
+#include "lockdep.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+// Intervalo entre verificações enquanto a thread está bloqueada
+#define LOCKDEP_RECHECK_NS 1000000L
+
+typedef struct {
+    pid_t tid;
+    _Atomic(lockdep_mutex_t*) waiting_on;
+    const char* wait_file;
+    int wait_line;
+    long wait_start_ns;
+    lockdep_mutex_t* held[LOCKDEP_MAX_HELD];
+    int held_count;
+} lockdep_thread_t;
+
+static int lockdep_active = 1;
+static void (*report_hook)(void) = NULL;
+
+static lockdep_thread_t lockdep_threads[LOCKDEP_MAX_THREADS];
+static atomic_int thread_count = 0;
+static __thread int self_index = -1;
+
+static lockdep_mutex_t* lock_table[LOCKDEP_MAX_LOCKS];
+static int lock_count = 0;
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// order_edges[a] tem o bit b ligado se b já foi adquirido segurando a
+static atomic_ullong order_edges[LOCKDEP_MAX_LOCKS];
+static atomic_ullong inversion_reported[LOCKDEP_MAX_LOCKS];
+static const char* edge_file[LOCKDEP_MAX_LOCKS][LOCKDEP_MAX_LOCKS];
+static int edge_line[LOCKDEP_MAX_LOCKS][LOCKDEP_MAX_LOCKS];
+
+void lockdep_init() {
+    const char* env = getenv("LOCKDEP");
+    lockdep_active = !(env && strcmp(env, "0") == 0);
+}
+
+void lockdep_set_report_hook(void (*hook)(void)) {
+    report_hook = hook;
+}
+
+static long monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static int current_thread() {
+    if (self_index == -1) {
+        int index = atomic_fetch_add(&thread_count, 1);
+        if (index >= LOCKDEP_MAX_THREADS) {
+            self_index = -2; // tabela cheia: thread fica sem instrumentação
+        } else {
+            lockdep_threads[index].tid = (pid_t)syscall(SYS_gettid);
+            self_index = index;
+        }
+    }
+    return self_index;
+}
+
+static int lock_id(lockdep_mutex_t* m) {
+    int id = atomic_load_explicit(&m->id, memory_order_acquire);
+    if (id >= 0) {
+        return id;
+    }
+
+    pthread_mutex_lock(&registry_lock);
+    id = atomic_load(&m->id);
+    if (id < 0 && lock_count < LOCKDEP_MAX_LOCKS) {
+        id = lock_count++;
+        lock_table[id] = m;
+        atomic_store_explicit(&m->id, id, memory_order_release);
+    }
+    pthread_mutex_unlock(&registry_lock);
+    return id;
+}
+
+static const char* lock_name(int id) {
+    return lock_table[id] && lock_table[id]->name ? lock_table[id]->name : "?";
+}
+
+/*
+ * Busca em largura no grafo de ordem: devolve 1 se existe caminho
+ * from -> ... -> to, preenchendo parent[] para reconstruir o caminho.
+ */
+static int order_path(int from, int to, int parent[]) {
+    unsigned long long visited = 1ULL << from;
+    int queue[LOCKDEP_MAX_LOCKS];
+    int head = 0, tail = 0;
+
+    queue[tail++] = from;
+    parent[from] = -1;
+
+    while (head < tail) {
+        int node = queue[head++];
+        unsigned long long next = atomic_load_explicit(&order_edges[node], memory_order_relaxed) & ~visited;
+
+        while (next) {
+            int child = __builtin_ctzll(next);
+            next &= next - 1;
+            visited |= 1ULL << child;
+            parent[child] = node;
+            if (child == to) {
+                return 1;
+            }
+            queue[tail++] = child;
+        }
+    }
+    return 0;
+}
+
+static void report_inversion(int held, int wanted, const char* file, int line) {
+    int parent[LOCKDEP_MAX_LOCKS];
+    if (!order_path(wanted, held, parent)) {
+        return;
+    }
+
+    unsigned long long bit = 1ULL << wanted;
+    if (atomic_fetch_or(&inversion_reported[held], bit) & bit) {
+        return; // já avisado para este par
+    }
+
+    fprintf(stderr, "\n=== LOCKDEP: INVERSÃO DE ORDEM DE LOCKS ===\n");
+    fprintf(stderr, "Thread tid %d pega %s segurando %s em %s:%d\n",
+            lockdep_threads[self_index].tid, lock_name(wanted), lock_name(held), file, line);
+    fprintf(stderr, "mas a ordem oposta já foi vista:\n");
+
+    // parent[] aponta para trás; inverte para imprimir wanted -> ... -> held
+    int path[LOCKDEP_MAX_LOCKS];
+    int length = 0;
+    for (int node = held; node != -1; node = parent[node]) {
+        path[length++] = node;
+    }
+    for (int i = length - 1; i > 0; i--) {
+        int from = path[i], to = path[i - 1];
+        fprintf(stderr, "  %s -> %s (em %s:%d)\n", lock_name(from), lock_name(to),
+                edge_file[from][to], edge_line[from][to]);
+    }
+    fprintf(stderr, "Essas duas ordens juntas podem causar deadlock.\n\n");
+}
+
+static void record_order(lockdep_thread_t* self, int wanted, const char* file, int line) {
+    for (int i = 0; i < self->held_count; i++) {
+        int held = atomic_load_explicit(&self->held[i]->id, memory_order_relaxed);
+        if (held < 0 || held == wanted) {
+            continue;
+        }
+
+        unsigned long long bit = 1ULL << wanted;
+        if (atomic_load_explicit(&order_edges[held], memory_order_relaxed) & bit) {
+            continue; // aresta conhecida: caminho rápido
+        }
+
+        edge_file[held][wanted] = file;
+        edge_line[held][wanted] = line;
+        atomic_fetch_or(&order_edges[held], bit);
+
+        // Aresta nova: só avisa se o caminho inverso já existir no grafo
+        report_inversion(held, wanted, file, line);
+    }
+}
+
+/*
+ * Segue o grafo wait-for a partir da thread atual:
+ * thread -> lock esperado -> dono do lock -> lock esperado pelo dono ...
+ * Devolve o tamanho do ciclo que volta para a thread atual, ou 0.
+ */
+static int find_cycle(int self, int cycle[]) {
+    int current = self;
+    int length = 0;
+
+    while (length < LOCKDEP_MAX_THREADS) {
+        lockdep_mutex_t* waiting = atomic_load(&lockdep_threads[current].waiting_on);
+        if (!waiting) {
+            return 0;
+        }
+
+        cycle[length++] = current;
+
+        int owner = atomic_load(&waiting->owner);
+        if (owner < 0) {
+            return 0;
+        }
+        if (owner == self) {
+            return length;
+        }
+        for (int i = 0; i < length; i++) {
+            if (cycle[i] == owner) {
+                return 0; // ciclo sem a thread atual: quem está nele reporta
+            }
+        }
+        current = owner;
+    }
+    return 0;
+}
+
+static void report_deadlock(int cycle[], int length) {
+    long detected_ns = monotonic_ns();
+    lockdep_thread_t* self = &lockdep_threads[cycle[0]];
+
+    fprintf(stderr, "\n=== LOCKDEP: DEADLOCK DETECTADO ===\n");
+    fprintf(stderr, "Ciclo de espera com %d threads:\n", length);
+
+    for (int i = 0; i < length; i++) {
+        lockdep_thread_t* t = &lockdep_threads[cycle[i]];
+        lockdep_mutex_t* waiting = atomic_load(&t->waiting_on);
+        lockdep_thread_t* owner = &lockdep_threads[cycle[(i + 1) % length]];
+
+        fprintf(stderr, "  tid %d espera %s (em %s:%d), que está com tid %d (adquirido em %s:%d)\n",
+                t->tid, waiting->name, t->wait_file, t->wait_line,
+                owner->tid, waiting->owner_file, waiting->owner_line);
+    }
+
+    fprintf(stderr, "Detectado %.3f ms após o bloqueio de tid %d\n",
+            (detected_ns - self->wait_start_ns) / 1e6, self->tid);
+    fprintf(stderr, "Encerrando com código %d\n", LOCKDEP_EXIT_DEADLOCK);
+
+    if (report_hook) {
+        report_hook();
+    }
+    fflush(stdout);
+    fflush(stderr);
+    _exit(LOCKDEP_EXIT_DEADLOCK);
+}
+
+static void wait_with_detection(lockdep_mutex_t* m, int self) {
+    int cycle[LOCKDEP_MAX_THREADS];
+    int suspected = 0;
+
+    for (;;) {
+        // Um ciclo só é reportado se continuar lá na verificação seguinte,
+        // o que descarta leituras de um dono que acabou de liberar o lock
+        int length = find_cycle(self, cycle);
+        if (length > 0 && suspected) {
+            report_deadlock(cycle, length);
+        }
+        suspected = length > 0;
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += LOCKDEP_RECHECK_NS;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        if (pthread_mutex_timedlock(&m->mutex, &deadline) != ETIMEDOUT) {
+            return;
+        }
+    }
+}
+
+void lockdep_lock_at(lockdep_mutex_t* m, const char* file, int line) {
+    int self = lockdep_active ? current_thread() : -2;
+    if (self < 0) {
+        long wait_start = 0;
+        if (pthread_mutex_trylock(&m->mutex) != 0) {
+            wait_start = mutex_prof_wait_begin(&m->prof);
+            pthread_mutex_lock(&m->mutex);
+        }
+        mutex_prof_acquired(&m->prof, wait_start, file, line);
+        return;
+    }
+
+    lockdep_thread_t* t = &lockdep_threads[self];
+    int id = lock_id(m);
+    if (id >= 0) {
+        record_order(t, id, file, line);
+    }
+
+    long prof_wait_start = 0;
+    if (pthread_mutex_trylock(&m->mutex) != 0) {
+        t->wait_file = file;
+        t->wait_line = line;
+        t->wait_start_ns = monotonic_ns();
+        atomic_store(&t->waiting_on, m);
+        prof_wait_start = mutex_prof_wait_begin(&m->prof);
+
+        wait_with_detection(m, self);
+
+        atomic_store(&t->waiting_on, NULL);
+    }
+    mutex_prof_acquired(&m->prof, prof_wait_start, file, line);
+
+    m->owner_file = file;
+    m->owner_line = line;
+    atomic_store_explicit(&m->owner, self, memory_order_release);
+
+    if (t->held_count < LOCKDEP_MAX_HELD) {
+        t->held[t->held_count++] = m;
+    }
+}
+
+void lockdep_unlock(lockdep_mutex_t* m) {
+    if (self_index >= 0 && lockdep_active) {
+        lockdep_thread_t* t = &lockdep_threads[self_index];
+
+        // Normalmente é o último da pilha, mas a liberação pode vir fora de ordem
+        for (int i = t->held_count - 1; i >= 0; i--) {
+            if (t->held[i] == m) {
+                for (int j = i + 1; j < t->held_count; j++) {
+                    t->held[j - 1] = t->held[j];
+                }
+                t->held_count--;
+                break;
+            }
+        }
+        atomic_store_explicit(&m->owner, -1, memory_order_release);
+    }
+
+    mutex_prof_releasing(&m->prof);
+    pthread_mutex_unlock(&m->mutex);
+}
+
+void lockdep_print_order_graph() {
+    printf("=== LOCKDEP: GRAFO DE ORDEM DE AQUISIÇÃO ===\n");
+
+    int edges = 0, inversions = 0;
+    for (int from = 0; from < lock_count; from++) {
+        unsigned long long next = atomic_load(&order_edges[from]);
+        while (next) {
+            int to = __builtin_ctzll(next);
+            next &= next - 1;
+            int inverted = (atomic_load(&order_edges[to]) >> from) & 1;
+            printf("  %s -> %s (primeira vez em %s:%d)%s\n", lock_name(from), lock_name(to),
+                   edge_file[from][to], edge_line[from][to], inverted ? "  [INVERSÃO]" : "");
+            edges++;
+            inversions += inverted;
+        }
+    }
+
+    // Cada inversão direta aparece nas duas direções
+    printf("%d arestas, %d pares com ordem invertida\n", edges, inversions / 2);
+}
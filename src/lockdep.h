@@ -0,0 +1,60 @@
+/*
+ * Camada de locks instrumentada (estilo lockdep do kernel Linux)
+ *
+ * Envolve pthread_mutex_t mantendo, para cada thread, os locks que ela
+ * segura e o lock pelo qual está esperando (grafo wait-for). Quando um
+ * lock bloqueia, procura um ciclo no grafo: se encontrar, imprime o ciclo
+ * (threads, mutex e locais de aquisição) e termina o processo com
+ * LOCKDEP_EXIT_DEADLOCK em vez de travar para sempre.
+ *
+ * Também registra o grafo de ordem de aquisição ("A foi pego antes de B")
+ * e avisa sobre inversões de ordem mesmo quando o deadlock não acontece.
+ *
+ * Cada lock também carrega o estado do mutex_prof: com MUTEX_PROF=1 os
+ * tempos de espera e de posse entram no perfil de contenção, e com
+ * TRACE_OUT viram intervalos no trace.
+ */
+
+#ifndef LOCKDEP_H
+#define LOCKDEP_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "mutex_prof.h"
+
+#define LOCKDEP_MAX_LOCKS 64
+#define LOCKDEP_MAX_THREADS 256
+#define LOCKDEP_MAX_HELD 16
+
+// Código de saída usado quando um deadlock é detectado
+#define LOCKDEP_EXIT_DEADLOCK 42
+
+typedef struct {
+    pthread_mutex_t mutex;
+    const char* name;
+    atomic_int id;      // índice no grafo de ordem (-1 até o primeiro uso)
+    atomic_int owner;   // índice da thread dona (-1 se livre)
+    const char* owner_file;
+    int owner_line;
+    mutex_prof_info_t prof;
+} lockdep_mutex_t;
+
+#define LOCKDEP_MUTEX_INITIALIZER(lock_name) \
+    { PTHREAD_MUTEX_INITIALIZER, (lock_name), -1, -1, NULL, 0, MUTEX_PROF_INFO_INITIALIZER(lock_name) }
+
+// Lê LOCKDEP=0 do ambiente para desligar a instrumentação
+void lockdep_init();
+
+// Função chamada logo antes de encerrar o processo por deadlock
+void lockdep_set_report_hook(void (*hook)(void));
+
+void lockdep_lock_at(lockdep_mutex_t* m, const char* file, int line);
+void lockdep_unlock(lockdep_mutex_t* m);
+
+#define lockdep_lock(m) lockdep_lock_at((m), __FILE__, __LINE__)
+
+// Imprime as arestas do grafo de ordem e as inversões encontradas
+void lockdep_print_order_graph();
+
+#endif
@@ -0,0 +1,205 @@
+/*
+ * Amostrador de memória em segundo plano - implementação
+ */
+
+#define _GNU_SOURCE
+#include "mem_sampler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+typedef struct {
+    double t;           // segundos desde o início
+    long rss_kb;
+    long anon_kb;
+    long heap_in_use;   // bytes alocados segundo o malloc (mallinfo2)
+    long minflt;
+    long majflt;
+} mem_sample_t;
+
+// Acumuladores para a regressão linear y = a + b*t
+typedef struct {
+    double n, st, stt, sy, sty;
+} slope_acc_t;
+
+static pthread_t sampler_thread;
+static atomic_int sampler_running = 0;
+static long sampler_interval_ns = 0;
+static FILE* sampler_csv = NULL;
+static int statm_fd = -1;
+static int smaps_fd = -1;
+static long page_kb = 4;
+static struct timespec sampler_start;
+
+static long sample_count = 0;
+static mem_sample_t first_sample, last_sample;
+static long peak_rss_kb = 0;
+static slope_acc_t heap_slope, rss_slope;
+
+static void slope_add(slope_acc_t* acc, double t, double y) {
+    acc->n += 1;
+    acc->st += t;
+    acc->stt += t * t;
+    acc->sy += y;
+    acc->sty += t * y;
+}
+
+static double slope_value(const slope_acc_t* acc) {
+    double den = acc->n * acc->stt - acc->st * acc->st;
+    return den > 0 ? (acc->n * acc->sty - acc->st * acc->sy) / den : 0;
+}
+
+// Lê o arquivo inteiro do /proc a partir do início (sem reabrir)
+static int read_proc(int fd, char* buf, size_t size) {
+    ssize_t n = pread(fd, buf, size - 1, 0);
+    if (n < 0) {
+        return -1;
+    }
+    buf[n] = '\0';
+    return 0;
+}
+
+static long field_kb(const char* text, const char* name) {
+    const char* line = strstr(text, name);
+    return line ? atol(line + strlen(name)) : -1;
+}
+
+static void take_sample(mem_sample_t* sample) {
+    char buf[4096];
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    sample->t = (now.tv_sec - sampler_start.tv_sec) + (now.tv_nsec - sampler_start.tv_nsec) / 1e9;
+
+    sample->rss_kb = -1;
+    if (statm_fd >= 0 && read_proc(statm_fd, buf, sizeof(buf)) == 0) {
+        long size_pages, resident_pages;
+        if (sscanf(buf, "%ld %ld", &size_pages, &resident_pages) == 2) {
+            sample->rss_kb = resident_pages * page_kb;
+        }
+    }
+
+    sample->anon_kb = -1;
+    if (smaps_fd >= 0 && read_proc(smaps_fd, buf, sizeof(buf)) == 0) {
+        sample->anon_kb = field_kb(buf, "\nAnonymous:");
+    }
+
+    struct mallinfo2 info = mallinfo2();
+    sample->heap_in_use = (long)(info.uordblks + info.hblkhd);
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    sample->minflt = usage.ru_minflt;
+    sample->majflt = usage.ru_majflt;
+}
+
+static void record_sample(const mem_sample_t* sample) {
+    if (sample_count == 0) {
+        first_sample = *sample;
+    }
+    last_sample = *sample;
+    sample_count++;
+
+    if (sample->rss_kb > peak_rss_kb) {
+        peak_rss_kb = sample->rss_kb;
+    }
+    slope_add(&heap_slope, sample->t, sample->heap_in_use);
+    slope_add(&rss_slope, sample->t, sample->rss_kb * 1024.0);
+
+    fprintf(sampler_csv, "%.6f,%ld,%ld,%ld,%ld,%ld\n", sample->t, sample->rss_kb,
+            sample->anon_kb, sample->heap_in_use, sample->minflt, sample->majflt);
+}
+
+static void* sampler_main(void* arg) {
+    (void)arg;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (atomic_load(&sampler_running)) {
+        mem_sample_t sample;
+        take_sample(&sample);
+        record_sample(&sample);
+
+        // Intervalo absoluto: o custo da amostra não atrasa a série
+        next.tv_nsec += sampler_interval_ns;
+        while (next.tv_nsec >= 1000000000L) {
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000L;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+
+    return NULL;
+}
+
+int mem_sampler_start(long interval_us, const char* csv_path) {
+    if (atomic_load(&sampler_running)) {
+        return 0;
+    }
+
+    sampler_csv = fopen(csv_path, "w");
+    if (!sampler_csv) {
+        perror("mem_sampler: erro ao abrir CSV");
+        return -1;
+    }
+    fprintf(sampler_csv, "t_s,rss_kb,anon_kb,heap_in_use_bytes,minor_faults,major_faults\n");
+
+    statm_fd = open("/proc/self/statm", O_RDONLY);
+    smaps_fd = open("/proc/self/smaps_rollup", O_RDONLY);
+    page_kb = sysconf(_SC_PAGESIZE) / 1024;
+    sampler_interval_ns = (interval_us > 0 ? interval_us : 1000) * 1000L;
+    clock_gettime(CLOCK_MONOTONIC, &sampler_start);
+
+    sample_count = 0;
+    peak_rss_kb = 0;
+    memset(&heap_slope, 0, sizeof(heap_slope));
+    memset(&rss_slope, 0, sizeof(rss_slope));
+
+    atomic_store(&sampler_running, 1);
+    if (pthread_create(&sampler_thread, NULL, sampler_main, NULL) != 0) {
+        perror("mem_sampler: erro ao criar thread");
+        atomic_store(&sampler_running, 0);
+        fclose(sampler_csv);
+        return -1;
+    }
+
+    printf("[mem_sampler] amostrando a cada %.3f ms em %s\n", sampler_interval_ns / 1e6, csv_path);
+    return 0;
+}
+
+void mem_sampler_start_from_env() {
+    const char* interval = getenv("MEM_SAMPLER_MS");
+    if (!interval) {
+        return;
+    }
+
+    const char* path = getenv("MEM_SAMPLER_OUT");
+    mem_sampler_start((long)(atof(interval) * 1000), path ? path : "mem_samples.csv");
+}
+
+void mem_sampler_stop() {
+    if (!atomic_exchange(&sampler_running, 0)) {
+        return;
+    }
+    pthread_join(sampler_thread, NULL);
+    fclose(sampler_csv);
+    if (statm_fd >= 0) close(statm_fd);
+    if (smaps_fd >= 0) close(smaps_fd);
+
+    double duration = last_sample.t - first_sample.t;
+    printf("\n=== MEM_SAMPLER: RESUMO ===\n");
+    printf("Amostras: %ld em %.3f s\n", sample_count, duration);
+    printf("RSS: %ld kB -> %ld kB (pico %ld kB)\n", first_sample.rss_kb, last_sample.rss_kb, peak_rss_kb);
+    printf("Heap em uso: %ld -> %ld bytes\n", first_sample.heap_in_use, last_sample.heap_in_use);
+    printf("Page faults: %ld menores, %ld maiores\n",
+           last_sample.minflt - first_sample.minflt, last_sample.majflt - first_sample.majflt);
+    printf("Taxa de vazamento estimada: %.0f bytes/s (heap), %.0f bytes/s (RSS)\n",
+           slope_value(&heap_slope), slope_value(&rss_slope));
+}
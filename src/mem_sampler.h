@@ -0,0 +1,26 @@
+/*
+ * Amostrador de memória em segundo plano
+ *
+ * Uma thread lê periodicamente /proc/self/statm, /proc/self/smaps_rollup,
+ * mallinfo2() e getrusage() e grava uma série temporal em CSV com RSS,
+ * memória anônima, heap em uso e page faults. Ao parar, estima a taxa de
+ * vazamento (bytes/s) pela inclinação da reta de mínimos quadrados.
+ *
+ * Variáveis de ambiente lidas por mem_sampler_start_from_env():
+ *   MEM_SAMPLER_MS=N     intervalo entre amostras em ms (liga o amostrador)
+ *   MEM_SAMPLER_OUT=arq  arquivo CSV de saída (padrão mem_samples.csv)
+ */
+
+#ifndef MEM_SAMPLER_H
+#define MEM_SAMPLER_H
+
+// Inicia a thread de amostragem; devolve 0 em caso de sucesso
+int mem_sampler_start(long interval_us, const char* csv_path);
+
+// Inicia apenas se MEM_SAMPLER_MS estiver definido
+void mem_sampler_start_from_env();
+
+// Para a thread, fecha o CSV e imprime o resumo com a taxa de vazamento
+void mem_sampler_stop();
+
+#endif
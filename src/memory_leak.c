@@ -5,10 +5,26 @@
  * desde vazamentos simples até vazamentos mais complexos.
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "mem_sampler.h"
+#include "perf_counters.h"
+#include "trace.h"
+#include "guard_alloc.h"
+#include "alloc_backend.h"
 
 void simple_memory_leak() {
     printf("Demonstrando vazamento simples de memória...\n");
@@ -16,6 +32,7 @@ void simple_memory_leak() {
     for (int i = 0; i < 1000; i++) {
         // Aloca memória mas nunca libera
         char *leaked_memory = (char*)malloc(1024);
+        trace_alloc(leaked_memory, 1024);
         if (leaked_memory) {
             sprintf(leaked_memory, "Vazamento %d", i);
             // free(leaked_memory); // Esta linha está comentada - causa vazamento!
@@ -34,6 +51,7 @@ void recursive_memory_leak(int depth) {
     // Aloca memória a cada chamada recursiva
     char *buffer = (char*)malloc(2048);
     sprintf(buffer, "Recursão nível %d", depth);
+    trace_alloc(buffer, 2048);
     
     printf("Alocando na profundidade %d\n", depth);
     
@@ -50,6 +68,7 @@ void growing_memory_leak() {
         // Aloca blocos cada vez maiores
         size_t size = i * 1024; // 1KB, 2KB, 3KB, ...
         void *ptr = malloc(size);
+        trace_alloc(ptr, size);
         
         if (ptr) {
             memset(ptr, i, size); // Preenche com dados
@@ -61,9 +80,407 @@ void growing_memory_leak() {
     }
 }
 
+/* ---- estratégias de alocação nos mesmos padrões ---- */
+
+#define BENCH_MAX_THREADS 16
+#define BENCH_MAX_BLOCKS 1000
+
+typedef struct {
+    const char* name;
+    const alloc_backend_t* backend;
+    int leak;               // não libera nada (o cenário como está escrito)
+} strategy_t;
+
+typedef struct {
+    long allocations;
+    double alloc_seconds;
+    double release_seconds;
+    long requests;
+    size_t requested;       // blocos vivos no fim da última requisição
+    size_t usable;
+    size_t footprint;
+    long peak_rss_kib;
+} strategy_result_t;
+
+typedef struct {
+    const strategy_t* strategy;
+    const size_t* sizes;
+    int count;
+    long requests;
+    int index;
+    pthread_barrier_t* barrier;
+    strategy_result_t* result;
+    pthread_mutex_t* result_lock;
+} bench_thread_t;
+
+static double bench_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Padrões de simple_memory_leak (1000 x 1 KiB) e growing_memory_leak (1..50 KiB)
+static int bench_pattern(const char* name, size_t* sizes) {
+    if (strcmp(name, "simples") == 0) {
+        for (int i = 0; i < 1000; i++) sizes[i] = 1024;
+        return 1000;
+    }
+    if (strcmp(name, "crescente") == 0) {
+        for (int i = 1; i <= 50; i++) sizes[i - 1] = i * 1024;
+        return 50;
+    }
+    return 0;
+}
+
+// Cada requisição aloca o padrão inteiro e, no fim, libera tudo
+static void* bench_thread(void* arg) {
+    bench_thread_t* t = arg;
+    const alloc_backend_t* b = t->strategy->backend;
+    void* blocks[BENCH_MAX_BLOCKS];
+    double alloc_seconds = 0, release_seconds = 0;
+    size_t requested = 0, usable = 0;
+
+    for (long r = 0; r < t->requests; r++) {
+        double start = bench_now();
+        for (int i = 0; i < t->count; i++) {
+            blocks[i] = b->alloc(t->sizes[i]);
+            if (blocks[i]) {
+                *(char*)blocks[i] = (char)i; // como o sprintf/memset do cenário
+            }
+        }
+        alloc_seconds += bench_now() - start;
+
+        if (t->strategy->leak || r == t->requests - 1) {
+            for (int i = 0; i < t->count; i++) {
+                requested += t->sizes[i];
+                usable += blocks[i] ? b->usable(blocks[i], t->sizes[i]) : 0;
+            }
+        }
+        if (r == t->requests - 1) {
+            // Todas as threads com os blocos vivos: é aí que se mede o alocador
+            pthread_mutex_lock(t->result_lock);
+            t->result->requested += requested;
+            t->result->usable += usable;
+            pthread_mutex_unlock(t->result_lock);
+            pthread_barrier_wait(t->barrier);
+            if (t->index == 0) {
+                t->result->footprint = b->footprint();
+            }
+            pthread_barrier_wait(t->barrier);
+        }
+
+        if (!t->strategy->leak) {
+            start = bench_now();
+            if (b->release_all) {
+                b->release_all();
+            } else {
+                for (int i = 0; i < t->count; i++) {
+                    (b->free)(blocks[i], t->sizes[i]); // entre parênteses: GUARD_ALLOC redefine free
+                }
+            }
+            release_seconds += bench_now() - start;
+        }
+    }
+
+    pthread_mutex_lock(t->result_lock);
+    t->result->allocations += (long)t->count * t->requests;
+    t->result->alloc_seconds += alloc_seconds;
+    t->result->release_seconds += release_seconds;
+    t->result->requests += t->requests;
+    pthread_mutex_unlock(t->result_lock);
+    return NULL;
+}
+
+// Roda uma estratégia num processo filho, para o pico de RSS ser só dela
+static int run_strategy(const strategy_t* strategy, const size_t* sizes, int count, long requests,
+                        int threads, strategy_result_t* result) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        return -1;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return -1;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        strategy_result_t r;
+        memset(&r, 0, sizeof(r));
+        pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+        pthread_barrier_t barrier;
+        pthread_barrier_init(&barrier, NULL, threads);
+        pthread_t ids[BENCH_MAX_THREADS];
+        bench_thread_t args[BENCH_MAX_THREADS];
+        for (int i = 0; i < threads; i++) {
+            args[i] = (bench_thread_t){strategy, sizes, count, requests, i, &barrier, &r, &lock};
+            pthread_create(&ids[i], NULL, bench_thread, &args[i]);
+        }
+        for (int i = 0; i < threads; i++) {
+            pthread_join(ids[i], NULL);
+        }
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        r.peak_rss_kib = usage.ru_maxrss;
+        ssize_t written = write(fds[1], &r, sizeof(r));
+        _exit(written == sizeof(r) ? 0 : 1);
+    }
+    close(fds[1]);
+    ssize_t got = read(fds[0], result, sizeof(*result));
+    close(fds[0]);
+    int status;
+    waitpid(pid, &status, 0);
+    return got == sizeof(*result) && WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+void allocator_strategies(const char* pattern, long requests, int threads) {
+    const strategy_t strategies[] = {
+        {"glibc", &glibc_backend, 0},
+        {"glibc sem free", &glibc_backend, 1},
+        {"pool por classe", &pool_backend, 0},
+        {"arena (reset)", &arena_backend, 0},
+    };
+    const char* patterns[] = {"simples", "crescente"};
+    if (pattern && strcmp(pattern, "simples") != 0 && strcmp(pattern, "crescente") != 0) {
+        printf("Padrão desconhecido: %s (use simples, crescente ou todos)\n", pattern);
+        return;
+    }
+    if (requests < 1) requests = 1;
+    if (threads < 1) threads = 1;
+    if (threads > BENCH_MAX_THREADS) threads = BENCH_MAX_THREADS;
+
+    printf("Comparando estratégias de alocação: %ld requisições por thread, %d threads\n", requests, threads);
+    printf("(cada requisição aloca o padrão do cenário e depois libera tudo)\n");
+
+    for (int p = 0; p < 2; p++) {
+        if (pattern && strcmp(pattern, patterns[p]) != 0) {
+            continue;
+        }
+        size_t sizes[BENCH_MAX_BLOCKS];
+        int count = bench_pattern(patterns[p], sizes);
+
+        printf("\nPadrão %s (%d blocos por requisição)\n", patterns[p], count);
+        printf("%-16s %12s %14s %12s %11s %11s %16s\n",
+               "alocador", "alocações/s", "pico RSS(MiB)", "reservado", "frag. int.", "frag. ext.", "liberar (µs/req)");
+        for (size_t s = 0; s < sizeof(strategies) / sizeof(strategies[0]); s++) {
+            strategy_result_t r;
+            if (run_strategy(&strategies[s], sizes, count, requests, threads, &r) != 0) {
+                printf("%-16s falhou\n", strategies[s].name);
+                continue;
+            }
+            // Interna: arredondamento dentro do bloco; externa: reservado
+            // pelo alocador e não entregue a nenhum bloco vivo
+            double internal = r.usable ? 100.0 * (r.usable - r.requested) / r.usable : 0;
+            double external = r.footprint > r.usable ? 100.0 * (r.footprint - r.usable) / r.footprint : 0;
+            char release[32];
+            if (strategies[s].leak) {
+                snprintf(release, sizeof(release), "-");
+            } else {
+                snprintf(release, sizeof(release), "%.2f", r.release_seconds * 1e6 / r.requests);
+            }
+            printf("%-16s %12.0f %14.1f %11.1fM %10.1f%% %10.1f%% %16s\n",
+                   strategies[s].name, r.alloc_seconds > 0 ? r.allocations / (r.alloc_seconds / threads) : 0,
+                   r.peak_rss_kib / 1024.0, r.footprint / 1048576.0, internal, external, release);
+        }
+    }
+    printf("\n\"glibc sem free\" é o cenário como está escrito: o pico de RSS cresce a cada\n");
+    printf("requisição. Com a arena o mesmo código não vaza: o reset no fim da requisição\n");
+    printf("devolve tudo de uma vez, em tempo constante.\n");
+}
+
+/* ---- custo do primeiro toque em regiões grandes ---- */
+
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#define TOUCH_MAX_THREADS 64
+#define RANDOM_ACCESSES (16 * 1024 * 1024)
+
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23      // Linux 5.14
+#endif
+
+typedef struct {
+    const char* name;
+    int huge;               // MADV_HUGEPAGE (0: MADV_NOHUGEPAGE, páginas de 4 KiB)
+    int populate;           // faltas pagas no mmap/madvise, não no primeiro toque
+    int parallel;           // primeiro toque dividido entre as threads
+} touch_mode_t;
+
+typedef struct {
+    char* base;
+    size_t length;
+} touch_slice_t;
+
+static void* touch_slice(void* arg) {
+    touch_slice_t* slice = arg;
+    memset(slice->base, 1, slice->length); // como o growing_memory_leak
+    return NULL;
+}
+
+// dTLB load misses da thread atual; -1 sem PMU (VM, container)
+static int dtlb_counter_open() {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// AnonHugePages do processo inteiro, em KiB
+static long anon_huge_kib() {
+    char line[256];
+    long kib = 0;
+    FILE* f = fopen("/proc/self/smaps_rollup", "r");
+    if (!f) {
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "AnonHugePages: %ld", &kib) == 1) {
+            break;
+        }
+    }
+    fclose(f);
+    return kib;
+}
+
+// Região alinhada a 2 MiB, para o THP poder cobrir tudo
+static char* map_aligned(size_t bytes, char** raw, size_t* raw_length) {
+    *raw_length = bytes + HUGE_PAGE_SIZE;
+    *raw = mmap(NULL, *raw_length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (*raw == MAP_FAILED) {
+        return NULL;
+    }
+    return (char*)(((uintptr_t)*raw + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+}
+
+void first_touch_cost(size_t megabytes, const char* only, int threads) {
+    const touch_mode_t modes[] = {
+        {"4k",           0, 0, 0},
+        {"thp",          1, 0, 0},
+        {"populate",     0, 1, 0},
+        {"populate-thp", 1, 1, 0},
+        {"paralelo",     0, 0, 1},
+        {"paralelo-thp", 1, 0, 1},
+    };
+    size_t bytes = megabytes * 1024 * 1024;
+    if (threads < 1) threads = 1;
+    if (threads > TOUCH_MAX_THREADS) threads = TOUCH_MAX_THREADS;
+
+    char thp[64] = "?";
+    FILE* f = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    if (f) {
+        if (!fgets(thp, sizeof(thp), f)) strcpy(thp, "?");
+        thp[strcspn(thp, "\n")] = 0;
+        fclose(f);
+    }
+    printf("Primeiro toque em %zu MiB via mmap; %d threads no modo paralelo\n", megabytes, threads);
+    printf("THP do sistema: %s\n", thp);
+    printf("(populate: MADV_POPULATE_WRITE na região alinhada, depois do MADV_[NO]HUGEPAGE)\n\n");
+    printf("%-13s %10s %8s %10s %8s %10s %12s %14s\n", "modo", "toque(ms)", "GiB/s", "minflt", "majflt",
+           "THP(MiB)", "aleat. M/s", "dTLB miss/ac.");
+
+    int found = 0;
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        const touch_mode_t* mode = &modes[m];
+        if (only && strcmp(only, mode->name) != 0) {
+            continue;
+        }
+        found = 1;
+
+        struct rusage before, after;
+        long huge_before = anon_huge_kib();
+        getrusage(RUSAGE_SELF, &before);
+        double start = bench_now();
+
+        // O madvise precisa vir antes das faltas, então a região é
+        // populada depois dele e só na parte alinhada (nada de MAP_POPULATE,
+        // que pagaria também a folga do alinhamento)
+        char* raw;
+        size_t raw_length;
+        char* region = map_aligned(bytes, &raw, &raw_length);
+        if (!region) {
+            perror("mmap");
+            return;
+        }
+        madvise(region, bytes, mode->huge ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+        if (mode->populate && madvise(region, bytes, MADV_POPULATE_WRITE) != 0) {
+            memset(region, 1, bytes); // kernel sem MADV_POPULATE_WRITE
+        } else if (!mode->populate) {
+            int count = mode->parallel ? threads : 1;
+            pthread_t ids[TOUCH_MAX_THREADS];
+            touch_slice_t slices[TOUCH_MAX_THREADS];
+            // Fatias em múltiplos de 2 MiB: uma página grande não fica entre duas threads
+            size_t per_thread = (bytes / count + HUGE_PAGE_SIZE - 1) & ~(size_t)(HUGE_PAGE_SIZE - 1);
+            for (int i = 0; i < count; i++) {
+                size_t offset = i * per_thread < bytes ? i * per_thread : bytes;
+                slices[i].base = region + offset;
+                slices[i].length = offset + per_thread < bytes ? per_thread : bytes - offset;
+                pthread_create(&ids[i], NULL, touch_slice, &slices[i]);
+            }
+            for (int i = 0; i < count; i++) {
+                pthread_join(ids[i], NULL);
+            }
+        }
+        double touch_seconds = bench_now() - start;
+        getrusage(RUSAGE_SELF, &after);
+        long huge_kib = anon_huge_kib() - huge_before;
+
+        // Acesso aleatório depois que tudo está mapeado: aqui pesa o TLB
+        int dtlb = dtlb_counter_open();
+        uint64_t x = 88172645463325252ULL, sum = 0;
+        long long misses = -1;
+        if (dtlb >= 0) ioctl(dtlb, PERF_EVENT_IOC_ENABLE, 0);
+        start = bench_now();
+        for (long i = 0; i < RANDOM_ACCESSES; i++) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            sum += region[x % bytes];
+        }
+        double random_seconds = bench_now() - start;
+        if (dtlb >= 0) {
+            ioctl(dtlb, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(dtlb, &misses, sizeof(misses)) != sizeof(misses)) misses = -1;
+            close(dtlb);
+        }
+
+        char misses_text[32];
+        if (misses >= 0) {
+            snprintf(misses_text, sizeof(misses_text), "%.3f", (double)misses / RANDOM_ACCESSES);
+        } else {
+            snprintf(misses_text, sizeof(misses_text), "-");
+        }
+        printf("%-13s %10.1f %8.2f %10ld %8ld %10ld %12.1f %14s\n", mode->name, touch_seconds * 1e3,
+               bytes / touch_seconds / (1024.0 * 1024 * 1024), after.ru_minflt - before.ru_minflt,
+               after.ru_majflt - before.ru_majflt, huge_kib / 1024, RANDOM_ACCESSES / random_seconds / 1e6,
+               misses_text);
+        if (sum == 42) printf(" "); // mantém as leituras vivas
+        munmap(raw, raw_length);
+    }
+    if (!found) {
+        printf("Modo desconhecido: %s (use 4k, thp, populate, populate-thp, paralelo, paralelo-thp ou todos)\n",
+               only);
+        return;
+    }
+    printf("\nCom THP cada falta mapeia 2 MiB (512 vezes menos faltas) e o acesso aleatório\n");
+    printf("erra menos no TLB. THP(MiB) em 0 com \"thp\" indica THP desligado no sistema\n");
+    printf("ou sem páginas grandes livres (veja /sys/kernel/mm/transparent_hugepage).\n");
+}
+
 int main(int argc, char *argv[]) {
     printf("=== DEMONSTRAÇÃO: MEMORY LEAK ===\n");
-    printf("Use 'valgrind' ou 'top' para monitorar o uso de memória\n\n");
+    printf("Use 'valgrind' ou 'top' para monitorar o uso de memória\n");
+    printf("(ou MEM_SAMPLER_MS=1 para gravar a curva de crescimento em CSV)\n\n");
+    
+    mem_sampler_start_from_env();
+    perf_counters_init();
+    trace_init();
     
     int option = 1;
     if (argc > 1) {
@@ -72,20 +489,43 @@ int main(int argc, char *argv[]) {
     
     switch(option) {
         case 1:
+            perf_phase_begin("simples");
             simple_memory_leak();
+            perf_phase_end();
             break;
         case 2:
             printf("Iniciando vazamento recursivo...\n");
+            perf_phase_begin("recursivo");
             recursive_memory_leak(20);
+            perf_phase_end();
             break;
         case 3:
+            perf_phase_begin("crescente");
             growing_memory_leak();
+            perf_phase_end();
             break;
+        case 4:
+            // Termina ao fim da comparação, sem ficar esperando
+            allocator_strategies(argc > 2 && strcmp(argv[2], "todos") != 0 ? argv[2] : NULL,
+                                 argc > 3 ? atol(argv[3]) : 100, argc > 4 ? atoi(argv[4]) : 1);
+            mem_sampler_stop();
+            return 0;
+        case 5:
+            first_touch_cost(argc > 2 && atol(argv[2]) > 0 ? atol(argv[2]) : 512,
+                             argc > 3 && strcmp(argv[3], "todos") != 0 ? argv[3] : NULL,
+                             argc > 4 ? atoi(argv[4]) : (int)sysconf(_SC_NPROCESSORS_ONLN));
+            mem_sampler_stop();
+            return 0;
         default:
-            printf("Opções: 1=vazamento simples, 2=vazamento recursivo, 3=vazamento crescente\n");
+            printf("Opções: 1=vazamento simples, 2=vazamento recursivo, 3=vazamento crescente, 4=estratégias de alocação,\n");
+            printf("        5=custo do primeiro toque (4k, THP, populate, threads)\n");
             simple_memory_leak();
     }
     
+    mem_sampler_stop();
+    // O processo não termina sozinho: imprime os contadores agora
+    perf_counters_report();
+    
     printf("\nProcesso ainda em execução com vazamentos ativos...\n");
     printf("Pressione Ctrl+C para terminar\n");
     
@@ -0,0 +1,557 @@
+/*
+ * Exemplo de Pressão de Memória (limite do cgroup e OOM killer)
+ *
+ * Este programa faz a memória crescer num ritmo controlado, parte
+ * anônima e parte em arquivo mapeado, até bater no limite do cgroup
+ * (mem_limit do docker-compose). Uma thread de monitoramento acompanha o
+ * PSI de memória (/proc/pressure/memory ou memory.pressure do cgroup,
+ * com gatilho por poll), o memory.events do cgroup, as page faults e a
+ * latência de cada alocação, e no modo 2 descarta memória com
+ * MADV_FREE/MADV_DONTNEED quando a pressão sobe, para ver se dá para
+ * escapar do OOM killer e com quanta antecedência.
+ *
+ * O crescimento roda num processo filho; o pai só espera e diz no fim
+ * se o filho morreu por SIGKILL (o OOM killer) ou terminou sozinho.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "perf_counters.h"
+
+#define CHUNK_SIZE (1024 * 1024)
+#define MAX_CHUNKS 65536
+#define LOG_INTERVAL_MS 500
+#define CHECK_INTERVAL_MS 100       // reavalia a pressão entre as linhas do log
+#define SHED_FRACTION 4             // cada reação devolve 1/4 do que está vivo
+#define SOFT_HIGH 80                // % do limite que já conta como pressão
+#define HARD_HIGH 90                // % do limite que pede MADV_DONTNEED
+
+typedef enum { CHUNK_ANON, CHUNK_FILE } chunk_kind_t;
+
+typedef struct {
+    char* addr;
+    chunk_kind_t kind;
+    off_t offset;       // posição no arquivo (CHUNK_FILE)
+    int live;
+} chunk_t;
+
+typedef struct {
+    long high;
+    long max;
+    long oom;
+    long oom_kill;
+} cgroup_events_t;
+
+static int shed_enabled = 0;
+static double rate_mb = 64;
+static long target_mb = 0;
+static int file_percent = 25;
+
+static char cgroup_dir[512];
+static int cgroup_v2 = 0;
+static long long limit_bytes = 0;   // limite do cgroup ou simulado
+static int limit_simulated = 0;
+
+static chunk_t chunks[MAX_CHUNKS];
+static long chunk_count = 0;
+static long oldest_live = 0;
+static pthread_mutex_t chunks_lock = PTHREAD_MUTEX_INITIALIZER;
+static int file_fd = -1;
+
+static atomic_long anon_live = 0;       // MiB
+static atomic_long file_live = 0;       // MiB
+static atomic_long shed_total = 0;      // MiB
+static atomic_long stall_sum_us = 0;
+static atomic_long stall_max_us = 0;
+static atomic_long stall_count = 0;
+static atomic_int growing_done = 0;
+
+static double start_time;
+
+static double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* ---- cgroup e PSI ---- */
+
+static int file_exists(const char* path) {
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+// Acha o diretório do cgroup de memória (v2, ou v1 com o controlador memory)
+static void cgroup_detect() {
+    char line[512], path[600];
+    FILE* f = fopen("/proc/self/cgroup", "r");
+    if (!f) {
+        return;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\n")] = 0;
+        char* controllers = strchr(line, ':');
+        char* dir = controllers ? strchr(controllers + 1, ':') : NULL;
+        if (!dir) continue;
+        *dir++ = 0;
+        controllers++;
+        if (*controllers == 0) {
+            snprintf(path, sizeof(path), "/sys/fs/cgroup%s/memory.events", strcmp(dir, "/") ? dir : "");
+            if (file_exists(path)) {
+                snprintf(cgroup_dir, sizeof(cgroup_dir), "/sys/fs/cgroup%s", strcmp(dir, "/") ? dir : "");
+                cgroup_v2 = 1;
+                break;
+            }
+        } else if (strstr(controllers, "memory")) {
+            // No container o cgroup costuma aparecer como a raiz da hierarquia
+            const char* candidates[] = {dir, ""};
+            for (int i = 0; i < 2 && !cgroup_dir[0]; i++) {
+                snprintf(path, sizeof(path), "/sys/fs/cgroup/memory%s/memory.usage_in_bytes", candidates[i]);
+                if (file_exists(path)) {
+                    snprintf(cgroup_dir, sizeof(cgroup_dir), "/sys/fs/cgroup/memory%s", candidates[i]);
+                }
+            }
+        }
+    }
+    fclose(f);
+}
+
+// Primeiro número do arquivo do cgroup; -1 se não existir ou for "max"
+static long long cgroup_read(const char* name) {
+    char path[600], buf[64];
+    snprintf(path, sizeof(path), "%s/%s", cgroup_dir, name);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0 || buf[0] < '0' || buf[0] > '9') {
+        return -1;
+    }
+    buf[n] = 0;
+    return atoll(buf);
+}
+
+// Um campo do memory.stat; 0 se não houver
+static long long cgroup_stat(const char* field) {
+    char path[600], key[64];
+    long long value, found = 0;
+    snprintf(path, sizeof(path), "%s/memory.stat", cgroup_dir);
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        return 0;
+    }
+    while (fscanf(f, "%63s %lld", key, &value) == 2) {
+        if (strcmp(key, field) == 0) {
+            found = value;
+            break;
+        }
+    }
+    fclose(f);
+    return found;
+}
+
+// Conjunto de trabalho como o docker stats mostra: o uso menos o que está
+// na lista inativa de arquivo, que o kernel recupera sem esforço. As páginas
+// marcadas com MADV_FREE também vão para essa lista até serem recuperadas
+static long long cgroup_usage() {
+    long long usage = cgroup_read(cgroup_v2 ? "memory.current" : "memory.usage_in_bytes");
+    if (usage < 0) {
+        return -1;
+    }
+    long long inactive = cgroup_stat(cgroup_v2 ? "inactive_file" : "total_inactive_file");
+    return usage > inactive ? usage - inactive : 0;
+}
+
+static void cgroup_events(cgroup_events_t* e) {
+    memset(e, 0, sizeof(*e));
+    char path[600], key[32];
+    long value;
+    if (cgroup_v2) {
+        snprintf(path, sizeof(path), "%s/memory.events", cgroup_dir);
+    } else {
+        // v1: falhas de carga no limite contam como "max"; oom_kill vem do oom_control
+        e->max = cgroup_read("memory.failcnt");
+        snprintf(path, sizeof(path), "%s/memory.oom_control", cgroup_dir);
+    }
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        return;
+    }
+    while (fscanf(f, "%31s %ld", key, &value) == 2) {
+        if (strcmp(key, "high") == 0) e->high = value;
+        if (strcmp(key, "max") == 0) e->max = value;
+        if (strcmp(key, "oom") == 0) e->oom = value;
+        if (strcmp(key, "oom_kill") == 0) e->oom_kill = value;
+        if (strcmp(key, "under_oom") == 0 && value) e->oom++;
+    }
+    fclose(f);
+}
+
+static const char* psi_path() {
+    static char path[600];
+    snprintf(path, sizeof(path), "%s/memory.pressure", cgroup_dir);
+    if (cgroup_v2 && file_exists(path)) {
+        return path;
+    }
+    return "/proc/pressure/memory";
+}
+
+// Gatilho: acorda o poll com POLLPRI quando as tarefas passam 150 ms de
+// cada 2 s paradas esperando memória (some). Sem CAP_SYS_RESOURCE a janela
+// precisa ser múltipla de 2 s
+static int psi_trigger_open() {
+    int fd = open(psi_path(), O_RDWR | O_NONBLOCK);
+    if (fd < 0) {
+        return -1;
+    }
+    const char* trigger = "some 150000 2000000";
+    if (write(fd, trigger, strlen(trigger) + 1) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// avg10 de "some" e de "full"
+static void psi_read(double* some, double* full) {
+    char buf[256];
+    *some = *full = -1;
+    int fd = open(psi_path(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) {
+        return;
+    }
+    buf[n] = 0;
+    char* p = strstr(buf, "some avg10=");
+    if (p) *some = atof(p + 11);
+    p = strstr(buf, "full avg10=");
+    if (p) *full = atof(p + 11);
+}
+
+/* ---- crescimento ---- */
+
+static long long held_bytes() {
+    return (atomic_load(&anon_live) + atomic_load(&file_live)) * (long long)CHUNK_SIZE;
+}
+
+static char* grow_chunk(chunk_kind_t kind, off_t offset) {
+    char* addr;
+    if (kind == CHUNK_FILE) {
+        if (ftruncate(file_fd, offset + CHUNK_SIZE) != 0) {
+            return NULL;
+        }
+        addr = mmap(NULL, CHUNK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, file_fd, offset);
+    } else {
+        addr = mmap(NULL, CHUNK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    if (addr == MAP_FAILED) {
+        return NULL;
+    }
+    // Toca todas as páginas: é aqui que a alocação para quando falta memória
+    memset(addr, (int)(offset / CHUNK_SIZE) | 1, CHUNK_SIZE);
+    return addr;
+}
+
+static void* grower(void* arg) {
+    (void)arg;
+    double step = 1.0 / rate_mb;
+    for (long i = 0; i < target_mb && i < MAX_CHUNKS; i++) {
+        double due = start_time + i * step;
+        double wait = due - now_seconds();
+        if (wait > 0) {
+            usleep((useconds_t)(wait * 1e6));
+        }
+
+        // Distribui os MiB de arquivo de forma regular entre os anônimos
+        chunk_kind_t kind = (i * file_percent / 100) != ((i + 1) * file_percent / 100) ? CHUNK_FILE : CHUNK_ANON;
+        off_t offset = (off_t)i * CHUNK_SIZE;
+        double t0 = now_seconds();
+        char* addr = grow_chunk(kind, offset);
+        long us = (long)((now_seconds() - t0) * 1e6);
+        if (!addr) {
+            fprintf(stderr, "memory_pressure: mmap falhou depois de %ld MiB\n", i);
+            break;
+        }
+
+        atomic_fetch_add(&stall_sum_us, us);
+        atomic_fetch_add(&stall_count, 1);
+        long max = atomic_load(&stall_max_us);
+        while (us > max && !atomic_compare_exchange_weak(&stall_max_us, &max, us)) {
+        }
+
+        pthread_mutex_lock(&chunks_lock);
+        chunks[chunk_count].addr = addr;
+        chunks[chunk_count].kind = kind;
+        chunks[chunk_count].offset = offset;
+        chunks[chunk_count].live = 1;
+        chunk_count++;
+        pthread_mutex_unlock(&chunks_lock);
+        atomic_fetch_add(kind == CHUNK_FILE ? &file_live : &anon_live, 1);
+    }
+    atomic_store(&growing_done, 1);
+    return NULL;
+}
+
+/* ---- descarte ---- */
+
+// Devolve os blocos mais antigos. MADV_FREE só marca as páginas anônimas
+// como descartáveis (o kernel as leva quando precisar, sem escrever em
+// swap); MADV_DONTNEED solta na hora. Páginas de arquivo são escritas,
+// saem do mapeamento e do page cache (POSIX_FADV_DONTNEED).
+static long shed(int severe) {
+    long released = 0;
+    pthread_mutex_lock(&chunks_lock);
+    long live = atomic_load(&anon_live) + atomic_load(&file_live);
+    long goal = live / SHED_FRACTION > 0 ? live / SHED_FRACTION : live;
+    while (released < goal && oldest_live < chunk_count) {
+        chunk_t* c = &chunks[oldest_live++];
+        if (!c->live) continue;
+        if (c->kind == CHUNK_ANON) {
+            madvise(c->addr, CHUNK_SIZE, severe ? MADV_DONTNEED : MADV_FREE);
+            atomic_fetch_sub(&anon_live, 1);
+        } else {
+            msync(c->addr, CHUNK_SIZE, MS_SYNC);
+            madvise(c->addr, CHUNK_SIZE, MADV_DONTNEED);
+            posix_fadvise(file_fd, c->offset, CHUNK_SIZE, POSIX_FADV_DONTNEED);
+            atomic_fetch_sub(&file_live, 1);
+        }
+        c->live = 0;
+        released++;
+    }
+    pthread_mutex_unlock(&chunks_lock);
+    atomic_fetch_add(&shed_total, released);
+    return released;
+}
+
+/* ---- monitoramento ---- */
+
+static long rss_mib() {
+    long size = 0, resident = 0;
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (f) {
+        if (fscanf(f, "%ld %ld", &size, &resident) != 2) resident = 0;
+        fclose(f);
+    }
+    return resident * sysconf(_SC_PAGESIZE) / CHUNK_SIZE;
+}
+
+static long long current_usage() {
+    long long usage = limit_simulated ? -1 : cgroup_usage();
+    return usage >= 0 ? usage : held_bytes();
+}
+
+static void* monitor(void* arg) {
+    (void)arg;
+    int trigger = psi_trigger_open();
+    cgroup_events_t first, last, now;
+    cgroup_events(&first);
+    last = first;
+    struct rusage prev_usage;
+    getrusage(RUSAGE_SELF, &prev_usage);
+
+    double first_pressure = -1, first_shed = -1, first_limit = -1, next_log = now_seconds();
+    int peak_percent = 0, pressure_percent = 0;
+    int hold_logs = 3 * 1000 / LOG_INTERVAL_MS; // 3 s depois de crescer tudo
+
+    printf("%6s %9s %8s %8s %10s %5s %7s %7s %7s %8s %10s %10s %9s  %s\n",
+           "t(s)", "anôn(MiB)", "arq(MiB)", "RSS(MiB)", "uso(MiB)", "%lim", "some10", "full10",
+           "majflt", "minflt", "stall méd", "stall máx", "desc(MiB)", "eventos");
+    for (;;) {
+        int psi_fired = 0;
+        int wait_ms = (int)((next_log - now_seconds()) * 1000);
+        if (wait_ms > CHECK_INTERVAL_MS) wait_ms = CHECK_INTERVAL_MS;
+        if (wait_ms < 0) wait_ms = 0;
+        if (trigger >= 0) {
+            struct pollfd pfd = {trigger, POLLPRI, 0};
+            if (poll(&pfd, 1, wait_ms) > 0 && (pfd.revents & POLLPRI)) {
+                psi_fired = 1;
+            }
+        } else {
+            usleep(wait_ms * 1000);
+        }
+
+        long long usage = current_usage();
+        int percent = (int)(100 * usage / limit_bytes);
+        cgroup_events(&now);
+        int limit_event = now.max > last.max;
+        if (percent > peak_percent) peak_percent = percent;
+        if (limit_event && first_limit < 0) first_limit = now_seconds() - start_time;
+
+        // Reação: o gatilho do PSI, o evento high do cgroup ou o conjunto de
+        // trabalho passando de SOFT_HIGH% contam como pressão. O evento max
+        // sozinho não: com o page cache cheio ele dispara a cada recuperação,
+        // mesmo com pouca memória anônima; só torna o descarte imediato
+        int pressure = psi_fired || now.high > last.high || percent >= SOFT_HIGH;
+        int severe = percent >= HARD_HIGH || (limit_event && percent >= SOFT_HIGH);
+        if (pressure && first_pressure < 0) {
+            first_pressure = now_seconds() - start_time;
+            pressure_percent = percent;
+        }
+        long released = 0;
+        if (pressure && shed_enabled) {
+            released = shed(severe);
+            if (released && first_shed < 0) first_shed = now_seconds() - start_time;
+        }
+
+        if (now_seconds() >= next_log || psi_fired || released) {
+            double some, full;
+            psi_read(&some, &full);
+            struct rusage ru;
+            getrusage(RUSAGE_SELF, &ru);
+            long count = atomic_exchange(&stall_count, 0);
+            long sum = atomic_exchange(&stall_sum_us, 0);
+            long max = atomic_exchange(&stall_max_us, 0);
+            char events[96];
+            snprintf(events, sizeof(events), "%s%s%s%s",
+                     psi_fired ? "psi " : "", now.high > last.high ? "high " : "",
+                     now.max > last.max ? "max " : "", released ? (severe ? "DONTNEED" : "FREE") : "");
+            printf("%6.1f %9ld %8ld %8ld %10lld %4d%% %7.2f %7.2f %7ld %8ld %8ldus %8ldus %9ld  %s\n",
+                   now_seconds() - start_time, atomic_load(&anon_live), atomic_load(&file_live), rss_mib(),
+                   usage / CHUNK_SIZE, percent, some, full, ru.ru_majflt - prev_usage.ru_majflt,
+                   ru.ru_minflt - prev_usage.ru_minflt, count ? sum / count : 0, max,
+                   atomic_load(&shed_total), events);
+            fflush(stdout);
+            prev_usage = ru;
+            next_log = now_seconds() + LOG_INTERVAL_MS / 1000.0;
+            if (atomic_load(&growing_done) && --hold_logs <= 0) {
+                break;
+            }
+        }
+        last = now;
+    }
+
+    printf("\nPico de uso: %d%% do limite%s\n", peak_percent, limit_simulated ? " (simulado)" : "");
+    if (first_pressure >= 0) {
+        printf("Primeira pressão em %.1f s, com %d%% do limite\n", first_pressure, pressure_percent);
+    } else {
+        printf("Nenhuma pressão detectada\n");
+    }
+    if (first_limit >= 0) {
+        printf("Primeiro evento max (carga no limite do cgroup) em %.1f s\n", first_limit);
+    }
+    if (first_shed >= 0) {
+        printf("Primeiro descarte em %.1f s; %ld MiB devolvidos no total\n", first_shed, atomic_load(&shed_total));
+    }
+    printf("memory.events durante a execução: high +%ld, max +%ld, oom +%ld, oom_kill +%ld\n",
+           now.high - first.high, now.max - first.max, now.oom - first.oom, now.oom_kill - first.oom_kill);
+    if (trigger < 0) {
+        printf("(sem gatilho de PSI: %s indisponível ou sem permissão)\n", psi_path());
+    }
+    if (trigger >= 0) close(trigger);
+    return NULL;
+}
+
+static int run_child() {
+    // Arquivo apagado logo depois de aberto: o page cache some com o processo
+    const char* dir = getenv("PRESSURE_DIR") ? getenv("PRESSURE_DIR") : ".";
+    char path[512];
+    snprintf(path, sizeof(path), "%s/memory_pressure.XXXXXX", dir);
+    file_fd = mkstemp(path);
+    if (file_fd < 0) {
+        perror(path);
+        return 1;
+    }
+    unlink(path);
+
+    start_time = now_seconds();
+    pthread_t grow_thread, monitor_thread;
+    pthread_create(&monitor_thread, NULL, monitor, NULL);
+    pthread_create(&grow_thread, NULL, grower, NULL);
+    pthread_join(grow_thread, NULL);
+    pthread_join(monitor_thread, NULL);
+    close(file_fd);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    printf("=== DEMONSTRAÇÃO: PRESSÃO DE MEMÓRIA ===\n");
+    perf_counters_init();
+
+    int option = 1;
+    if (argc > 1) {
+        option = atoi(argv[1]);
+    }
+    if (option != 1 && option != 2) {
+        printf("Opções: 1=cresce até o limite (OOM), 2=cresce e descarta sob pressão\n");
+        option = 1;
+    }
+    shed_enabled = option == 2;
+    if (argc > 2 && atof(argv[2]) > 0) rate_mb = atof(argv[2]);
+    if (argc > 4) file_percent = atoi(argv[4]);
+    if (file_percent < 0) file_percent = 0;
+    if (file_percent > 100) file_percent = 100;
+
+    cgroup_detect();
+    long long limit = cgroup_dir[0] ? cgroup_read(cgroup_v2 ? "memory.max" : "memory.limit_in_bytes") : -1;
+    long page_count = sysconf(_SC_PHYS_PAGES);
+    long long physical = (long long)page_count * sysconf(_SC_PAGESIZE);
+    target_mb = argc > 3 ? atol(argv[3]) : 0;
+    if (limit > 0 && limit < physical) {
+        limit_bytes = limit;
+        if (target_mb <= 0) target_mb = 2 * limit / CHUNK_SIZE; // passa do limite com folga
+    } else {
+        // Sem limite no cgroup: metade do alvo vira um limite simulado, medido
+        // pelo que o próprio processo segura
+        if (target_mb <= 0) target_mb = 512;
+        limit_bytes = target_mb * (long long)CHUNK_SIZE / 2;
+        limit_simulated = 1;
+    }
+    if (target_mb > MAX_CHUNKS) target_mb = MAX_CHUNKS;
+
+    printf("cgroup: %s (%s)\n", cgroup_dir[0] ? cgroup_dir : "não encontrado", cgroup_v2 ? "v2" : "v1");
+    printf("Limite: %lld MiB%s; alvo: %ld MiB a %.0f MiB/s, %d%% em arquivo mapeado\n",
+           limit_bytes / CHUNK_SIZE, limit_simulated ? " (simulado: o cgroup não tem limite)" : "",
+           target_mb, rate_mb, file_percent);
+    printf("Modo: %s\n\n", shed_enabled ? "descarta com MADV_FREE/MADV_DONTNEED sob pressão" : "só cresce");
+    fflush(stdout);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return 1;
+    }
+    if (pid == 0) {
+        int code = run_child();
+        fflush(stdout);
+        _exit(code);
+    }
+
+    cgroup_events_t before, after;
+    cgroup_events(&before);
+    int status;
+    waitpid(pid, &status, 0);
+    cgroup_events(&after);
+
+    if (WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL) {
+        printf("\nFilho morto por SIGKILL%s\n",
+               after.oom_kill > before.oom_kill ? " pelo OOM killer (oom_kill no memory.events)" : "");
+        return 137;
+    }
+    if (WIFSIGNALED(status)) {
+        printf("\nFilho morto pelo sinal %d\n", WTERMSIG(status));
+        return 128 + WTERMSIG(status);
+    }
+    printf("\nFilho terminou sem ser morto pelo OOM killer\n");
+    return WEXITSTATUS(status);
+}
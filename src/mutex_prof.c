@@ -0,0 +1,406 @@
+/*
+ * Perfil de contenção de mutex - implementação
+ *
+ * Cada thread conta em um bloco próprio (sem atômicos nem locks no caminho
+ * do lock). Quando a thread termina, o destrutor da chave pthread soma o
+ * bloco no total global e devolve o bloco ao pool; os blocos nunca são
+ * liberados, então o dump em SIGUSR2 pode percorrê-los a qualquer momento
+ * (os números de threads vivas são uma leitura aproximada, sem parar ninguém).
+ */
+
+#define _GNU_SOURCE
+#include "mutex_prof.h"
+#include "sigsafe.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+// Bucket b guarda tempos em [2^(b-1), 2^b) ns; o último acumula o resto (~34 s+)
+#define HIST_BUCKETS 36
+
+typedef struct {
+    uint64_t acquisitions;
+    uint64_t contended;
+    uint64_t wait_max_ns;
+    uint64_t hold_max_ns;
+    uint64_t wait_hist[HIST_BUCKETS];
+    uint64_t hold_hist[HIST_BUCKETS];
+} lock_stats_t;
+
+typedef struct {
+    atomic_int in_use;
+    int tid;
+    _Atomic(mutex_prof_info_t*) waiting_on;
+    long wait_start_ns;
+    lock_stats_t stats[MUTEX_PROF_MAX_LOCKS];
+} prof_thread_t;
+
+static int enabled = 0;
+
+static mutex_prof_info_t* lock_table[MUTEX_PROF_MAX_LOCKS];
+static atomic_int lock_count = 0;
+
+static prof_thread_t* thread_pool[MUTEX_PROF_MAX_THREADS];
+static atomic_int pool_size = 0;
+static __thread prof_thread_t* self = NULL;
+static __thread int self_tid = 0;
+
+// Somatório das threads que já terminaram
+static lock_stats_t merged[MUTEX_PROF_MAX_LOCKS];
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t exit_key;
+
+static long monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static int bucket_of(uint64_t ns) {
+    int b = ns ? 64 - __builtin_clzll(ns) : 0;
+    return b < HIST_BUCKETS ? b : HIST_BUCKETS - 1;
+}
+
+static void add_stats(lock_stats_t* into, const lock_stats_t* from) {
+    into->acquisitions += from->acquisitions;
+    into->contended += from->contended;
+    if (from->wait_max_ns > into->wait_max_ns) into->wait_max_ns = from->wait_max_ns;
+    if (from->hold_max_ns > into->hold_max_ns) into->hold_max_ns = from->hold_max_ns;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        into->wait_hist[b] += from->wait_hist[b];
+        into->hold_hist[b] += from->hold_hist[b];
+    }
+}
+
+static void thread_exit(void* arg) {
+    prof_thread_t* t = arg;
+
+    pthread_mutex_lock(&registry_lock);
+    for (int i = 0; i < MUTEX_PROF_MAX_LOCKS; i++) {
+        add_stats(&merged[i], &t->stats[i]);
+    }
+    memset(t->stats, 0, sizeof(t->stats));
+    atomic_store(&t->in_use, 0);
+    pthread_mutex_unlock(&registry_lock);
+}
+
+static prof_thread_t* current_thread() {
+    if (self) {
+        return self;
+    }
+    if (self_tid < 0) {
+        return NULL; // pool cheio: thread fica sem perfil
+    }
+
+    // Reaproveita o bloco de uma thread que já terminou
+    prof_thread_t* t = NULL;
+    pthread_mutex_lock(&registry_lock);
+    int size = atomic_load(&pool_size);
+    for (int i = 0; i < size && !t; i++) {
+        if (!atomic_load(&thread_pool[i]->in_use)) {
+            t = thread_pool[i];
+        }
+    }
+    if (!t && size < MUTEX_PROF_MAX_THREADS) {
+        t = calloc(1, sizeof(prof_thread_t));
+        if (t) {
+            thread_pool[size] = t;
+            atomic_store(&pool_size, size + 1);
+        }
+    }
+    if (t) {
+        t->tid = gettid();
+        atomic_store(&t->waiting_on, NULL);
+        atomic_store(&t->in_use, 1);
+    }
+    pthread_mutex_unlock(&registry_lock);
+
+    if (!t) {
+        self_tid = -1;
+        return NULL;
+    }
+    self = t;
+    self_tid = t->tid;
+    pthread_setspecific(exit_key, t);
+    return t;
+}
+
+static int lock_id(mutex_prof_info_t* info) {
+    int id = atomic_load_explicit(&info->id, memory_order_acquire);
+    if (id >= 0) {
+        return id;
+    }
+
+    pthread_mutex_lock(&registry_lock);
+    id = atomic_load(&info->id);
+    int count = atomic_load(&lock_count);
+    if (id < 0 && count < MUTEX_PROF_MAX_LOCKS) {
+        id = count;
+        lock_table[id] = info;
+        atomic_store(&lock_count, count + 1);
+        atomic_store_explicit(&info->id, id, memory_order_release);
+    }
+    pthread_mutex_unlock(&registry_lock);
+    return id;
+}
+
+/* ---- ganchos ---- */
+
+long mutex_prof_wait_begin(mutex_prof_info_t* info) {
+    trace_lock(TRACE_LOCK_WAIT, info, info->name);
+    if (!enabled) {
+        return 0;
+    }
+    long now = monotonic_ns();
+    prof_thread_t* t = current_thread();
+    if (t) {
+        t->wait_start_ns = now;
+        atomic_store(&t->waiting_on, info);
+    }
+    atomic_fetch_add(&info->waiters, 1);
+    return now;
+}
+
+void mutex_prof_acquired(mutex_prof_info_t* info, long wait_start_ns, const char* file, int line) {
+    trace_lock(TRACE_LOCK_ACQUIRE, info, info->name);
+    if (!enabled) {
+        return;
+    }
+    long now = monotonic_ns();
+    prof_thread_t* t = current_thread();
+    int id = lock_id(info);
+
+    if (wait_start_ns) {
+        atomic_fetch_sub(&info->waiters, 1);
+    }
+    if (t && id >= 0) {
+        lock_stats_t* s = &t->stats[id];
+        uint64_t wait = wait_start_ns ? now - wait_start_ns : 0;
+        s->acquisitions++;
+        s->contended += wait_start_ns != 0;
+        s->wait_hist[bucket_of(wait)]++;
+        if (wait > s->wait_max_ns) s->wait_max_ns = wait;
+        atomic_store(&t->waiting_on, NULL);
+    }
+
+    info->hold_start_ns = now;
+    info->holder_file = file;
+    info->holder_line = line;
+    atomic_store_explicit(&info->holder, t ? t->tid : gettid(), memory_order_release);
+}
+
+void mutex_prof_releasing(mutex_prof_info_t* info) {
+    trace_lock(TRACE_LOCK_RELEASE, info, info->name);
+    if (!enabled) {
+        return;
+    }
+    prof_thread_t* t = current_thread();
+    int id = atomic_load_explicit(&info->id, memory_order_acquire);
+
+    // Lock pego antes de o profiler ligar: sem início de posse conhecido
+    if (t && id >= 0 && atomic_load(&info->holder) == t->tid) {
+        lock_stats_t* s = &t->stats[id];
+        uint64_t hold = monotonic_ns() - info->hold_start_ns;
+        s->hold_hist[bucket_of(hold)]++;
+        if (hold > s->hold_max_ns) s->hold_max_ns = hold;
+    }
+    atomic_store_explicit(&info->holder, 0, memory_order_release);
+}
+
+/* ---- mutex_prof_t ---- */
+
+void mutex_prof_init_lock(mutex_prof_t* m, const char* name) {
+    pthread_mutex_init(&m->mutex, NULL);
+    mutex_prof_info_t info = MUTEX_PROF_INFO_INITIALIZER(name);
+    m->info = info;
+}
+
+void mutex_prof_lock_at(mutex_prof_t* m, const char* file, int line) {
+    if (!enabled && !trace_enabled()) {
+        pthread_mutex_lock(&m->mutex);
+        return;
+    }
+
+    long wait_start = 0;
+    if (pthread_mutex_trylock(&m->mutex) != 0) {
+        wait_start = mutex_prof_wait_begin(&m->info);
+        pthread_mutex_lock(&m->mutex);
+    }
+    mutex_prof_acquired(&m->info, wait_start, file, line);
+}
+
+void mutex_prof_unlock(mutex_prof_t* m) {
+    mutex_prof_releasing(&m->info);
+    pthread_mutex_unlock(&m->mutex);
+}
+
+/* ---- relatório (seguro em contexto de sinal) ---- */
+
+static int format_dec(char* out, uint64_t v) {
+    char tmp[24];
+    int n = 0;
+    do {
+        tmp[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    for (int i = 0; i < n; i++) out[i] = tmp[n - 1 - i];
+    out[n] = '\0';
+    return n;
+}
+
+static void put_num(sig_writer_t* w, uint64_t v, int width) {
+    char tmp[24];
+    format_dec(tmp, v);
+    sig_right(w, tmp, width);
+}
+
+// Tempo com a unidade que deixa no máximo 4 dígitos (ns, us, ms, s)
+static void put_time(sig_writer_t* w, uint64_t ns, int width) {
+    static const char* units[] = {"ns", "us", "ms", "s"};
+    int unit = 0;
+    while (ns >= 10000 && unit < 3) {
+        ns /= 1000;
+        unit++;
+    }
+    char tmp[32];
+    int n = format_dec(tmp, ns);
+    strcpy(tmp + n, units[unit]);
+    sig_right(w, tmp, width);
+}
+
+// Limite superior do bucket que contém o percentil
+static uint64_t percentile(const uint64_t hist[HIST_BUCKETS], uint64_t max, int pct) {
+    uint64_t total = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++) total += hist[b];
+    if (!total) return 0;
+
+    uint64_t rank = (total * pct + 99) / 100, seen = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += hist[b];
+        if (seen >= rank) {
+            uint64_t bound = b ? (1ULL << b) - 1 : 0;
+            return bound < max ? bound : max;
+        }
+    }
+    return max;
+}
+
+static void write_report(int live) {
+    sig_writer_t w = {.fd = STDERR_FILENO};
+    long now = monotonic_ns();
+
+    sig_str(&w, live ? "\n=== MUTEX_PROF (SIGUSR2) ===" : "\n=== MUTEX_PROF ===");
+    sig_end_line(&w);
+    sig_str(&w, "(p50/p99 pelo limite do bucket log2; posse só de locks já liberados)");
+    sig_end_line(&w);
+    sig_left(&w, "lock", 18);
+    sig_str(&w, "  aquisições");
+    sig_str(&w, "  contendidas");
+    sig_str(&w, "  espera p50     p99     max");
+    sig_str(&w, "   posse p50     p99     max");
+    sig_end_line(&w);
+
+    int count = atomic_load(&lock_count);
+    int threads = atomic_load(&pool_size);
+    for (int id = 0; id < count; id++) {
+        lock_stats_t s = merged[id];
+        for (int i = 0; i < threads; i++) {
+            if (atomic_load(&thread_pool[i]->in_use)) {
+                add_stats(&s, &thread_pool[i]->stats[id]);
+            }
+        }
+
+        sig_left(&w, lock_table[id]->name ? lock_table[id]->name : "?", 18);
+        put_num(&w, s.acquisitions, 12);
+        put_num(&w, s.contended, 13);
+        put_time(&w, percentile(s.wait_hist, s.wait_max_ns, 50), 12);
+        put_time(&w, percentile(s.wait_hist, s.wait_max_ns, 99), 8);
+        put_time(&w, s.wait_max_ns, 8);
+        put_time(&w, percentile(s.hold_hist, s.hold_max_ns, 50), 12);
+        put_time(&w, percentile(s.hold_hist, s.hold_max_ns, 99), 8);
+        put_time(&w, s.hold_max_ns, 8);
+        sig_end_line(&w);
+    }
+
+    // Quem segura e quem espera neste instante
+    for (int id = 0; id < count; id++) {
+        mutex_prof_info_t* info = lock_table[id];
+        int holder = atomic_load(&info->holder);
+        if (!holder) continue;
+
+        sig_str(&w, "  ");
+        sig_str(&w, info->name ? info->name : "?");
+        sig_str(&w, " está com tid ");
+        put_num(&w, holder, 0);
+        sig_str(&w, " há ");
+        put_time(&w, now - info->hold_start_ns, 0);
+        if (info->holder_file) {
+            sig_str(&w, " (adquirido em ");
+            sig_str(&w, info->holder_file);
+            sig_str(&w, ":");
+            put_num(&w, info->holder_line, 0);
+            sig_str(&w, ")");
+        }
+        sig_str(&w, ", ");
+        put_num(&w, atomic_load(&info->waiters), 0);
+        sig_str(&w, " esperando");
+        sig_end_line(&w);
+    }
+    for (int i = 0; i < threads; i++) {
+        prof_thread_t* t = thread_pool[i];
+        mutex_prof_info_t* waiting = atomic_load(&t->waiting_on);
+        if (!atomic_load(&t->in_use) || !waiting) continue;
+
+        sig_str(&w, "  tid ");
+        put_num(&w, t->tid, 0);
+        sig_str(&w, " espera ");
+        sig_str(&w, waiting->name ? waiting->name : "?");
+        sig_str(&w, " há ");
+        put_time(&w, now - t->wait_start_ns, 0);
+        sig_end_line(&w);
+    }
+}
+
+void mutex_prof_report() {
+    if (enabled) {
+        write_report(0);
+    }
+}
+
+static void report_at_exit() {
+    fflush(stdout);
+    mutex_prof_report();
+    enabled = 0; // não repete se report() já foi chamado antes de _exit/exit
+}
+
+static void dump_signal(int sig) {
+    (void)sig;
+    if (enabled) {
+        write_report(1);
+    }
+}
+
+void mutex_prof_init() {
+    const char* env = getenv("MUTEX_PROF");
+    if (!env || strcmp(env, "1") != 0) {
+        return;
+    }
+
+    pthread_key_create(&exit_key, thread_exit);
+    atexit(report_at_exit);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = dump_signal;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR2, &sa, NULL);
+
+    enabled = 1;
+}
@@ -0,0 +1,74 @@
+/*
+ * Perfil de contenção de mutex
+ *
+ * Com MUTEX_PROF=1 no ambiente, cada aquisição de um lock instrumentado
+ * registra se encontrou o lock ocupado, quanto tempo esperou e, na
+ * liberação, quanto tempo o segurou. Os tempos vão para histogramas com
+ * buckets log2 (p50/p99 aproximados pelo limite do bucket, máximo exato),
+ * contados em memória da própria thread e somados quando ela termina.
+ *
+ * A tabela por lock é impressa em stderr no fim do processo. Com
+ * kill -USR2 <pid> sai na hora, junto com quem segura cada lock (tid,
+ * há quanto tempo e onde adquiriu) e por qual lock cada thread espera:
+ * dá para ver o que está quente num processo travado.
+ *
+ * Os mesmos ganchos gravam espera/aquisição/liberação no trace binário
+ * quando TRACE_OUT está definido (ver trace.h).
+ *
+ * Sem MUTEX_PROF=1 nem TRACE_OUT o custo é um teste de flag por
+ * lock/unlock.
+ */
+
+#ifndef MUTEX_PROF_H
+#define MUTEX_PROF_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define MUTEX_PROF_MAX_LOCKS 64
+#define MUTEX_PROF_MAX_THREADS 256
+
+// Estado do profiler para um lock (embutido em mutex_prof_t e lockdep_mutex_t)
+typedef struct {
+    const char* name;
+    atomic_int id;          // linha na tabela (-1 até o primeiro uso)
+    atomic_int holder;      // tid do dono (0 se livre)
+    atomic_int waiters;
+    long hold_start_ns;
+    const char* holder_file;
+    int holder_line;
+} mutex_prof_info_t;
+
+#define MUTEX_PROF_INFO_INITIALIZER(lock_name) \
+    { (lock_name), -1, 0, 0, 0, NULL, 0 }
+
+typedef struct {
+    pthread_mutex_t mutex;
+    mutex_prof_info_t info;
+} mutex_prof_t;
+
+#define MUTEX_PROF_INITIALIZER(lock_name) \
+    { PTHREAD_MUTEX_INITIALIZER, MUTEX_PROF_INFO_INITIALIZER(lock_name) }
+
+// Lê MUTEX_PROF=1, registra o relatório no atexit e o dump em SIGUSR2
+void mutex_prof_init();
+
+// Equivalente a pthread_mutex_init para locks criados em tempo de execução
+void mutex_prof_init_lock(mutex_prof_t* m, const char* name);
+
+void mutex_prof_lock_at(mutex_prof_t* m, const char* file, int line);
+void mutex_prof_unlock(mutex_prof_t* m);
+
+#define mutex_prof_lock(m) mutex_prof_lock_at((m), __FILE__, __LINE__)
+
+// Ganchos para camadas que fazem a própria espera (lockdep):
+// wait_begin devolve o instante do início da espera (0 se desligado);
+// acquired recebe esse instante, ou 0 se o trylock pegou o lock direto
+long mutex_prof_wait_begin(mutex_prof_info_t* info);
+void mutex_prof_acquired(mutex_prof_info_t* info, long wait_start_ns, const char* file, int line);
+void mutex_prof_releasing(mutex_prof_info_t* info);
+
+// Imprime a tabela agora (seguro em contexto de sinal)
+void mutex_prof_report();
+
+#endif
@@ -0,0 +1,427 @@
+/*
+ * Contadores de desempenho por thread e por fase - implementação
+ *
+ * Cada thread instrumentada tem um grupo perf (líder + irmãos) lido de uma
+ * vez com PERF_FORMAT_GROUP; tempo habilitado/rodando corrige a escala
+ * quando o kernel multiplexa contadores. O relatório é montado à mão num
+ * buffer e enviado com write(), assim o mesmo código serve para a saída
+ * normal e para o tratador de falha.
+ */
+
+#define _GNU_SOURCE
+#include "perf_counters.h"
+#include "sigsafe.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#define PERF_MAX_ROWS 128
+#define PERF_MAX_LIVE 256
+#define ALT_STACK_SIZE (64 * 1024)
+
+typedef enum {
+    EV_CPU_NS,
+    EV_CYCLES,
+    EV_INSTRUCTIONS,
+    EV_CACHE_MISSES,
+    EV_CONTEXT_SWITCHES,
+    EV_PAGE_FAULTS,
+    EV_COUNT
+} event_t;
+
+typedef struct {
+    const char* header;
+    int width;
+    uint32_t type;
+    uint64_t config;
+} event_desc_t;
+
+static const event_desc_t events[EV_COUNT] = {
+    {"cpu(ms)",     10, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+    {"ciclos",      14, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instruções",  14, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"cache-miss",  12, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"trocas-ctx",  11, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+    {"page-faults", 12, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+};
+
+typedef struct {
+    int leader;
+    int fds[EV_COUNT];
+    int slot[EV_COUNT];   // posição do evento na leitura do grupo (-1 se fechado)
+    int opened;
+    uint64_t start[EV_COUNT];
+    const char* label;
+    const char* phase;
+} thread_counters_t;
+
+typedef struct {
+    const char* phase;
+    const char* label;
+    int threads;
+    uint64_t values[EV_COUNT];
+} row_t;
+
+static int enabled = 0;
+static int available[EV_COUNT];   // evento abre via perf_event_open
+static int user_only[EV_COUNT];   // aberto com exclude_kernel (paranoid >= 2)
+static int hardware_missing = 0;
+
+static row_t rows[PERF_MAX_ROWS];
+static int row_count = 0;
+static pthread_mutex_t rows_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Threads ainda contando: entram no relatório de falha ou de deadlock,
+// quando nunca chegam a perf_thread_end() (o fd perf pode ser lido de
+// qualquer thread do processo)
+static thread_counters_t* live[PERF_MAX_LIVE];
+
+static const char* current_phase = "-";
+static thread_counters_t main_counters;
+static uint64_t phase_start[EV_COUNT];
+static __thread thread_counters_t* self = NULL;
+static struct sigaction previous[NSIG]; // tratadores de falha instalados antes do nosso
+
+static long perf_event_open(struct perf_event_attr* attr, int group_fd) {
+    return syscall(SYS_perf_event_open, attr, 0, -1, group_fd, 0);
+}
+
+static int open_event(int e, int group_fd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = events[e].type;
+    attr.config = events[e].config;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_kernel = user_only[e];
+    attr.exclude_hv = 1;
+    return (int)perf_event_open(&attr, group_fd);
+}
+
+static void open_group(thread_counters_t* t) {
+    t->leader = -1;
+    t->opened = 0;
+    for (int e = 0; e < EV_COUNT; e++) {
+        t->fds[e] = -1;
+        t->slot[e] = -1;
+        if (!available[e]) continue;
+
+        int fd = open_event(e, t->leader);
+        if (fd < 0) continue;
+        if (t->leader < 0) t->leader = fd;
+        t->fds[e] = fd;
+        t->slot[e] = t->opened++;
+    }
+}
+
+static void close_group(thread_counters_t* t) {
+    for (int e = 0; e < EV_COUNT; e++) {
+        if (t->fds[e] >= 0) close(t->fds[e]);
+        t->fds[e] = -1;
+    }
+    t->leader = -1;
+}
+
+// Valores absolutos da thread t; seguro em contexto de sinal. As
+// alternativas sem perf só medem a thread que chama: para as demais o
+// evento fica com o valor inicial (delta zero)
+static void snapshot(const thread_counters_t* t, uint64_t values[EV_COUNT]) {
+    int own = t == self;
+    uint64_t buf[3 + EV_COUNT];
+    memset(values, 0, sizeof(uint64_t) * EV_COUNT);
+
+    if (t->leader >= 0 && read(t->leader, buf, sizeof(buf)) > 0) {
+        uint64_t nr = buf[0], time_enabled = buf[1], time_running = buf[2];
+        for (int e = 0; e < EV_COUNT; e++) {
+            if (t->slot[e] < 0 || (uint64_t)t->slot[e] >= nr) continue;
+            uint64_t v = buf[3 + t->slot[e]];
+            if (time_running && time_running < time_enabled) {
+                v = (uint64_t)((double)v * time_enabled / time_running);
+            }
+            values[e] = v;
+        }
+    }
+
+    // Alternativas de software quando o evento não abriu
+    if (!own) {
+        for (int e = 0; e < EV_COUNT; e++) {
+            if (t->slot[e] < 0) values[e] = t->start[e];
+        }
+        return;
+    }
+    if (t->slot[EV_CPU_NS] < 0) {
+        struct timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        values[EV_CPU_NS] = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+    if (t->slot[EV_CONTEXT_SWITCHES] < 0 || t->slot[EV_PAGE_FAULTS] < 0) {
+        struct rusage usage;
+        getrusage(RUSAGE_THREAD, &usage);
+        if (t->slot[EV_CONTEXT_SWITCHES] < 0) values[EV_CONTEXT_SWITCHES] = usage.ru_nvcsw + usage.ru_nivcsw;
+        if (t->slot[EV_PAGE_FAULTS] < 0) values[EV_PAGE_FAULTS] = usage.ru_minflt + usage.ru_majflt;
+    }
+}
+
+static void set_live(thread_counters_t* from, thread_counters_t* to) {
+    pthread_mutex_lock(&rows_lock);
+    for (int i = 0; i < PERF_MAX_LIVE; i++) {
+        if (live[i] == from) {
+            live[i] = to;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&rows_lock);
+}
+
+static void add_row(const char* phase, const char* label, const uint64_t delta[EV_COUNT]) {
+    pthread_mutex_lock(&rows_lock);
+    int i = 0;
+    while (i < row_count && !(rows[i].phase == phase && rows[i].label == label)) i++;
+    if (i == row_count && row_count < PERF_MAX_ROWS) {
+        rows[i].phase = phase;
+        rows[i].label = label;
+        row_count++;
+    }
+    if (i < PERF_MAX_ROWS) {
+        rows[i].threads++;
+        for (int e = 0; e < EV_COUNT; e++) {
+            rows[i].values[e] += delta[e];
+        }
+    }
+    pthread_mutex_unlock(&rows_lock);
+}
+
+/* ---- relatório (seguro em contexto de sinal) ---- */
+
+static void put_num(sig_writer_t* w, uint64_t v, int width, int decimals_of_million) {
+    char tmp[32];
+    int i = sizeof(tmp) - 1;
+    tmp[i] = '\0';
+    if (decimals_of_million) {
+        // ns -> ms com uma casa decimal
+        uint64_t tenths = v / 100000;
+        tmp[--i] = '0' + tenths % 10;
+        tmp[--i] = '.';
+        v = tenths / 10;
+    }
+    do {
+        tmp[--i] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    sig_right(w, tmp + i, width);
+}
+
+static void put_values(sig_writer_t* w, const uint64_t values[EV_COUNT], int hw_ok) {
+    for (int e = 0; e < EV_COUNT; e++) {
+        if (events[e].type == PERF_TYPE_HARDWARE && (!available[e] || !hw_ok)) {
+            sig_right(w, "-", events[e].width);
+        } else {
+            put_num(w, values[e], events[e].width, e == EV_CPU_NS);
+        }
+    }
+}
+
+static void write_report(int fd, int crashing) {
+    sig_writer_t w = {.fd = fd};
+
+    sig_str(&w, crashing ? "\n=== PERF_COUNTERS (no momento da falha) ===" : "\n=== PERF_COUNTERS ===");
+    sig_end_line(&w);
+    if (hardware_missing) {
+        sig_str(&w, "(contadores de hardware indisponíveis aqui: colunas com \"-\")");
+        sig_end_line(&w);
+    }
+
+    sig_left(&w, "fase", 14);
+    sig_left(&w, "thread", 14);
+    sig_left(&w, "   qtd", 6);
+    for (int e = 0; e < EV_COUNT; e++) {
+        sig_char(&w, ' ');
+        sig_right(&w, events[e].header, events[e].width - 1);
+    }
+    sig_end_line(&w);
+
+    int count = row_count;
+    for (int i = 0; i < count; i++) {
+        sig_left(&w, rows[i].phase, 14);
+        sig_left(&w, rows[i].label, 14);
+        put_num(&w, rows[i].threads, 6, 0);
+        put_values(&w, rows[i].values, 1);
+        sig_end_line(&w);
+    }
+
+    // Threads que não terminaram (a principal desde o início); a thread
+    // que falhou é marcada com "*"
+    for (int i = 0; i < PERF_MAX_LIVE; i++) {
+        thread_counters_t* t = live[i];
+        if (!t) continue;
+        uint64_t now[EV_COUNT], delta[EV_COUNT];
+        snapshot(t, now);
+        for (int e = 0; e < EV_COUNT; e++) delta[e] = now[e] - t->start[e];
+        const char* name;
+        if (t == &main_counters) {
+            name = crashing && t == self ? "(total)*" : "(total)";
+        } else {
+            name = crashing && t == self ? "(ativa)*" : "(ativa)";
+        }
+        sig_left(&w, name, 14);
+        sig_left(&w, t->label, 14);
+        put_num(&w, 1, 6, 0);
+        put_values(&w, delta, 1);
+        sig_end_line(&w);
+    }
+
+    // Conferência pelo kernel: processo inteiro via getrusage
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    uint64_t process[EV_COUNT] = {0};
+    process[EV_CPU_NS] = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000ULL +
+                         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000ULL;
+    process[EV_CONTEXT_SWITCHES] = usage.ru_nvcsw + usage.ru_nivcsw;
+    process[EV_PAGE_FAULTS] = usage.ru_minflt + usage.ru_majflt;
+    sig_left(&w, "(processo)", 14);
+    sig_left(&w, "rusage", 14);
+    sig_left(&w, "     -", 6);
+    put_values(&w, process, 0);
+    sig_end_line(&w);
+}
+
+void perf_counters_crash_report(int fd) {
+    if (enabled) {
+        write_report(fd, 1);
+    }
+}
+
+void perf_counters_report() {
+    if (enabled) {
+        write_report(STDERR_FILENO, 0);
+    }
+}
+
+static void report_at_exit() {
+    fflush(stdout); // a tabela sai depois da saída do cenário
+    perf_counters_report();
+    enabled = 0; // não repete se report() já foi chamado explicitamente antes de exit
+}
+
+static void crash_signal(int sig, siginfo_t* info, void* context) {
+    perf_counters_crash_report(STDERR_FILENO);
+    enabled = 0;
+
+    // Mantém o resultado original: quem estava antes (o crash_handler no
+    // core_dump) ou a ação padrão, com o sinal se repetindo
+    sig_chain(sig, info, context, &previous[sig]);
+}
+
+/* ---- API ---- */
+
+void perf_counters_init() {
+    const char* env = getenv("PERF_COUNTERS");
+    if (!env || strcmp(env, "1") != 0) {
+        return;
+    }
+
+    // Descobre quais eventos este ambiente permite. Sem privilégio
+    // (perf_event_paranoid=2) só dá para contar o espaço de usuário; trocas
+    // de contexto e page faults acontecem no kernel e nesse caso ficam com
+    // getrusage, que conta de verdade
+    for (int e = 0; e < EV_COUNT; e++) {
+        user_only[e] = 0;
+        int fd = open_event(e, -1);
+        if (fd < 0 && e != EV_CONTEXT_SWITCHES && e != EV_PAGE_FAULTS) {
+            user_only[e] = 1;
+            fd = open_event(e, -1);
+        }
+        available[e] = fd >= 0;
+        if (fd >= 0) close(fd);
+        if (events[e].type == PERF_TYPE_HARDWARE && fd < 0) hardware_missing = 1;
+    }
+    enabled = 1;
+
+    main_counters.label = "main";
+    open_group(&main_counters);
+    self = &main_counters;
+    snapshot(&main_counters, main_counters.start);
+    set_live(NULL, self);
+    atexit(report_at_exit);
+
+    // Pilha alternativa para também reportar estouro de pilha (reaproveita
+    // a do crash_handler se já houver uma)
+    stack_t alt;
+    if (sigaltstack(NULL, &alt) == 0 && (alt.ss_flags & SS_DISABLE)) {
+        alt.ss_sp = mmap(NULL, ALT_STACK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        alt.ss_size = ALT_STACK_SIZE;
+        alt.ss_flags = 0;
+        if (alt.ss_sp != MAP_FAILED) {
+            sigaltstack(&alt, NULL);
+        }
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = crash_signal;
+    sa.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_RESETHAND;
+    sigemptyset(&sa.sa_mask);
+    int fatal[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+    for (int i = 0; i < (int)(sizeof(fatal) / sizeof(fatal[0])); i++) {
+        sigaction(fatal[i], &sa, &previous[fatal[i]]);
+    }
+}
+
+void perf_thread_begin(const char* label) {
+    if (!enabled || self) {
+        return;
+    }
+    thread_counters_t* t = malloc(sizeof(thread_counters_t));
+    t->label = label;
+    t->phase = current_phase;
+    open_group(t);
+    self = t;
+    snapshot(t, t->start);
+    set_live(NULL, t);
+}
+
+void perf_thread_end() {
+    thread_counters_t* t = self;
+    if (!enabled || !t || t == &main_counters) {
+        return;
+    }
+
+    uint64_t now[EV_COUNT], delta[EV_COUNT];
+    snapshot(t, now);
+    for (int e = 0; e < EV_COUNT; e++) delta[e] = now[e] - t->start[e];
+    add_row(t->phase, t->label, delta);
+    set_live(t, NULL);
+
+    close_group(t);
+    self = NULL;
+    free(t);
+}
+
+void perf_phase_begin(const char* name) {
+    if (!enabled) {
+        return;
+    }
+    current_phase = name;
+    snapshot(&main_counters, phase_start);
+}
+
+void perf_phase_end() {
+    if (!enabled) {
+        return;
+    }
+    uint64_t now[EV_COUNT], delta[EV_COUNT];
+    snapshot(&main_counters, now);
+    for (int e = 0; e < EV_COUNT; e++) delta[e] = now[e] - phase_start[e];
+    add_row(current_phase, "main", delta);
+    current_phase = "-";
+}
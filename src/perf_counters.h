@@ -0,0 +1,40 @@
+/*
+ * Contadores de desempenho por thread e por fase (perf_event_open)
+ *
+ * Com PERF_COUNTERS=1 no ambiente, abre para cada thread instrumentada um
+ * grupo de contadores: ciclos, instruções e cache misses (hardware) e
+ * tempo de CPU, trocas de contexto e page faults (software). Num container
+ * ou VM sem PMU os contadores de hardware aparecem como "-"; se nem os de
+ * software puderem ser abertos (perf_event_paranoid, seccomp), o tempo de
+ * CPU, as trocas de contexto e os page faults vêm de getrusage(RUSAGE_THREAD)
+ * e CLOCK_THREAD_CPUTIME_ID.
+ *
+ * Os valores são somados por (fase, rótulo da thread) e impressos numa
+ * tabela em stderr ao sair do processo ou, se o processo falhar, pelo
+ * tratador de sinal (só chamadas seguras em contexto de sinal).
+ * Sem PERF_COUNTERS=1 todas as funções retornam sem fazer nada.
+ */
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+// Abre o grupo da thread principal, registra o relatório no atexit e
+// instala o relatório em SIGSEGV/SIGBUS/SIGFPE/SIGILL/SIGABRT
+void perf_counters_init();
+
+// Contagem da thread atual sob um rótulo (somada na fase ativa no início)
+void perf_thread_begin(const char* label);
+void perf_thread_end();
+
+// Fase do programa (ex.: "contador", "banco"); a thread principal acumula
+// o intervalo e as threads iniciadas durante a fase entram nela
+void perf_phase_begin(const char* name);
+void perf_phase_end();
+
+// Imprime a tabela agora (processos que nunca terminam, hooks de saída)
+void perf_counters_report();
+
+// Versão segura em contexto de sinal, para tratadores de falha de terceiros
+void perf_counters_crash_report(int fd);
+
+#endif
@@ -7,8 +7,23 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <pthread.h>
 #include <unistd.h>
+#include <time.h>
+#include <stdatomic.h>
+
+#include "perf_counters.h"
+#include "mutex_prof.h"
+#include "evlog.h"
+#include "trace.h"
+#include "workload.h"
+#include "coop_sched.h"
+#include "stack_probe.h"
+
+// Código de saída quando a execução perdeu atualizações (útil para
+// contar em quantas execuções a race condition se manifesta)
+#define EXIT_LOST_UPDATES 3
 
 // Variável global compartilhada (causa race condition)
 int shared_counter = 0;
@@ -20,17 +35,30 @@ typedef struct {
     int iterations;
 } thread_data_t;
 
+static double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
 void* increment_counter(void* arg) {
     thread_data_t* data = (thread_data_t*)arg;
+    perf_thread_begin("incremento");
+    trace_thread_begin("incremento");
+    stack_probe_thread_begin("incremento");
+    workload_pin_thread(data->thread_id);
+    long work = workload.work;
     
-    printf("Thread %d iniciada\n", data->thread_id);
+    evlog("Thread %d iniciada\n", data->thread_id);
     
     for (int i = 0; i < data->iterations; i++) {
+        if (work) workload_spin(work);
         // RACE CONDITION: múltiplas threads modificando shared_counter simultaneamente
         // sem sincronização (mutex)
         int temp = shared_counter;
         usleep(1); // Simula algum processamento
         shared_counter = temp + 1;
+        trace_counter("shared_counter", temp + 1);
         
         // Também modifica o array compartilhado
         if (i < 1000) {
@@ -38,54 +66,33 @@ void* increment_counter(void* arg) {
         }
     }
     
-    printf("Thread %d finalizada\n", data->thread_id);
-    return NULL;
-}
-
-void* bank_account_simulation(void* arg) {
-    thread_data_t* data = (thread_data_t*)arg;
-    static int account_balance = 1000; // Saldo da conta bancária
-    
-    printf("Thread bancária %d iniciada\n", data->thread_id);
-    
-    for (int i = 0; i < data->iterations; i++) {
-        // Simula operação bancária sem lock
-        int current_balance = account_balance;
-        usleep(rand() % 1000); // Simula processamento variável
-        
-        if (data->thread_id % 2 == 0) {
-            // Threads pares fazem depósitos
-            account_balance = current_balance + 10;
-            printf("Thread %d: Depósito +10, saldo: %d\n", data->thread_id, account_balance);
-        } else {
-            // Threads ímpares fazem saques
-            if (current_balance >= 10) {
-                account_balance = current_balance - 10;
-                printf("Thread %d: Saque -10, saldo: %d\n", data->thread_id, account_balance);
-            }
-        }
-    }
-    
+    evlog("Thread %d finalizada\n", data->thread_id);
+    stack_probe_thread_end();
+    trace_thread_end();
+    perf_thread_end();
     return NULL;
 }
 
-void test_counter_race() {
-    const int num_threads = 5;
-    const int iterations_per_thread = 1000;
+// Devolve quantos incrementos foram perdidos
+int test_counter_race() {
+    const int num_threads = workload_threads(5);
+    const int iterations_per_thread = (int)workload_iterations(1000);
     
     pthread_t threads[num_threads];
     thread_data_t thread_data[num_threads];
     
     printf("=== TESTE 1: RACE CONDITION NO CONTADOR ===\n");
+    perf_phase_begin("contador");
     printf("Criando %d threads, cada uma incrementando %d vezes\n", num_threads, iterations_per_thread);
     printf("Valor esperado final: %d\n", num_threads * iterations_per_thread);
+    double start = now_seconds();
     
     // Cria as threads
     for (int i = 0; i < num_threads; i++) {
         thread_data[i].thread_id = i;
         thread_data[i].iterations = iterations_per_thread;
         
-        if (pthread_create(&threads[i], NULL, increment_counter, &thread_data[i]) != 0) {
+        if (pthread_create(&threads[i], stack_probe_attr(), increment_counter, &thread_data[i]) != 0) {
             perror("Erro ao criar thread");
             exit(1);
         }
@@ -95,36 +102,763 @@ void test_counter_race() {
     for (int i = 0; i < num_threads; i++) {
         pthread_join(threads[i], NULL);
     }
+    perf_phase_end();
+    evlog_flush(); // log das threads antes do resumo
+    workload_result("race_condition", "contador", num_threads, (double)num_threads * iterations_per_thread,
+                    now_seconds() - start, (long)num_threads * iterations_per_thread - shared_counter);
     
     printf("Valor final do contador: %d\n", shared_counter);
     printf("Diferença devido à race condition: %d\n", (num_threads * iterations_per_thread) - shared_counter);
+    return (num_threads * iterations_per_thread) - shared_counter;
 }
 
-void test_bank_race() {
-    const int num_threads = 4;
-    const int transactions = 50;
-    
-    pthread_t threads[num_threads];
-    thread_data_t thread_data[num_threads];
-    
+/*
+ * Benchmark do contador: compara a versão sem sincronização com as
+ * correções possíveis e mostra o custo de cada uma conforme o número
+ * de threads cresce.
+ */
+
+typedef enum {
+    COUNTER_RACY,      // leitura/escrita sem proteção (perde incrementos)
+    COUNTER_MUTEX,     // pthread_mutex_t em volta do incremento
+    COUNTER_ATOMIC,    // atomic_fetch_add (C11)
+    COUNTER_SPINLOCK,  // spinlock test-and-test-and-set
+    COUNTER_SHARDED,   // um contador por thread, somados no join
+    COUNTER_MODE_COUNT
+} counter_mode_t;
+
+static const char* counter_mode_names[COUNTER_MODE_COUNT] = {
+    "sem-lock", "mutex", "atomic", "spinlock", "sharded"
+};
+
+#define CACHE_LINE_SIZE 64
+#define MAX_BENCH_THREADS 256
+
+// Contador de cada thread ocupa uma linha de cache inteira
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) long value;
+} padded_counter_t;
+
+static volatile long bench_counter = 0;
+static atomic_long bench_atomic_counter = 0;
+static mutex_prof_t bench_mutex = MUTEX_PROF_INITIALIZER("bench_mutex");
+static atomic_int bench_spinlock = 0;
+static padded_counter_t bench_shards[MAX_BENCH_THREADS];
+
+typedef struct {
+    int thread_id;
+    long iterations;
+    counter_mode_t mode;
+} bench_data_t;
+
+// Com --threads=N os benchmarks medem só N threads, sem a série
+static int first_thread_count(int max_threads) {
+    return workload.threads > 0 ? max_threads : 1;
+}
+
+// Sequência 1, 2, 4, ... que termina sempre exatamente em max_threads
+static int next_thread_count(int current, int max_threads) {
+    if (current < max_threads && current * 2 > max_threads) {
+        return max_threads;
+    }
+    return current * 2;
+}
+
+static inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+static inline void spin_lock(atomic_int* lock) {
+    while (atomic_exchange_explicit(lock, 1, memory_order_acquire)) {
+        // Espera lendo (sem escrever) para não disputar a linha de cache
+        while (atomic_load_explicit(lock, memory_order_relaxed)) {
+            cpu_relax();
+        }
+    }
+}
+
+static inline void spin_unlock(atomic_int* lock) {
+    atomic_store_explicit(lock, 0, memory_order_release);
+}
+
+void* bench_counter_thread(void* arg) {
+    bench_data_t* data = (bench_data_t*)arg;
+    long n = data->iterations;
+    long work = workload.work;
+    perf_thread_begin("contador");
+    trace_thread_begin("contador");
+    stack_probe_thread_begin("contador");
+    workload_pin_thread(data->thread_id);
+
+    switch (data->mode) {
+        case COUNTER_RACY:
+            for (long i = 0; i < n; i++) {
+                if (work) workload_spin(work);
+                // RACE CONDITION: leitura e escrita separadas, sem proteção
+                long temp = bench_counter;
+                bench_counter = temp + 1;
+            }
+            break;
+        case COUNTER_MUTEX:
+            for (long i = 0; i < n; i++) {
+                if (work) workload_spin(work);
+                mutex_prof_lock(&bench_mutex);
+                bench_counter++;
+                mutex_prof_unlock(&bench_mutex);
+            }
+            break;
+        case COUNTER_ATOMIC:
+            for (long i = 0; i < n; i++) {
+                if (work) workload_spin(work);
+                atomic_fetch_add_explicit(&bench_atomic_counter, 1, memory_order_relaxed);
+            }
+            break;
+        case COUNTER_SPINLOCK:
+            for (long i = 0; i < n; i++) {
+                if (work) workload_spin(work);
+                spin_lock(&bench_spinlock);
+                bench_counter++;
+                spin_unlock(&bench_spinlock);
+            }
+            break;
+        case COUNTER_SHARDED: {
+            // Cada thread só escreve na sua própria linha de cache
+            volatile long* shard = &bench_shards[data->thread_id].value;
+            for (long i = 0; i < n; i++) {
+                if (work) workload_spin(work);
+                *shard = *shard + 1;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+
+    stack_probe_thread_end();
+    trace_thread_end();
+    perf_thread_end();
+    return NULL;
+}
+
+// Executa um modo com um número de threads e devolve o valor final do contador
+static long run_counter_bench(counter_mode_t mode, int num_threads, long iterations, double* elapsed) {
+    pthread_t threads[MAX_BENCH_THREADS];
+    bench_data_t thread_data[MAX_BENCH_THREADS];
+
+    bench_counter = 0;
+    atomic_store(&bench_atomic_counter, 0);
+    memset(bench_shards, 0, sizeof(bench_shards));
+
+    double start = now_seconds();
+
+    for (int i = 0; i < num_threads; i++) {
+        thread_data[i].thread_id = i;
+        thread_data[i].iterations = iterations;
+        thread_data[i].mode = mode;
+
+        if (pthread_create(&threads[i], stack_probe_attr(), bench_counter_thread, &thread_data[i]) != 0) {
+            perror("Erro ao criar thread");
+            exit(1);
+        }
+    }
+
+    // Soma dos shards acontece no join, fora do caminho quente
+    long total = 0;
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+        total += bench_shards[i].value;
+    }
+
+    *elapsed = now_seconds() - start;
+
+    switch (mode) {
+        case COUNTER_ATOMIC:
+            return atomic_load(&bench_atomic_counter);
+        case COUNTER_SHARDED:
+            return total;
+        default:
+            return bench_counter;
+    }
+}
+
+void test_counter_benchmark(int max_threads, long iterations) {
+    printf("=== TESTE 4: BENCHMARK DO CONTADOR (SEM LOCK x CORREÇÕES) ===\n");
+    printf("Threads: 1..%d, %ld incrementos por thread\n\n", max_threads, iterations);
+    printf("%-10s %8s %16s %14s %12s\n", "modo", "threads", "ops/s", "perdidos", "tempo(s)");
+
+    for (int mode = 0; mode < COUNTER_MODE_COUNT; mode++) {
+        perf_phase_begin(counter_mode_names[mode]);
+        for (int t = first_thread_count(max_threads); t <= max_threads; t = next_thread_count(t, max_threads)) {
+            double elapsed;
+            long expected = (long)t * iterations;
+            long final_value = run_counter_bench((counter_mode_t)mode, t, iterations, &elapsed);
+
+            printf("%-10s %8d %16.0f %14ld %12.4f\n",
+                   counter_mode_names[mode], t, expected / elapsed,
+                   expected - final_value, elapsed);
+            workload_result("race_condition", counter_mode_names[mode], t, expected, elapsed,
+                            expected - final_value);
+        }
+        perf_phase_end();
+        printf("\n");
+    }
+}
+
+/*
+ * False sharing: cada thread escreve apenas no seu próprio elemento de
+ * shared_array, mas elementos vizinhos dividem a mesma linha de cache e
+ * a linha fica pulando entre os núcleos a cada escrita.
+ */
+
+typedef enum {
+    SLOTS_PACKED,       // int adjacentes em shared_array (mesma linha de cache)
+    SLOTS_PADDED,       // um slot por linha de cache (alignas(64))
+    SLOTS_THREAD_LOCAL, // acumula em variável local e grava só no final
+    SLOTS_MODE_COUNT
+} slots_mode_t;
+
+static const char* slots_mode_names[SLOTS_MODE_COUNT] = {
+    "packed", "padded", "thread-local"
+};
+
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) int value;
+} padded_slot_t;
+
+static padded_slot_t padded_slots[MAX_BENCH_THREADS];
+
+typedef struct {
+    int thread_id;
+    long iterations;
+    slots_mode_t mode;
+} slots_data_t;
+
+void* false_sharing_thread(void* arg) {
+    slots_data_t* data = (slots_data_t*)arg;
+    long n = data->iterations;
+    perf_thread_begin("escritor");
+    trace_thread_begin("escritor");
+    stack_probe_thread_begin("escritor");
+    workload_pin_thread(data->thread_id);
+
+    switch (data->mode) {
+        case SLOTS_PACKED: {
+            volatile int* slot = &shared_array[data->thread_id];
+            for (long i = 0; i < n; i++) {
+                *slot = *slot + 1;
+            }
+            break;
+        }
+        case SLOTS_PADDED: {
+            volatile int* slot = &padded_slots[data->thread_id].value;
+            for (long i = 0; i < n; i++) {
+                *slot = *slot + 1;
+            }
+            break;
+        }
+        case SLOTS_THREAD_LOCAL: {
+            volatile int local = 0;
+            for (long i = 0; i < n; i++) {
+                local = local + 1;
+            }
+            shared_array[data->thread_id] += local; // único acesso compartilhado
+            break;
+        }
+        default:
+            break;
+    }
+
+    stack_probe_thread_end();
+    trace_thread_end();
+    perf_thread_end();
+    return NULL;
+}
+
+static double run_false_sharing(slots_mode_t mode, int num_threads, long iterations) {
+    pthread_t threads[MAX_BENCH_THREADS];
+    slots_data_t thread_data[MAX_BENCH_THREADS];
+
+    memset(shared_array, 0, sizeof(shared_array));
+    memset(padded_slots, 0, sizeof(padded_slots));
+
+    double start = now_seconds();
+
+    for (int i = 0; i < num_threads; i++) {
+        thread_data[i].thread_id = i;
+        thread_data[i].iterations = iterations;
+        thread_data[i].mode = mode;
+
+        if (pthread_create(&threads[i], stack_probe_attr(), false_sharing_thread, &thread_data[i]) != 0) {
+            perror("Erro ao criar thread");
+            exit(1);
+        }
+    }
+
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    return now_seconds() - start;
+}
+
+void test_false_sharing(int max_threads, long iterations) {
+    printf("=== TESTE 5: FALSE SHARING EM shared_array ===\n");
+    printf("Cada thread escreve %ld vezes apenas no seu próprio slot\n", iterations);
+    printf("ns/op = tempo de parede por escrita de uma thread\n\n");
+    printf("%-13s %8s %10s %16s\n", "layout", "threads", "ns/op", "escritas/s");
+
+    for (int mode = 0; mode < SLOTS_MODE_COUNT; mode++) {
+        perf_phase_begin(slots_mode_names[mode]);
+        for (int t = first_thread_count(max_threads); t <= max_threads; t = next_thread_count(t, max_threads)) {
+            double elapsed = run_false_sharing((slots_mode_t)mode, t, iterations);
+
+            printf("%-13s %8d %10.2f %16.0f\n",
+                   slots_mode_names[mode], t, elapsed * 1e9 / iterations,
+                   (double)t * iterations / elapsed);
+            workload_result("race_condition", slots_mode_names[mode], t, (double)t * iterations, elapsed, 0);
+        }
+        perf_phase_end();
+        printf("\n");
+    }
+}
+
+// Lê "[max_threads] [iterações]" a partir de argv[2] para os benchmarks
+// (--threads e --iterations têm precedência)
+static void parse_bench_args(int argc, char *argv[], int* max_threads, long* iterations) {
+    *max_threads = argc > 2 ? atoi(argv[2]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (argc > 3) {
+        *iterations = atol(argv[3]);
+    }
+    *max_threads = workload_threads(*max_threads);
+    *iterations = workload_iterations(*iterations);
+    if (*max_threads < 1) *max_threads = 1;
+    if (*max_threads > MAX_BENCH_THREADS) *max_threads = MAX_BENCH_THREADS;
+}
+
+/*
+ * Simulação bancária: livro-razão com várias contas e transferências
+ * entre elas. O total de dinheiro nunca deveria mudar, então a soma dos
+ * saldos no final denuncia qualquer atualização perdida.
+ */
+
+typedef enum {
+    BANK_RACY,     // lê, espera e escreve os saldos sem nenhum lock
+    BANK_COARSE,   // um único mutex para o livro-razão inteiro
+    BANK_STRIPED,  // tabela fixa de locks; conta i usa o lock i % LOCK_STRIPES
+    BANK_BATCHED,  // deltas locais por thread, aplicados numa só seção crítica
+    BANK_MODE_COUNT
+} bank_mode_t;
+
+static const char* bank_mode_names[BANK_MODE_COUNT] = {
+    "sem-lock", "coarse", "striped", "batched"
+};
+
+#define LOCK_STRIPES 16
+#define INITIAL_BALANCE 1000
+#define MAX_TRANSFER 100
+
+static long* accounts = NULL;
+static int num_accounts = 0;
+static mutex_prof_t ledger_lock = MUTEX_PROF_INITIALIZER("ledger_lock");
+static mutex_prof_t stripe_locks[LOCK_STRIPES];
+static char stripe_names[LOCK_STRIPES][24];
+
+typedef struct {
+    int thread_id;
+    long transactions;
+    bank_mode_t mode;
+    int max_delay_us;  // atraso entre leitura e escrita no modo sem lock
+} bank_data_t;
+
+static void ledger_init(int count) {
+    free(accounts);
+    accounts = (long*)malloc(count * sizeof(long));
+    if (!accounts) {
+        perror("Erro ao alocar contas");
+        exit(1);
+    }
+
+    num_accounts = count;
+    for (int i = 0; i < count; i++) {
+        accounts[i] = INITIAL_BALANCE;
+    }
+    // Uma vez só: o perfil de contenção acumula por lock entre os testes
+    if (!stripe_names[0][0]) {
+        for (int i = 0; i < LOCK_STRIPES; i++) {
+            snprintf(stripe_names[i], sizeof(stripe_names[i]), "stripe_locks[%d]", i);
+            mutex_prof_init_lock(&stripe_locks[i], stripe_names[i]);
+        }
+    }
+}
+
+static long ledger_total() {
+    long total = 0;
+    for (int i = 0; i < num_accounts; i++) {
+        total += accounts[i];
+    }
+    return total;
+}
+
+// Trava os dois stripes sempre do menor para o maior índice (sem deadlock)
+static void transfer_striped(int from, int to, long amount) {
+    int first = from % LOCK_STRIPES;
+    int second = to % LOCK_STRIPES;
+
+    if (first > second) {
+        int tmp = first;
+        first = second;
+        second = tmp;
+    }
+
+    mutex_prof_lock(&stripe_locks[first]);
+    if (second != first) {
+        mutex_prof_lock(&stripe_locks[second]);
+    }
+
+    accounts[from] -= amount;
+    accounts[to] += amount;
+
+    if (second != first) {
+        mutex_prof_unlock(&stripe_locks[second]);
+    }
+    mutex_prof_unlock(&stripe_locks[first]);
+}
+
+void* bank_account_simulation(void* arg) {
+    bank_data_t* data = (bank_data_t*)arg;
+    perf_thread_begin("transferência");
+    trace_thread_begin("transferência");
+    stack_probe_thread_begin("transferência");
+    workload_pin_thread(data->thread_id);
+    long work = workload.work;
+    unsigned int seed = (unsigned int)data->thread_id * 2654435761u + 1;
+    long* deltas = NULL;
+
+    if (data->mode == BANK_BATCHED) {
+        deltas = (long*)calloc(num_accounts, sizeof(long));
+        if (!deltas) {
+            perror("Erro ao alocar deltas");
+            exit(1);
+        }
+        trace_alloc(deltas, num_accounts * sizeof(long));
+    }
+
+    for (long i = 0; i < data->transactions; i++) {
+        int from = rand_r(&seed) % num_accounts;
+        int to = rand_r(&seed) % num_accounts;
+        long amount = 1 + rand_r(&seed) % MAX_TRANSFER;
+
+        if (from == to) {
+            to = (to + 1) % num_accounts;
+        }
+        if (work) workload_spin(work);
+
+        switch (data->mode) {
+            case BANK_RACY: {
+                // RACE CONDITION: outra thread pode escrever entre a leitura e a escrita
+                long from_balance = accounts[from];
+                long to_balance = accounts[to];
+                if (data->max_delay_us > 0) {
+                    usleep(rand_r(&seed) % data->max_delay_us); // Simula processamento variável
+                }
+                accounts[from] = from_balance - amount;
+                accounts[to] = to_balance + amount;
+                if (data->max_delay_us > 0) {
+                    // Só no teste 2: o log mostra as escritas que se sobrepõem
+                    evlog("Thread %d: conta %d -> conta %d, valor %ld (leu %ld)\n",
+                          data->thread_id, from, to, amount, from_balance);
+                }
+                break;
+            }
+            case BANK_COARSE:
+                mutex_prof_lock(&ledger_lock);
+                accounts[from] -= amount;
+                accounts[to] += amount;
+                mutex_prof_unlock(&ledger_lock);
+                break;
+            case BANK_STRIPED:
+                transfer_striped(from, to, amount);
+                break;
+            case BANK_BATCHED:
+                deltas[from] -= amount;
+                deltas[to] += amount;
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (deltas) {
+        // Commit do lote inteiro numa única seção crítica
+        mutex_prof_lock(&ledger_lock);
+        for (int i = 0; i < num_accounts; i++) {
+            accounts[i] += deltas[i];
+        }
+        mutex_prof_unlock(&ledger_lock);
+        trace_free(deltas);
+        free(deltas);
+    }
+
+    stack_probe_thread_end();
+    trace_thread_end();
+    perf_thread_end();
+    return NULL;
+}
+
+// Roda as transferências e devolve o total de dinheiro no fim
+static long run_bank(bank_mode_t mode, int num_threads, long transactions,
+                     int max_delay_us, double* elapsed) {
+    pthread_t threads[MAX_BENCH_THREADS];
+    bank_data_t thread_data[MAX_BENCH_THREADS];
+
+    for (int i = 0; i < num_accounts; i++) {
+        accounts[i] = INITIAL_BALANCE;
+    }
+
+    double start = now_seconds();
+
+    for (int i = 0; i < num_threads; i++) {
+        thread_data[i].thread_id = i;
+        thread_data[i].transactions = transactions;
+        thread_data[i].mode = mode;
+        thread_data[i].max_delay_us = max_delay_us;
+
+        if (pthread_create(&threads[i], stack_probe_attr(), bank_account_simulation, &thread_data[i]) != 0) {
+            perror("Erro ao criar thread");
+            exit(1);
+        }
+    }
+
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    *elapsed = now_seconds() - start;
+    evlog_flush();
+    return ledger_total();
+}
+
+// Devolve quanto dinheiro foi criado ou destruído
+long test_bank_race() {
+    const int num_threads = workload_threads(4) < MAX_BENCH_THREADS ? workload_threads(4) : MAX_BENCH_THREADS;
+    const int transactions = (int)workload_iterations(50);
+    const int account_count = 8;
+    double elapsed;
+
     printf("\n=== TESTE 2: RACE CONDITION BANCÁRIA ===\n");
-    printf("Simulando operações bancárias concorrentes\n");
-    
-    // Cria as threads
+    printf("Simulando %d threads com %d transferências cada entre %d contas (sem lock)\n",
+           num_threads, transactions, account_count);
+
+    ledger_init(account_count);
+    long expected = (long)account_count * INITIAL_BALANCE;
+    perf_phase_begin("banco");
+    long total = run_bank(BANK_RACY, num_threads, transactions, 1000, &elapsed);
+    perf_phase_end();
+    workload_result("race_condition", "banco", num_threads, (double)num_threads * transactions,
+                    elapsed, labs(total - expected));
+
+    printf("Dinheiro total esperado: %ld\n", expected);
+    printf("Dinheiro total no final: %ld\n", total);
+    printf("Dinheiro criado/destruído pela race condition: %ld\n", total - expected);
+    return total - expected;
+}
+
+void test_bank_benchmark(int max_threads, long transactions, int account_count) {
+    printf("=== TESTE 6: BENCHMARK DO LIVRO-RAZÃO ===\n");
+    printf("%d contas, %d stripes de lock, %ld transferências por thread\n\n",
+           account_count, LOCK_STRIPES, transactions);
+    printf("%-10s %8s %16s %14s %12s\n", "modo", "threads", "transf/s", "desvio total", "conservado");
+
+    ledger_init(account_count);
+    long expected = (long)account_count * INITIAL_BALANCE;
+
+    for (int mode = 0; mode < BANK_MODE_COUNT; mode++) {
+        perf_phase_begin(bank_mode_names[mode]);
+        for (int t = first_thread_count(max_threads); t <= max_threads; t = next_thread_count(t, max_threads)) {
+            double elapsed;
+            long total = run_bank((bank_mode_t)mode, t, transactions, 0, &elapsed);
+
+            printf("%-10s %8d %16.0f %14ld %12s\n",
+                   bank_mode_names[mode], t, (double)t * transactions / elapsed,
+                   total - expected, total == expected ? "sim" : "NÃO");
+            workload_result("race_condition", bank_mode_names[mode], t, (double)t * transactions,
+                            elapsed, labs(total - expected));
+        }
+        perf_phase_end();
+        printf("\n");
+    }
+}
+
+/*
+ * Busca de cronogramas: o mesmo incremento sem proteção do teste 1, com
+ * um ponto de escalonamento antes da leitura e outro entre a leitura e a
+ * escrita. Livre, as threads correm de verdade e a perda depende do
+ * acaso; no modo cooperativo o escalonador decide cada troca, então uma
+ * semente (ou um cronograma gravado) reproduz a mesma perda sempre.
+ */
+
+typedef enum {
+    SEARCH_FREE,         // threads livres com usleep(1), como no teste 1
+    SEARCH_FREE_DIRECT,  // threads livres sem o atraso artificial
+    SEARCH_PCT,          // escalonador cooperativo com PCT (profundidade 2)
+    SEARCH_RANDOM,       // escalonador cooperativo com sorteio a cada passo
+    SEARCH_COUNT,
+    SEARCH_REPLAY = SEARCH_COUNT
+} search_strategy_t;
+
+static const char* search_names[SEARCH_COUNT] = {
+    "livre", "livre-direto", "pct", "aleatorio"
+};
+
+typedef struct {
+    int thread_id;
+    int iterations;
+    int delay_us;
+} scheduled_data_t;
+
+void* scheduled_increment(void* arg) {
+    scheduled_data_t* data = (scheduled_data_t*)arg;
+    coop_thread_begin(data->thread_id);
+
+    for (int i = 0; i < data->iterations; i++) {
+        coop_yield();
+        int temp = shared_counter;
+        if (data->delay_us) {
+            usleep(data->delay_us);
+        }
+        coop_yield(); // a troca aqui é o que perde o incremento
+        shared_counter = temp + 1;
+    }
+
+    coop_thread_end();
+    return NULL;
+}
+
+// Uma execução; devolve quantos incrementos foram perdidos
+static int run_scheduled(search_strategy_t strategy, int num_threads, int iterations, unsigned int seed,
+                         const coop_schedule_t* replay, coop_schedule_t* recorded, int* diverged) {
+    pthread_t threads[COOP_MAX_THREADS];
+    scheduled_data_t thread_data[COOP_MAX_THREADS];
+    int cooperative = strategy >= SEARCH_PCT;
+
+    shared_counter = 0;
+    if (cooperative) {
+        // Passos: dois pontos por iteração mais o fim de cada thread
+        long steps = (long)num_threads * (2L * iterations + 1) + 1;
+        coop_policy_t policy = strategy == SEARCH_PCT ? COOP_PCT :
+                               strategy == SEARCH_RANDOM ? COOP_RANDOM : COOP_REPLAY;
+        coop_begin(policy, num_threads, seed, steps, 2, replay);
+    }
+
     for (int i = 0; i < num_threads; i++) {
         thread_data[i].thread_id = i;
-        thread_data[i].iterations = transactions;
-        
-        if (pthread_create(&threads[i], NULL, bank_account_simulation, &thread_data[i]) != 0) {
+        thread_data[i].iterations = iterations;
+        thread_data[i].delay_us = strategy == SEARCH_FREE;
+
+        if (pthread_create(&threads[i], stack_probe_attr(), scheduled_increment, &thread_data[i]) != 0) {
             perror("Erro ao criar thread");
             exit(1);
         }
     }
-    
-    // Espera todas as threads terminarem
     for (int i = 0; i < num_threads; i++) {
         pthread_join(threads[i], NULL);
     }
+
+    int result = cooperative ? coop_end(recorded) : 0;
+    if (diverged) {
+        *diverged = result != 0;
+    }
+    return num_threads * iterations - shared_counter;
+}
+
+void test_schedule_search(const char* which, int num_threads, int iterations, long max_runs,
+                          unsigned int seed, const char* out_path) {
+    printf("=== TESTE 7: BUSCA DE CRONOGRAMA QUE PERDE INCREMENTOS ===\n");
+    printf("%d threads x %d incrementos, até %ld execuções por estratégia, semente %u\n\n",
+           num_threads, iterations, max_runs, seed);
+    printf("%-13s %12s %10s %10s %12s %10s\n",
+           "estratégia", "1ª falha", "falhas", "execuções", "exec/falha", "tempo(s)");
+
+    coop_schedule_t recorded = {NULL, 0, 0};
+    int saved = 0, ran = 0;
+
+    for (int s = 0; s < SEARCH_COUNT; s++) {
+        if (strcmp(which, "todas") != 0 && strcmp(which, search_names[s]) != 0) {
+            continue;
+        }
+        ran++;
+        perf_phase_begin(search_names[s]);
+
+        long first_failure = 0, failures = 0;
+        double start = now_seconds();
+        for (long run = 1; run <= max_runs; run++) {
+            int lost = run_scheduled((search_strategy_t)s, num_threads, iterations,
+                                     seed + (unsigned int)run, NULL, &recorded, NULL);
+            if (!lost) {
+                continue;
+            }
+            failures++;
+            if (!first_failure) {
+                first_failure = run;
+            }
+            // Guarda a primeira falha achada pelo escalonador para o replay
+            if (s >= SEARCH_PCT && !saved &&
+                coop_schedule_save(out_path, &recorded, num_threads, iterations) == 0) {
+                saved = 1;
+                printf("  (cronograma de %s, execução %ld, %d perdidos: %zu bytes em %s)\n",
+                       search_names[s], run, lost, recorded.size, out_path);
+            }
+        }
+        double elapsed = now_seconds() - start;
+        perf_phase_end();
+
+        char first[24], per_failure[24];
+        snprintf(first, sizeof(first), first_failure ? "%ld" : "-", first_failure);
+        snprintf(per_failure, sizeof(per_failure), failures ? "%.1f" : "-",
+                 failures ? (double)max_runs / failures : 0);
+        printf("%-13s %12s %10ld %10ld %12s %10.3f\n",
+               search_names[s], first, failures, max_runs, per_failure, elapsed);
+        workload_result("race_condition", search_names[s], num_threads, max_runs, elapsed, failures);
+    }
+
+    if (!ran) {
+        printf("Estratégia desconhecida: %s (use livre, livre-direto, pct, aleatorio ou todas)\n", which);
+    } else if (saved) {
+        printf("\nReproduza com: race_condition 7 replay %s\n", out_path);
+    }
+    coop_schedule_free(&recorded);
+}
+
+// Devolve quantos incrementos a execução reproduzida perdeu
+int test_schedule_replay(const char* path) {
+    coop_schedule_t schedule = {NULL, 0, 0}, recorded = {NULL, 0, 0};
+    int num_threads;
+    long iterations;
+
+    printf("=== TESTE 7: REPLAY DE CRONOGRAMA ===\n");
+    if (coop_schedule_load(path, &schedule, &num_threads, &iterations) < 0) {
+        exit(1);
+    }
+    printf("%s: %d threads x %ld incrementos, %zu bytes de cronograma\n",
+           path, num_threads, iterations, schedule.size);
+
+    int diverged;
+    int lost = run_scheduled(SEARCH_REPLAY, num_threads, (int)iterations, 0, &schedule, &recorded, &diverged);
+    int identical = recorded.size == schedule.size &&
+                    memcmp(recorded.data, schedule.data, schedule.size) == 0;
+
+    printf("Valor final do contador: %d (esperado %ld)\n", shared_counter, num_threads * iterations);
+    printf("Incrementos perdidos: %d\n", lost);
+    printf("Cronograma reproduzido byte a byte: %s%s\n", identical ? "sim" : "NÃO",
+           diverged ? " (a execução divergiu do arquivo)" : "");
+
+    coop_schedule_free(&schedule);
+    coop_schedule_free(&recorded);
+    return lost;
 }
 
 int main(int argc, char *argv[]) {
@@ -132,25 +866,79 @@ int main(int argc, char *argv[]) {
     printf("Este programa demonstra condições de corrida entre threads\n\n");
     
     int option = 1;
+    int lost_updates = 0;
+    workload_init(&argc, argv);
+    perf_counters_init();
+    trace_init();
+    stack_probe_init();
+    mutex_prof_init();
+    evlog_init();
     if (argc > 1) {
         option = atoi(argv[1]);
     }
     
     switch(option) {
         case 1:
-            test_counter_race();
+            lost_updates = test_counter_race() != 0;
             break;
         case 2:
-            test_bank_race();
+            lost_updates = test_bank_race() != 0;
             break;
         case 3:
-            test_counter_race();
-            test_bank_race();
+            lost_updates = test_counter_race() != 0;
+            lost_updates |= test_bank_race() != 0;
+            break;
+        case 4: {
+            // Uso: race_condition 4 [max_threads] [incrementos_por_thread]
+            int max_threads;
+            long iterations = 1000000;
+            parse_bench_args(argc, argv, &max_threads, &iterations);
+            test_counter_benchmark(max_threads, iterations);
             break;
+        }
+        case 5: {
+            // Uso: race_condition 5 [max_threads] [escritas_por_thread]
+            int max_threads;
+            long iterations = 10000000;
+            parse_bench_args(argc, argv, &max_threads, &iterations);
+            test_false_sharing(max_threads, iterations);
+            break;
+        }
+        case 6: {
+            // Uso: race_condition 6 [max_threads] [transferências_por_thread] [contas]
+            int max_threads;
+            long transactions = 1000000;
+            parse_bench_args(argc, argv, &max_threads, &transactions);
+            int account_count = argc > 4 ? atoi(argv[4]) : 64;
+            if (account_count < 2) account_count = 2;
+            test_bank_benchmark(max_threads, transactions, account_count);
+            break;
+        }
+        case 7: {
+            // Uso: race_condition 7 [estratégia] [execuções] [semente] [arquivo.sched]
+            //      race_condition 7 replay [arquivo.sched]
+            const char* strategy = argc > 2 ? argv[2] : "todas";
+            if (strcmp(strategy, "replay") == 0) {
+                lost_updates = test_schedule_replay(argc > 3 ? argv[3] : "race_condition.sched") != 0;
+                break;
+            }
+            long max_runs = argc > 3 ? atol(argv[3]) : 1000;
+            unsigned int seed = argc > 4 ? (unsigned int)strtoul(argv[4], NULL, 10) : 1;
+            const char* out_path = argc > 5 ? argv[5] : "race_condition.sched";
+            int num_threads = workload_threads(2);
+            if (num_threads < 2) num_threads = 2;
+            if (num_threads > COOP_MAX_THREADS) num_threads = COOP_MAX_THREADS;
+            if (max_runs < 1) max_runs = 1;
+            test_schedule_search(strategy, num_threads, (int)workload_iterations(20), max_runs, seed, out_path);
+            break;
+        }
         default:
-            printf("Opções: 1=contador, 2=banco, 3=ambos\n");
-            test_counter_race();
+            printf("Opções: 1=contador, 2=banco, 3=ambos, 4=benchmark do contador, 5=false sharing\n");
+            printf("        6=benchmark do livro-razão (coarse, striped, batched)\n");
+            printf("        7=busca de cronograma (livre, pct, aleatorio) e replay determinístico\n");
+            printf("Carga: --threads=N --iterations=N --work=N --pin[=cpus] --results=arquivo.tsv\n");
+            lost_updates = test_counter_race() != 0;
     }
     
-    return 0;
+    return lost_updates ? EXIT_LOST_UPDATES : 0;
 }
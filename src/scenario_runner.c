@@ -0,0 +1,306 @@
+/*
+ * Executor paralelo de cenários
+ *
+ * Alternativa ao "make test-all", que roda os sete exemplos um depois do
+ * outro com contagens regressivas e timeouts longos. Aqui cada cenário (e
+ * cada sub-opção) roda num processo filho em seu próprio grupo de
+ * processos, vários ao mesmo tempo, com prazo individual. O resultado de
+ * cada um (código de saída, sinal, tempo de parede, CPU e pico de RSS,
+ * obtidos com wait4) sai numa tabela TSV ou em JSON.
+ *
+ * Uso: scenario_runner [-j jobs] [-t prazo_ms] [-f tsv|json] [-b dir_bin]
+ *                      [-o dir_logs] [-c] [cenário ...]
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+typedef struct {
+    const char* binary;
+    const char* option;      // NULL = sem argumento
+    int deadline_ms;
+    const char* expected;    // comportamento esperado, só para a tabela
+} scenario_t;
+
+// Matriz completa: cada sub-opção vira um processo independente
+static const scenario_t scenarios[] = {
+    {"stack_overflow",     NULL, 10000, "SIGSEGV"},
+    {"segmentation_fault", "1",  5000,  "SIGSEGV"},
+    {"segmentation_fault", "2",  5000,  "SIGSEGV"},
+    {"segmentation_fault", "3",  5000,  "SIGSEGV"},
+    {"buffer_overflow",    "1",  5000,  "SIGSEGV/SIGABRT"},
+    {"buffer_overflow",    "2",  5000,  "SIGABRT/exit"},
+    {"buffer_overflow",    "3",  5000,  "exit 0/SIGSEGV"},
+    {"memory_leak",        "1",  2000,  "prazo (loop infinito)"},
+    {"memory_leak",        "2",  2000,  "prazo (loop infinito)"},
+    {"memory_leak",        "3",  2000,  "prazo (loop infinito)"},
+    {"race_condition",     "1",  20000, "exit 3/0 (perdas)"},
+    {"race_condition",     "2",  20000, "exit 3/0 (perdas)"},
+    {"deadlock",           "1",  10000, "exit 42 (lockdep)"},
+    {"deadlock",           "2",  10000, "exit 42 (lockdep)"},
+    {"core_dump",          "1",  10000, "exit 11 (handler)"},
+    {"core_dump",          "2",  10000, "exit 8 (handler)"},
+    {"core_dump",          "3",  10000, "SIGSEGV/SIGILL"},
+    {"core_dump",          "4",  10000, "exit 6 (handler)"},
+    {"core_dump",          "5",  10000, "exit 11 (handler)"},
+    {"core_dump",          "6",  10000, "exit 0 (x86)"},
+    {"core_dump",          "7",  10000, "SIGABRT"},
+    {"core_dump",          "8",  10000, "SIGABRT/exit"},
+};
+
+#define SCENARIO_COUNT ((int)(sizeof(scenarios) / sizeof(scenarios[0])))
+
+typedef struct {
+    const scenario_t* scenario;
+    int selected;
+    pid_t pid;
+    int deadline_ms;
+    double start_ms;
+    double wall_ms;
+    int status;
+    int timed_out;
+    int done;
+    struct rusage usage;
+} job_t;
+
+static double now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static double timeval_ms(struct timeval tv) {
+    return tv.tv_sec * 1e3 + tv.tv_usec / 1e3;
+}
+
+static const char* scenario_label(const scenario_t* s, char* buf, size_t size) {
+    snprintf(buf, size, "%s%s%s", s->binary, s->option ? " " : "", s->option ? s->option : "");
+    return buf;
+}
+
+static void describe_status(const job_t* job, char* buf, size_t size) {
+    if (job->timed_out) {
+        snprintf(buf, size, "prazo");
+    } else if (WIFSIGNALED(job->status)) {
+        snprintf(buf, size, "SIG%s%s", sigabbrev_np(WTERMSIG(job->status)),
+                 WCOREDUMP(job->status) ? " (core)" : "");
+    } else {
+        snprintf(buf, size, "exit %d", WEXITSTATUS(job->status));
+    }
+}
+
+static pid_t start_job(job_t* job, const char* bin_dir, const char* log_dir, int keep_cores) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s", bin_dir, job->scenario->binary);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        exit(1);
+    }
+
+    if (pid == 0) {
+        // Grupo próprio: no prazo o grupo inteiro (com as threads) é morto
+        setpgid(0, 0);
+
+        int out = -1;
+        if (log_dir) {
+            char log_path[4096];
+            snprintf(log_path, sizeof(log_path), "%s/%s%s%s.log", log_dir, job->scenario->binary,
+                     job->scenario->option ? "_" : "", job->scenario->option ? job->scenario->option : "");
+            out = open(log_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        }
+        if (out < 0) {
+            out = open("/dev/null", O_WRONLY);
+        }
+        dup2(out, STDOUT_FILENO);
+        dup2(out, STDERR_FILENO);
+        int in = open("/dev/null", O_RDONLY);
+        dup2(in, STDIN_FILENO);
+
+        if (!keep_cores) {
+            struct rlimit no_core = {0, 0};
+            setrlimit(RLIMIT_CORE, &no_core);
+        }
+        setenv("NO_COUNTDOWN", "1", 1);
+
+        char* argv[] = {path, (char*)job->scenario->option, NULL};
+        execv(path, argv);
+        _exit(127);
+    }
+
+    setpgid(pid, pid);
+    job->pid = pid;
+    job->start_ms = now_ms();
+    return pid;
+}
+
+static void print_tsv(job_t* jobs, int count, double total_ms) {
+    printf("cenario\tresultado\tesperado\tparede_ms\tusuario_ms\tsistema_ms\tpico_rss_kb\n");
+    for (int i = 0; i < count; i++) {
+        if (!jobs[i].selected) {
+            continue;
+        }
+        char label[256], result[64];
+        scenario_label(jobs[i].scenario, label, sizeof(label));
+        describe_status(&jobs[i], result, sizeof(result));
+        printf("%s\t%s\t%s\t%.1f\t%.1f\t%.1f\t%ld\n", label, result, jobs[i].scenario->expected,
+               jobs[i].wall_ms, timeval_ms(jobs[i].usage.ru_utime),
+               timeval_ms(jobs[i].usage.ru_stime), jobs[i].usage.ru_maxrss);
+    }
+    fprintf(stderr, "Matriz concluída em %.1f ms\n", total_ms);
+}
+
+static void print_json(job_t* jobs, int count, double total_ms) {
+    printf("{\n  \"total_ms\": %.1f,\n  \"resultados\": [\n", total_ms);
+    int first = 1;
+    for (int i = 0; i < count; i++) {
+        if (!jobs[i].selected) {
+            continue;
+        }
+        job_t* job = &jobs[i];
+        printf("%s    {\"cenario\": \"%s\", \"opcao\": %s%s%s, ", first ? "" : ",\n",
+               job->scenario->binary, job->scenario->option ? "\"" : "",
+               job->scenario->option ? job->scenario->option : "null", job->scenario->option ? "\"" : "");
+        printf("\"prazo_excedido\": %s, \"codigo_saida\": %d, \"sinal\": %d, \"core\": %s, ",
+               job->timed_out ? "true" : "false",
+               WIFEXITED(job->status) ? WEXITSTATUS(job->status) : -1,
+               WIFSIGNALED(job->status) ? WTERMSIG(job->status) : 0,
+               WIFSIGNALED(job->status) && WCOREDUMP(job->status) ? "true" : "false");
+        printf("\"parede_ms\": %.1f, \"usuario_ms\": %.1f, \"sistema_ms\": %.1f, \"pico_rss_kb\": %ld}",
+               job->wall_ms, timeval_ms(job->usage.ru_utime), timeval_ms(job->usage.ru_stime),
+               job->usage.ru_maxrss);
+        first = 0;
+    }
+    printf("\n  ]\n}\n");
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr, "Uso: %s [-j jobs] [-t prazo_ms] [-f tsv|json] [-b dir_bin] [-o dir_logs] [-c] [cenário ...]\n", prog);
+    fprintf(stderr, "  -j  processos simultâneos (padrão: número de CPUs)\n");
+    fprintf(stderr, "  -t  prazo único para todos os cenários (padrão: prazo de cada um)\n");
+    fprintf(stderr, "  -o  grava stdout/stderr de cada cenário em dir_logs/<cenário>.log\n");
+    fprintf(stderr, "  -c  mantém core dumps (padrão: RLIMIT_CORE=0 nos filhos)\n");
+    fprintf(stderr, "  cenário: nome do binário (ex.: core_dump) ou binário:opção (ex.: core_dump:4)\n");
+}
+
+static int matches(const scenario_t* s, int argc, char** argv, int first) {
+    if (first >= argc) {
+        return 1;
+    }
+    for (int i = first; i < argc; i++) {
+        char label[256];
+        snprintf(label, sizeof(label), "%s:%s", s->binary, s->option ? s->option : "");
+        if (strcmp(argv[i], s->binary) == 0 || strcmp(argv[i], label) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int max_jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int fixed_deadline = 0;
+    int json = 0;
+    int keep_cores = 0;
+    const char* bin_dir = "./bin";
+    const char* log_dir = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "j:t:f:b:o:ch")) != -1) {
+        switch (opt) {
+            case 'j': max_jobs = atoi(optarg); break;
+            case 't': fixed_deadline = atoi(optarg); break;
+            case 'f': json = strcmp(optarg, "json") == 0; break;
+            case 'b': bin_dir = optarg; break;
+            case 'o': log_dir = optarg; break;
+            case 'c': keep_cores = 1; break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (max_jobs < 1) {
+        max_jobs = 1;
+    }
+    if (log_dir) {
+        mkdir(log_dir, 0755);
+    }
+
+    job_t jobs[SCENARIO_COUNT];
+    int pending = 0;
+    memset(jobs, 0, sizeof(jobs));
+    for (int i = 0; i < SCENARIO_COUNT; i++) {
+        jobs[i].scenario = &scenarios[i];
+        jobs[i].selected = matches(&scenarios[i], argc, argv, optind);
+        jobs[i].deadline_ms = fixed_deadline > 0 ? fixed_deadline : scenarios[i].deadline_ms;
+        pending += jobs[i].selected;
+    }
+
+    fprintf(stderr, "Executando %d cenários com até %d processos simultâneos...\n", pending, max_jobs);
+
+    double start = now_ms();
+    int next = 0, running = 0, finished = 0;
+
+    while (finished < pending) {
+        // Inicia novos cenários até o limite de jobs
+        while (running < max_jobs && next < SCENARIO_COUNT) {
+            if (jobs[next].selected) {
+                start_job(&jobs[next], bin_dir, log_dir, keep_cores);
+                running++;
+            }
+            next++;
+        }
+
+        // Coleta quem terminou, com status e uso de recursos do filho
+        int status;
+        struct rusage usage;
+        pid_t pid;
+        while ((pid = wait4(-1, &status, WNOHANG, &usage)) > 0) {
+            for (int i = 0; i < SCENARIO_COUNT; i++) {
+                if (jobs[i].pid == pid && !jobs[i].done) {
+                    jobs[i].status = status;
+                    jobs[i].usage = usage;
+                    jobs[i].wall_ms = now_ms() - jobs[i].start_ms;
+                    jobs[i].done = 1;
+                    // Mata threads ou netos que tenham sobrado no grupo
+                    kill(-pid, SIGKILL);
+                    running--;
+                    finished++;
+                    break;
+                }
+            }
+        }
+
+        // Prazo excedido: mata o grupo de processos inteiro
+        double now = now_ms();
+        for (int i = 0; i < SCENARIO_COUNT; i++) {
+            if (jobs[i].pid && !jobs[i].done && !jobs[i].timed_out &&
+                now - jobs[i].start_ms > jobs[i].deadline_ms) {
+                jobs[i].timed_out = 1;
+                kill(-jobs[i].pid, SIGKILL);
+            }
+        }
+
+        struct timespec tick = {0, 1000000}; // 1 ms
+        nanosleep(&tick, NULL);
+    }
+
+    double total_ms = now_ms() - start;
+    if (json) {
+        print_json(jobs, SCENARIO_COUNT, total_ms);
+    } else {
+        print_tsv(jobs, SCENARIO_COUNT, total_ms);
+    }
+    return 0;
+}
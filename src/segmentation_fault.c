@@ -5,9 +5,23 @@
  * incluindo acesso a ponteiros nulos e áreas de memória inválidas.
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/userfaultfd.h>
+
+#include "perf_counters.h"
 
 void null_pointer_access() {
     printf("Testando acesso a ponteiro nulo...\n");
@@ -39,8 +53,237 @@ void array_bounds_violation() {
     printf("Esta linha não será executada.\n");
 }
 
+/* ---- falhas recuperáveis: custo de tratar SIGSEGV vs userfaultfd ---- */
+
+#define FAULT_PAGES 1024
+
+typedef enum {
+    FAULT_KERNEL,   // primeiro toque numa página anônima, sem ninguém no caminho
+    FAULT_SIGSEGV,  // página PROT_NONE, o tratador dá mprotect e a instrução repete
+    FAULT_UFFD      // página ausente servida por uma thread com UFFDIO_COPY
+} fault_mechanism_t;
+
+static const char* mechanism_names[] = {"kernel (1º toque)", "SIGSEGV+mprotect", "userfaultfd COPY"};
+
+static char* fault_region;
+static size_t fault_page;
+static volatile uint64_t handler_entry_ns;
+static int uffd = -1;
+static int uffd_stop[2] = {-1, -1};
+static char* uffd_source;
+
+static inline uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void recoverable_segv(int sig, siginfo_t* info, void* context) {
+    (void)context;
+    handler_entry_ns = now_ns();
+    char* addr = info->si_addr;
+    if (addr >= fault_region && addr < fault_region + FAULT_PAGES * fault_page) {
+        char* page = (char*)((uintptr_t)addr & ~(uintptr_t)(fault_page - 1));
+        mprotect(page, fault_page, PROT_READ | PROT_WRITE);
+        return; // ao voltar, a escrita é refeita e agora passa
+    }
+    // Falha fora da região: é um bug de verdade
+    signal(sig, SIG_DFL);
+}
+
+static void* uffd_server(void* arg) {
+    (void)arg;
+    struct pollfd fds[2] = {{uffd, POLLIN, 0}, {uffd_stop[0], POLLIN, 0}};
+    for (;;) {
+        if (poll(fds, 2, -1) < 0 || fds[1].revents) {
+            break;
+        }
+        // Não bloqueante: o poll pode acordar sem mensagem a ler
+        struct uffd_msg msg;
+        if (read(uffd, &msg, sizeof(msg)) != sizeof(msg) || msg.event != UFFD_EVENT_PAGEFAULT) {
+            continue;
+        }
+        handler_entry_ns = now_ns();
+        struct uffdio_copy copy;
+        copy.dst = msg.arg.pagefault.address & ~(uint64_t)(fault_page - 1);
+        copy.src = (uintptr_t)uffd_source;
+        copy.len = fault_page;
+        copy.mode = 0;
+        copy.copy = 0;
+        ioctl(uffd, UFFDIO_COPY, &copy);
+    }
+    return NULL;
+}
+
+static int uffd_open() {
+    long fd = -1;
+#ifdef UFFD_USER_MODE_ONLY
+    // Só falhas em modo usuário: dispensa privilégio nos kernels >= 5.11
+    fd = syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK | UFFD_USER_MODE_ONLY);
+#endif
+    if (fd < 0) {
+        fd = syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK);
+    }
+    if (fd < 0) {
+        perror("userfaultfd (precisa de vm.unprivileged_userfaultfd=1 ou CAP_SYS_PTRACE)");
+        return -1;
+    }
+    struct uffdio_api api = {.api = UFFD_API, .features = 0};
+    struct uffdio_register reg = {
+        .range = {.start = (uintptr_t)fault_region, .len = FAULT_PAGES * fault_page},
+        .mode = UFFDIO_REGISTER_MODE_MISSING,
+    };
+    if (ioctl(fd, UFFDIO_API, &api) != 0 || ioctl(fd, UFFDIO_REGISTER, &reg) != 0) {
+        perror("userfaultfd: UFFDIO_API/UFFDIO_REGISTER");
+        close(fd);
+        return -1;
+    }
+    return (int)fd;
+}
+
+// Deixa todas as páginas da região prontas para falhar de novo
+static void fault_rearm(fault_mechanism_t mechanism) {
+    if (mechanism == FAULT_SIGSEGV) {
+        mprotect(fault_region, FAULT_PAGES * fault_page, PROT_NONE);
+    } else {
+        madvise(fault_region, FAULT_PAGES * fault_page, MADV_DONTNEED);
+    }
+}
+
+static int compare_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static uint32_t percentile(uint32_t* sorted, long count, double p) {
+    long i = (long)(p * (count - 1));
+    return sorted[i];
+}
+
+// Libera o que fault_benchmark já tiver obtido (serve para toda saída dela)
+static void fault_release(uint32_t* latency, uint32_t* to_handler) {
+    for (int i = 0; i < 2; i++) {
+        if (uffd_stop[i] >= 0) close(uffd_stop[i]);
+        uffd_stop[i] = -1;
+    }
+    if (uffd >= 0) close(uffd);
+    uffd = -1;
+    if (uffd_source && uffd_source != MAP_FAILED) munmap(uffd_source, fault_page);
+    uffd_source = NULL;
+    if (fault_region && fault_region != MAP_FAILED) munmap(fault_region, FAULT_PAGES * fault_page);
+    fault_region = NULL;
+    free(latency);
+    free(to_handler);
+}
+
+static void fault_benchmark(fault_mechanism_t mechanism, long faults) {
+    fault_region = mmap(NULL, FAULT_PAGES * fault_page, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    uint32_t* latency = malloc(faults * sizeof(uint32_t));
+    uint32_t* to_handler = malloc(faults * sizeof(uint32_t));
+    if (fault_region == MAP_FAILED || !latency || !to_handler) {
+        printf("%-18s sem memória para a medição\n", mechanism_names[mechanism]);
+        fault_release(latency, to_handler);
+        return;
+    }
+
+    struct sigaction sa, previous;
+    pthread_t server;
+    if (mechanism == FAULT_SIGSEGV) {
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_sigaction = recoverable_segv;
+        sa.sa_flags = SA_SIGINFO;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGSEGV, &sa, &previous);
+    } else if (mechanism == FAULT_UFFD) {
+        uffd_source = mmap(NULL, fault_page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (uffd_source == MAP_FAILED) {
+            printf("%-18s sem memória para a medição\n", mechanism_names[mechanism]);
+            fault_release(latency, to_handler);
+            return;
+        }
+        memset(uffd_source, 0x5a, fault_page);
+        uffd = uffd_open();
+        if (uffd < 0 || pipe(uffd_stop) != 0 || pthread_create(&server, NULL, uffd_server, NULL) != 0) {
+            printf("%-18s indisponível\n", mechanism_names[mechanism]);
+            fault_release(latency, to_handler);
+            return;
+        }
+    }
+
+    // Cada acesso é cronometrado do instante antes da escrita até a volta
+    // dela; o tratador (ou a thread do userfaultfd) marca quando entrou
+    long done = 0;
+    uint64_t start = now_ns();
+    while (done < faults) {
+        fault_rearm(mechanism);
+        for (long i = 0; i < FAULT_PAGES && done < faults; i++, done++) {
+            volatile char* p = fault_region + i * fault_page;
+            handler_entry_ns = 0;
+            uint64_t t0 = now_ns();
+            *p = 1;
+            uint64_t t1 = now_ns();
+            latency[done] = (uint32_t)(t1 - t0);
+            to_handler[done] = handler_entry_ns ? (uint32_t)(handler_entry_ns - t0) : 0;
+        }
+    }
+    double seconds = (now_ns() - start) / 1e9;
+
+    if (mechanism == FAULT_SIGSEGV) {
+        sigaction(SIGSEGV, &previous, NULL);
+    } else if (mechanism == FAULT_UFFD) {
+        ssize_t ignored = write(uffd_stop[1], "x", 1);
+        (void)ignored;
+        pthread_join(server, NULL);
+    }
+
+    qsort(latency, faults, sizeof(uint32_t), compare_u32);
+    qsort(to_handler, faults, sizeof(uint32_t), compare_u32);
+    char entry[24] = "-";
+    if (mechanism != FAULT_KERNEL) {
+        snprintf(entry, sizeof(entry), "%u", percentile(to_handler, faults, 0.5));
+    }
+    printf("%-18s %10ld %12.0f %10u %10u %10u %14s\n",
+           mechanism_names[mechanism], faults, faults / seconds, percentile(latency, faults, 0.5),
+           percentile(latency, faults, 0.99), percentile(latency, faults, 0.999), entry);
+    fault_release(latency, to_handler);
+}
+
+void recoverable_faults(long faults, const char* which) {
+    fault_page = sysconf(_SC_PAGESIZE);
+    if (faults < 1) faults = 1;
+
+    // Custo das duas leituras do relógio que envolvem cada acesso
+    uint32_t clock_pairs[1001];
+    for (int i = 0; i < 1001; i++) {
+        uint64_t t0 = now_ns();
+        clock_pairs[i] = (uint32_t)(now_ns() - t0);
+    }
+    qsort(clock_pairs, 1001, sizeof(uint32_t), compare_u32);
+
+    printf("Medindo %ld falhas recuperáveis por mecanismo (região de %d páginas)...\n", faults, FAULT_PAGES);
+    printf("Latência = da escrita na página até a instrução seguinte, em ns (inclui ~%u ns do relógio)\n\n",
+           clock_pairs[500]);
+    printf("%-18s %10s %12s %10s %10s %10s %14s\n",
+           "mecanismo", "falhas", "falhas/s", "p50", "p99", "p99.9", "até tratar p50");
+    for (int m = FAULT_KERNEL; m <= FAULT_UFFD; m++) {
+        if (which && strcmp(which, "todos") != 0 &&
+            !(m == FAULT_KERNEL && strcmp(which, "kernel") == 0) &&
+            !(m == FAULT_SIGSEGV && strcmp(which, "sigsegv") == 0) &&
+            !(m == FAULT_UFFD && strcmp(which, "uffd") == 0)) {
+            continue;
+        }
+        fault_benchmark(m, faults);
+    }
+    printf("\nfalhas/s inclui o rearme da região (um mprotect ou MADV_DONTNEED a cada %d falhas).\n",
+           FAULT_PAGES);
+    printf("\"até tratar\" é o trecho da falha até o tratador de sinal ou a thread do\n");
+    printf("userfaultfd começar; o resto é o conserto (mprotect/UFFDIO_COPY) e a volta.\n");
+}
+
 int main(int argc, char *argv[]) {
     printf("=== DEMONSTRAÇÃO: SEGMENTATION FAULT ===\n");
+    perf_counters_init();
     
     int option = 1;
     if (argc > 1) {
@@ -57,8 +300,11 @@ int main(int argc, char *argv[]) {
         case 3:
             array_bounds_violation();
             break;
+        case 4:
+            recoverable_faults(argc > 2 ? atol(argv[2]) : 1000000, argc > 3 ? argv[3] : NULL);
+            break;
         default:
-            printf("Opções: 1=ponteiro nulo, 2=memória inválida, 3=array bounds\n");
+            printf("Opções: 1=ponteiro nulo, 2=memória inválida, 3=array bounds, 4=custo de falhas recuperáveis\n");
             null_pointer_access();
     }
     
@@ -0,0 +1,109 @@
+/*
+ * Saída formatada e encadeamento de tratadores - implementação
+ *
+ * Só write(2), signal(2) e raise(3), todas seguras em contexto de sinal.
+ */
+
+#include "sigsafe.h"
+
+#include <string.h>
+#include <unistd.h>
+
+void sig_flush(sig_writer_t* w) {
+    if (w->fd < 0) {
+        return;
+    }
+    int done = 0;
+    while (done < w->len) {
+        ssize_t n = write(w->fd, w->buf + done, w->len - done);
+        if (n <= 0) break;
+        done += n;
+    }
+    w->total += w->len;
+    w->len = 0;
+}
+
+void sig_bytes(sig_writer_t* w, const char* s, int n) {
+    // Um byte fica livre para o terminador de sig_text
+    for (int i = 0; i < n; i++) {
+        if (w->len == (int)sizeof(w->buf) - 1) {
+            if (w->fd < 0) return;
+            sig_flush(w);
+        }
+        w->buf[w->len++] = s[i];
+    }
+}
+
+void sig_char(sig_writer_t* w, char c) {
+    sig_bytes(w, &c, 1);
+}
+
+void sig_str(sig_writer_t* w, const char* s) {
+    sig_bytes(w, s, strlen(s));
+}
+
+void sig_unsigned(sig_writer_t* w, uint64_t v, int base, int min_digits) {
+    char tmp[24];
+    int i = sizeof(tmp);
+    do {
+        tmp[--i] = "0123456789abcdef"[v % base];
+        v /= base;
+    } while (v);
+    while (i > 0 && (int)sizeof(tmp) - i < min_digits) tmp[--i] = '0';
+    sig_bytes(w, tmp + i, sizeof(tmp) - i);
+}
+
+void sig_dec(sig_writer_t* w, long v) {
+    if (v < 0) {
+        sig_char(w, '-');
+    }
+    sig_unsigned(w, v < 0 ? -(unsigned long)v : (unsigned long)v, 10, 1);
+}
+
+void sig_hex(sig_writer_t* w, uint64_t v) {
+    sig_str(w, "0x");
+    sig_unsigned(w, v, 16, 1);
+}
+
+static int char_count(const char* s) {
+    int shown = 0;
+    for (; *s; s++) {
+        if ((*s & 0xC0) != 0x80) shown++; // conta caracteres, não bytes UTF-8
+    }
+    return shown;
+}
+
+void sig_left(sig_writer_t* w, const char* s, int width) {
+    sig_str(w, s);
+    for (int pad = char_count(s); pad < width; pad++) sig_char(w, ' ');
+}
+
+void sig_right(sig_writer_t* w, const char* s, int width) {
+    for (int pad = char_count(s); pad < width; pad++) sig_char(w, ' ');
+    sig_str(w, s);
+}
+
+const char* sig_text(sig_writer_t* w) {
+    w->buf[w->len] = '\0';
+    return w->buf;
+}
+
+void sig_end_line(sig_writer_t* w) {
+    sig_char(w, '\n');
+    sig_flush(w);
+}
+
+void sig_chain(int sig, siginfo_t* info, void* context, const struct sigaction* previous) {
+    if (previous && (previous->sa_flags & SA_SIGINFO) && previous->sa_sigaction) {
+        previous->sa_sigaction(sig, info, context);
+        return;
+    }
+    if (previous && previous->sa_handler != SIG_DFL && previous->sa_handler != SIG_IGN) {
+        previous->sa_handler(sig);
+        return;
+    }
+    signal(sig, SIG_DFL);
+    if (info->si_code <= 0) {
+        raise(sig);
+    }
+}
@@ -0,0 +1,53 @@
+/*
+ * Saída formatada e encadeamento de tratadores, seguros em contexto de sinal
+ *
+ * Os relatórios de falha (perf_counters, mutex_prof, evlog, stack_probe,
+ * guard_alloc, crash_handler) não podem usar stdio nem malloc dentro do
+ * tratador: montam o texto num sig_writer_t na pilha e o entregam com
+ * write(2). Com fd >= 0 o buffer é descarregado quando enche; com fd -1 o
+ * texto só é montado (e truncado no tamanho do buffer).
+ *
+ * sig_chain() repassa um sinal fatal para o tratador que estava instalado
+ * antes (guardado pelo sigaction de quem instalou o seu) ou, se era a ação
+ * padrão, restaura SIG_DFL: uma falha de hardware se repete ao retornar do
+ * tratador e um sinal enviado (abort, kill) é reenviado.
+ */
+
+#ifndef SIGSAFE_H
+#define SIGSAFE_H
+
+#include <signal.h>
+#include <stdint.h>
+
+#define SIG_WRITER_SIZE 1024
+
+typedef struct {
+    int fd;                      // -1: só monta o texto em buf
+    int len;
+    long total;                  // bytes já entregues ao fd
+    char buf[SIG_WRITER_SIZE];
+} sig_writer_t;
+
+void sig_flush(sig_writer_t* w);
+void sig_bytes(sig_writer_t* w, const char* s, int n);
+void sig_char(sig_writer_t* w, char c);
+void sig_str(sig_writer_t* w, const char* s);
+void sig_unsigned(sig_writer_t* w, uint64_t v, int base, int min_digits);
+void sig_dec(sig_writer_t* w, long v);
+void sig_hex(sig_writer_t* w, uint64_t v);   // com o prefixo 0x
+
+// Texto alinhado à esquerda ou à direita em width caracteres (UTF-8 conta
+// um caractere por código, não por byte)
+void sig_left(sig_writer_t* w, const char* s, int width);
+void sig_right(sig_writer_t* w, const char* s, int width);
+
+// Termina o texto montado com fd -1 e devolve buf como string
+const char* sig_text(sig_writer_t* w);
+
+// Quebra de linha e descarga
+void sig_end_line(sig_writer_t* w);
+
+// previous NULL: só a ação padrão
+void sig_chain(int sig, siginfo_t* info, void* context, const struct sigaction* previous);
+
+#endif
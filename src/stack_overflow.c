@@ -7,6 +7,10 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <pthread.h>
+
+#include "perf_counters.h"
+#include "stack_probe.h"
 
 // Função recursiva que causa stack overflow
 void recursive_function(int depth) {
@@ -18,9 +22,50 @@ void recursive_function(int depth) {
     recursive_function(depth + 1);
 }
 
-int main() {
+// Mesma recursão sem printf e com frame de tamanho escolhido: cada nível
+// só registra a profundidade e o endereço do frame para o tratador
+void measured_recursion(long depth, size_t frame_bytes) {
+    volatile char buffer[frame_bytes];
+    buffer[0] = (char)depth;
+    stack_probe_frame(depth, (const void*)buffer);
+    
+    measured_recursion(depth + 1, frame_bytes);
+    
+    buffer[frame_bytes - 1] = 0; // nunca executa; impede a chamada em cauda
+}
+
+void* overflow_thread(void* arg) {
+    stack_probe_thread_begin("recursão");
+    measured_recursion(1, *(size_t*)arg);
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
     printf("=== DEMONSTRAÇÃO: STACK OVERFLOW ===\n");
+    perf_counters_init();
+    stack_probe_init();
+    
+    int option = argc > 1 ? atoi(argv[1]) : 1;
+    if (option == 2) {
+        // Uso: stack_overflow 2 [bytes_por_frame]  (STACK_SIZE=N muda a pilha)
+        size_t frame_bytes = argc > 2 ? (size_t)atol(argv[2]) : 1024;
+        if (frame_bytes < 16) frame_bytes = 16;
+        printf("Recursão com frames de %zu bytes numa thread; o estouro é medido na sigaltstack\n",
+               frame_bytes);
+        fflush(stdout);
+        
+        stack_probe_overflow_arm();
+        pthread_t thread;
+        if (pthread_create(&thread, stack_probe_attr(), overflow_thread, &frame_bytes) != 0) {
+            perror("Erro ao criar thread");
+            exit(1);
+        }
+        pthread_join(thread, NULL);
+        return 0;
+    }
+    
     printf("Iniciando recursão infinita que causará stack overflow...\n");
+    printf("(opção 2: profundidade e bytes por frame medidos no estouro)\n");
     
     // Inicia a recursão que causará o erro
     recursive_function(1);
@@ -0,0 +1,283 @@
+/*
+ * Uso de pilha por thread - implementação
+ *
+ * A pilha da thread (limites de pthread_getattr_np, sem a página de
+ * guarda) é pintada do fundo até um pouco abaixo do frame atual. Como a
+ * pilha cresce para baixo, a marca d'água é a primeira palavra, a partir
+ * do fundo, que não tem mais o padrão.
+ */
+
+#define _GNU_SOURCE
+#include "stack_probe.h"
+#include "sigsafe.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/mman.h>
+
+#define PAINT_WORD 0xA5A5A5A5A5A5A5A5ULL
+#define PAINT_MARGIN 512             // folga abaixo dos locais de quem pinta
+#define MAX_ROWS 32
+#define MAX_LIVE 256
+#define ALT_STACK_SIZE (64 * 1024)
+#define OVERFLOW_REACH (1024 * 1024) // falhas até 1 MiB abaixo do fundo contam como estouro
+
+typedef struct {
+    const char* label;
+    long threads;
+    size_t reserved;
+    size_t used_max;
+    size_t used_sum;
+} stack_row_t;
+
+typedef struct {
+    const char* label;
+    char* low;
+    char* high;
+} live_stack_t;
+
+static int enabled = 0;
+static int overflow_armed = 0;
+static pthread_attr_t attr;
+static int attr_set = 0;
+static size_t configured_size = 0;
+
+static pthread_mutex_t rows_lock = PTHREAD_MUTEX_INITIALIZER;
+static stack_row_t rows[MAX_ROWS];
+static int row_count = 0;
+static live_stack_t live[MAX_LIVE];
+
+static __thread char* stack_low = NULL;
+static __thread char* stack_high = NULL;
+static __thread const char* stack_label = NULL;
+static __thread int live_slot = -1;
+static __thread void* alt_stack = NULL;
+
+// Registro do modo de estouro (lido pelo tratador na pilha alternativa)
+static __thread long frame_depth = 0;
+static __thread uintptr_t first_frame = 0;
+static __thread uintptr_t last_frame = 0;
+
+static struct sigaction previous_segv;
+
+// "256K", "8M", "65536"
+static size_t parse_size(const char* s) {
+    char* end;
+    double value = strtod(s, &end);
+    if (*end == 'k' || *end == 'K') value *= 1024;
+    if (*end == 'm' || *end == 'M') value *= 1024 * 1024;
+    return value > 0 ? (size_t)value : 0;
+}
+
+static size_t high_water(const char* low, const char* high) {
+    const uint64_t* p = (const uint64_t*)low;
+    const uint64_t* end = (const uint64_t*)high;
+    while (p < end && *p == PAINT_WORD) {
+        p++;
+    }
+    return high - (const char*)p;
+}
+
+// Chamado com rows_lock
+static void add_sample(const char* label, size_t reserved, size_t used) {
+    int i;
+    for (i = 0; i < row_count; i++) {
+        if (rows[i].label == label) break;
+    }
+    if (i == row_count && row_count < MAX_ROWS) {
+        rows[row_count].label = label;
+        row_count++;
+    }
+    if (i < row_count) {
+        rows[i].threads++;
+        if (reserved > rows[i].reserved) rows[i].reserved = reserved;
+        if (used > rows[i].used_max) rows[i].used_max = used;
+        rows[i].used_sum += used;
+    }
+}
+
+const pthread_attr_t* stack_probe_attr() {
+    return attr_set ? &attr : NULL;
+}
+
+void stack_probe_thread_begin(const char* label) {
+    if (!enabled && !overflow_armed) {
+        return;
+    }
+    pthread_attr_t self_attr;
+    void* addr;
+    size_t size;
+    if (pthread_getattr_np(pthread_self(), &self_attr) != 0) {
+        return;
+    }
+    pthread_attr_getstack(&self_attr, &addr, &size);
+    pthread_attr_destroy(&self_attr);
+    stack_low = addr;
+    stack_high = (char*)addr + size;
+    stack_label = label;
+
+    if (overflow_armed && !alt_stack) {
+        // sigaltstack é por thread: sem ela o tratador não teria onde rodar
+        stack_t alt;
+        alt_stack = mmap(NULL, ALT_STACK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (alt_stack == MAP_FAILED) {
+            alt_stack = NULL;
+        } else {
+            alt.ss_sp = alt_stack;
+            alt.ss_size = ALT_STACK_SIZE;
+            alt.ss_flags = 0;
+            sigaltstack(&alt, NULL);
+        }
+    }
+
+    if (enabled) {
+        // Laço em vez de memset: sem chamada (nem resolução de PLT) usando
+        // a pilha logo abaixo daqui enquanto ela é pintada
+        volatile uint64_t marker = 0;
+        volatile uint64_t* p = (volatile uint64_t*)stack_low;
+        volatile uint64_t* end = (volatile uint64_t*)(((uintptr_t)&marker - PAINT_MARGIN) & ~(uintptr_t)7);
+        while (p < end) {
+            *p++ = PAINT_WORD;
+        }
+        pthread_mutex_lock(&rows_lock);
+        for (int i = 0; i < MAX_LIVE; i++) {
+            if (!live[i].low) {
+                live[i].label = label;
+                live[i].low = stack_low;
+                live[i].high = stack_high;
+                live_slot = i;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&rows_lock);
+    }
+}
+
+void stack_probe_thread_end() {
+    if (enabled && stack_low) {
+        size_t used = high_water(stack_low, stack_high);
+        pthread_mutex_lock(&rows_lock);
+        add_sample(stack_label, stack_high - stack_low, used);
+        if (live_slot >= 0) {
+            live[live_slot].low = NULL;
+            live_slot = -1;
+        }
+        pthread_mutex_unlock(&rows_lock);
+    }
+    if (alt_stack) {
+        stack_t alt = {.ss_flags = SS_DISABLE};
+        sigaltstack(&alt, NULL);
+        munmap(alt_stack, ALT_STACK_SIZE);
+        alt_stack = NULL;
+    }
+    stack_low = stack_high = NULL;
+}
+
+void stack_probe_report() {
+    if (!enabled) {
+        return;
+    }
+    pthread_mutex_lock(&rows_lock);
+    // Threads ainda rodando (ex.: presas num deadlock) entram com a marca atual
+    for (int i = 0; i < MAX_LIVE; i++) {
+        if (live[i].low) {
+            add_sample(live[i].label, live[i].high - live[i].low, high_water(live[i].low, live[i].high));
+            live[i].low = NULL;
+        }
+    }
+
+    if (row_count > 0) {
+        size_t largest = 0;
+        fflush(stdout);
+        fprintf(stderr, "\n[stack] uso de pilha por thread (marca d'água da pintura)\n");
+        fprintf(stderr, "%-16s %8s %14s %14s %14s %8s\n",
+                "thread", "threads", "reservado(KiB)", "maior uso(KiB)", "uso médio(KiB)", "% maior");
+        for (int i = 0; i < row_count; i++) {
+            stack_row_t* r = &rows[i];
+            fprintf(stderr, "%-16s %8ld %14.1f %14.1f %14.1f %7.2f%%\n",
+                    r->label ? r->label : "?", r->threads, r->reserved / 1024.0, r->used_max / 1024.0,
+                    r->used_sum / 1024.0 / r->threads, r->reserved ? 100.0 * r->used_max / r->reserved : 0);
+            if (r->used_max > largest) largest = r->used_max;
+        }
+
+        // Dobro do maior uso, arredondado para 16 KiB
+        size_t suggested = (largest * 2 + 16383) / 16384 * 16;
+        if (suggested * 1024 < PTHREAD_STACK_MIN) suggested = PTHREAD_STACK_MIN / 1024;
+        fprintf(stderr, "Maior uso: %.1f KiB; STACK_SIZE=%zuK cobre o dobro disso\n",
+                largest / 1024.0, suggested);
+        row_count = 0;
+    }
+    pthread_mutex_unlock(&rows_lock);
+}
+
+static void report_at_exit() {
+    stack_probe_report();
+}
+
+void stack_probe_init() {
+    const char* probe = getenv("STACK_PROBE");
+    enabled = probe && strcmp(probe, "1") == 0;
+
+    const char* size = getenv("STACK_SIZE");
+    if (size && *size) {
+        long page = sysconf(_SC_PAGESIZE);
+        configured_size = (parse_size(size) + page - 1) / page * page;
+        if (configured_size < PTHREAD_STACK_MIN) configured_size = PTHREAD_STACK_MIN;
+        pthread_attr_init(&attr);
+        if (pthread_attr_setstacksize(&attr, configured_size) != 0) {
+            fprintf(stderr, "stack_probe: STACK_SIZE=%s inválido\n", size);
+            pthread_attr_destroy(&attr);
+        } else {
+            attr_set = 1;
+        }
+    }
+
+    if (enabled) {
+        atexit(report_at_exit);
+    }
+}
+
+/* ---- estouro medido (seguro em contexto de sinal) ---- */
+
+void stack_probe_frame(long depth, const void* frame) {
+    if (depth <= 1) {
+        first_frame = (uintptr_t)frame;
+    }
+    last_frame = (uintptr_t)frame;
+    frame_depth = depth;
+}
+
+static void overflow_signal(int sig, siginfo_t* info, void* context) {
+    char* addr = info->si_addr;
+    if (stack_low && addr < stack_low + 4096 && addr >= stack_low - OVERFLOW_REACH && frame_depth > 1) {
+        sig_writer_t w = {.fd = STDERR_FILENO};
+        sig_str(&w, "\n[stack] estouro na profundidade ");
+        sig_unsigned(&w, frame_depth, 10, 1);
+        sig_str(&w, ": ");
+        sig_unsigned(&w, (first_frame - last_frame) / (frame_depth - 1), 10, 1);
+        sig_str(&w, " bytes por frame, ");
+        sig_unsigned(&w, (stack_high - addr) / 1024, 10, 1);
+        sig_str(&w, " KiB usados de ");
+        sig_unsigned(&w, (stack_high - stack_low) / 1024, 10, 1);
+        sig_str(&w, " KiB reservados\n");
+        sig_flush(&w);
+    }
+
+    // Repassa para quem estava instalado antes (relatório do perf_counters etc.)
+    sig_chain(sig, info, context, &previous_segv);
+}
+
+void stack_probe_overflow_arm() {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = overflow_signal;
+    sa.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_RESETHAND;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGSEGV, &sa, &previous_segv);
+    overflow_armed = 1;
+}
@@ -0,0 +1,44 @@
+/*
+ * Uso de pilha por thread: pintura, marca d'água e estouro medido
+ *
+ * Com STACK_PROBE=1 no ambiente, cada thread instrumentada pinta a parte
+ * ainda não usada da sua pilha com um padrão ao começar e, ao terminar,
+ * procura a partir do fundo a primeira palavra alterada: esse é o ponto
+ * mais fundo que a pilha alcançou (a marca d'água). No fim do processo
+ * sai em stderr uma tabela por rótulo com o reservado, o maior e o médio
+ * uso, e um tamanho que bastaria. A pintura toca todas as páginas da
+ * pilha, então só vale para medir.
+ *
+ * STACK_SIZE=N (aceita K e M) define o tamanho da pilha das threads
+ * criadas com stack_probe_attr(), via pthread_attr_setstacksize.
+ *
+ * stack_probe_overflow_arm() instala um tratador de SIGSEGV que roda numa
+ * sigaltstack de cada thread instrumentada e, se a falha for estouro da
+ * pilha, informa a profundidade alcançada e os bytes por frame
+ * registrados com stack_probe_frame(), e depois repassa o sinal ao
+ * tratador anterior.
+ */
+
+#ifndef STACK_PROBE_H
+#define STACK_PROBE_H
+
+#include <pthread.h>
+
+// Lê STACK_PROBE e STACK_SIZE e registra o relatório no atexit
+void stack_probe_init();
+
+// Atributos para pthread_create (NULL sem STACK_SIZE)
+const pthread_attr_t* stack_probe_attr();
+
+// No início e no fim da função de cada thread (não na thread principal)
+void stack_probe_thread_begin(const char* label);
+void stack_probe_thread_end();
+
+// Imprime a tabela agora (antes de _exit, hooks de relatório)
+void stack_probe_report();
+
+// Modo de estouro medido: tratador na sigaltstack e registro por frame
+void stack_probe_overflow_arm();
+void stack_probe_frame(long depth, const void* frame);
+
+#endif
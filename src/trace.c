@@ -0,0 +1,303 @@
+/*
+ * Trace binário de eventos por thread - implementação
+ *
+ * Cada thread ganha uma região fixa do arquivo no primeiro evento e é a
+ * única a escrever nela: o evento é preenchido e só então o contador da
+ * thread avança (store com release), então um leitor nunca vê um evento
+ * pela metade. Nomes são gravados uma vez por ponteiro numa tabela de
+ * strings dentro do próprio arquivo.
+ *
+ * trace_thread_end() devolve a região, e a próxima thread nova continua
+ * gravando nela depois dos eventos da anterior: o limite de
+ * TRACE_MAX_THREADS vale para threads vivas ao mesmo tempo, não para o
+ * total da execução. Cada ocupação começa com um TRACE_THREAD_BEGIN com o
+ * tid em obj, que é como o trace2json separa as threads de uma região.
+ */
+
+#define _GNU_SOURCE
+#include "trace.h"
+#include "sigsafe.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define INTERN_SLOTS 512
+#define INTERN_FAILED UINT32_MAX
+
+static int enabled = 0;
+static trace_header_t* header = NULL;
+static trace_event_t* regions = NULL;
+static uint32_t per_thread = 32768;
+static size_t mapping_size;
+static const char* trace_path;
+
+static __thread int slot = -1;   // -2: sem região livre para esta thread
+static atomic_int released[TRACE_MAX_THREADS]; // região devolvida, esperando outra thread
+static atomic_uint occupants = 0;                // threads que já gravaram, somando as regiões
+
+// Ponteiro da string -> offset na tabela (inserção sem lock com CAS)
+static struct {
+    const char* _Atomic ptr;
+    _Atomic uint32_t offset;
+} intern_cache[INTERN_SLOTS];
+
+static const int fatal_signals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+static struct sigaction previous[NSIG];
+
+static uint64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint32_t copy_string(const char* s) {
+    size_t len = strlen(s) + 1;
+    uint64_t offset = __atomic_fetch_add(&header->strings_used, len, __ATOMIC_RELAXED);
+    if (offset + len > TRACE_STRINGS_SIZE) {
+        return INTERN_FAILED;
+    }
+    memcpy(header->strings + offset, s, len);
+    return (uint32_t)offset;
+}
+
+static uint32_t intern(const char* s) {
+    if (!s || !*s) {
+        return 0;
+    }
+
+    unsigned h = (unsigned)(((uintptr_t)s >> 3) * 0x9E3779B97F4A7C15ULL >> 55);
+    for (int probe = 0; probe < INTERN_SLOTS; probe++) {
+        int i = (h + probe) % INTERN_SLOTS;
+        const char* current = atomic_load(&intern_cache[i].ptr);
+
+        if (!current) {
+            const char* expected = NULL;
+            if (atomic_compare_exchange_strong(&intern_cache[i].ptr, &expected, s)) {
+                uint32_t offset = copy_string(s);
+                atomic_store(&intern_cache[i].offset, offset);
+                return offset == INTERN_FAILED ? 0 : offset;
+            }
+            current = expected;
+        }
+        if (current == s) {
+            uint32_t offset;
+            while ((offset = atomic_load(&intern_cache[i].offset)) == 0) {
+                // outra thread está copiando a mesma string
+            }
+            return offset == INTERN_FAILED ? 0 : offset;
+        }
+    }
+    return 0;
+}
+
+static void record(trace_type_t type, uint32_t name, uint64_t obj, uint64_t value);
+
+// Região nunca usada primeiro; esgotadas, a devolvida com mais espaço livre
+static int acquire_slot() {
+    if (__atomic_load_n(&header->thread_count, __ATOMIC_RELAXED) < TRACE_MAX_THREADS) {
+        uint32_t index = __atomic_fetch_add(&header->thread_count, 1, __ATOMIC_RELAXED);
+        if (index < TRACE_MAX_THREADS) {
+            return (int)index;
+        }
+    }
+    for (;;) {
+        int best = -1;
+        for (int i = 0; i < TRACE_MAX_THREADS; i++) {
+            if (atomic_load_explicit(&released[i], memory_order_relaxed) &&
+                (best < 0 || header->threads[i].count < header->threads[best].count)) {
+                best = i;
+            }
+        }
+        if (best < 0) {
+            return -2;
+        }
+        int expected = 1;
+        if (atomic_compare_exchange_strong(&released[best], &expected, 0)) {
+            return best;
+        }
+    }
+}
+
+static trace_thread_t* current_thread(uint32_t label) {
+    if (slot == -1) {
+        slot = acquire_slot();
+        if (slot >= 0) {
+            pid_t tid = gettid();
+            atomic_fetch_add_explicit(&occupants, 1, memory_order_relaxed);
+            header->threads[slot].tid = tid;
+            header->threads[slot].label = label;
+            record(TRACE_THREAD_BEGIN, label, (uint64_t)tid, 0);
+        }
+    }
+    return slot >= 0 ? &header->threads[slot] : NULL;
+}
+
+static void record(trace_type_t type, uint32_t name, uint64_t obj, uint64_t value) {
+    trace_thread_t* t = current_thread(0);
+    if (!t) {
+        return;
+    }
+
+    uint64_t n = t->count;
+    if (n >= per_thread) {
+        t->dropped++;
+        return;
+    }
+
+    trace_event_t* e = &regions[(size_t)slot * per_thread + n];
+    e->ts_ns = monotonic_ns();
+    e->type = type;
+    e->name = name;
+    e->obj = obj;
+    e->value = value;
+    __atomic_store_n(&t->count, n + 1, __ATOMIC_RELEASE);
+}
+
+int trace_enabled() {
+    return enabled;
+}
+
+void trace_thread_begin(const char* label) {
+    if (!enabled) {
+        return;
+    }
+    uint32_t name = intern(label);
+    if (slot == -1) {
+        current_thread(name); // o TRACE_THREAD_BEGIN já sai com o rótulo
+        return;
+    }
+    // Já gravou eventos antes: o segundo TRACE_THREAD_BEGIN só dá o nome
+    trace_thread_t* t = current_thread(name);
+    if (t) {
+        t->label = name;
+        record(TRACE_THREAD_BEGIN, name, (uint64_t)t->tid, 0);
+    }
+}
+
+void trace_thread_end() {
+    if (enabled && slot >= 0) {
+        record(TRACE_THREAD_END, 0, 0, 0);
+        atomic_store(&released[slot], 1);
+        slot = -1;
+    }
+}
+
+void trace_lock(trace_type_t type, const void* lock, const char* name) {
+    if (enabled) {
+        record(type, intern(name), (uintptr_t)lock, 0);
+    }
+}
+
+void trace_alloc(const void* ptr, size_t size) {
+    if (enabled && ptr) {
+        record(TRACE_ALLOC, 0, (uintptr_t)ptr, size);
+    }
+}
+
+void trace_free(const void* ptr) {
+    if (enabled && ptr) {
+        record(TRACE_FREE, 0, (uintptr_t)ptr, 0);
+    }
+}
+
+void trace_counter(const char* name, long value) {
+    if (enabled) {
+        record(TRACE_COUNTER, intern(name), 0, (uint64_t)value);
+    }
+}
+
+void trace_mark(const char* name, long value) {
+    if (enabled) {
+        record(TRACE_MARK, intern(name), 0, (uint64_t)value);
+    }
+}
+
+// Registra o sinal e repassa para quem estava instalado antes
+static void crash_signal(int sig, siginfo_t* info, void* context) {
+    record(TRACE_SIGNAL, 0, (uintptr_t)info->si_addr, sig);
+    enabled = 0;
+
+    sig_chain(sig, info, context, &previous[sig]);
+}
+
+static void summary_at_exit() {
+    if (!enabled) {
+        return;
+    }
+    uint64_t events = 0, dropped = 0;
+    uint32_t threads = header->thread_count < TRACE_MAX_THREADS ? header->thread_count : TRACE_MAX_THREADS;
+    for (uint32_t i = 0; i < threads; i++) {
+        events += header->threads[i].count;
+        dropped += header->threads[i].dropped;
+    }
+    fprintf(stderr, "[trace] %lu eventos de %u threads (%u regiões) em %s", (unsigned long)events,
+            atomic_load(&occupants), threads, trace_path);
+    if (dropped) {
+        fprintf(stderr, " (%lu descartados: aumente TRACE_EVENTS)", (unsigned long)dropped);
+    }
+    fprintf(stderr, "; converta com trace2json\n");
+}
+
+void trace_init() {
+    trace_path = getenv("TRACE_OUT");
+    if (!trace_path || !*trace_path) {
+        return;
+    }
+    const char* events = getenv("TRACE_EVENTS");
+    if (events && atol(events) > 0) {
+        per_thread = (uint32_t)atol(events);
+    }
+
+    // Arquivo esparso: só as páginas tocadas ocupam disco
+    mapping_size = sizeof(trace_header_t) + (size_t)TRACE_MAX_THREADS * per_thread * sizeof(trace_event_t);
+    int fd = open(trace_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, mapping_size) < 0) {
+        perror("trace: TRACE_OUT");
+        if (fd >= 0) close(fd);
+        return;
+    }
+    void* map = mmap(NULL, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("trace: mmap");
+        return;
+    }
+
+    header = map;
+    regions = (trace_event_t*)((char*)map + sizeof(trace_header_t));
+    header->pid = getpid();
+    header->events_per_thread = per_thread;
+    header->start_ns = monotonic_ns();
+    header->strings_used = 1; // offset 0 é a string vazia
+
+    char comm[32] = "";
+    FILE* f = fopen("/proc/self/comm", "r");
+    if (f) {
+        if (fgets(comm, sizeof(comm), f)) {
+            comm[strcspn(comm, "\n")] = '\0';
+        }
+        fclose(f);
+    }
+    header->process_name = copy_string(comm);
+    memcpy(header->magic, TRACE_MAGIC, sizeof(header->magic));
+
+    enabled = 1;
+    trace_thread_begin("main");
+    atexit(summary_at_exit);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = crash_signal;
+    sa.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_RESETHAND;
+    sigemptyset(&sa.sa_mask);
+    for (int i = 0; i < (int)(sizeof(fatal_signals) / sizeof(fatal_signals[0])); i++) {
+        sigaction(fatal_signals[i], &sa, &previous[fatal_signals[i]]);
+    }
+}
@@ -0,0 +1,98 @@
+/*
+ * Trace binário de eventos por thread
+ *
+ * Com TRACE_OUT=arquivo no ambiente, cada thread grava eventos de 32 bytes
+ * (instante, tipo, nome, objeto, valor) numa região própria de um arquivo
+ * mapeado com MAP_SHARED: gravar um evento é um store na memória, sem
+ * syscall nem lock, e o que foi gravado fica no page cache mesmo se o
+ * processo morrer por sinal ou _exit().
+ *
+ * Eventos: início/fim de thread, pedido/aquisição/liberação de lock (pelos
+ * ganchos do mutex_prof, então cobre lockdep e mutex_prof_t), alocação e
+ * liberação, sinais fatais, contadores e marcas. bin/trace2json converte o
+ * arquivo para o formato Chrome Trace Event, que abre direto no Perfetto
+ * (ui.perfetto.dev) ou em chrome://tracing, com a espera por cada lock e
+ * o tempo de posse como intervalos na linha de cada thread.
+ *
+ *   TRACE_OUT=deadlock.trace ./bin/deadlock 2
+ *   ./bin/trace2json deadlock.trace > deadlock.json
+ *
+ * TRACE_EVENTS=N define quantos eventos cabem por região (padrão 32768);
+ * quando a região enche, os eventos seguintes são contados e descartados.
+ * Uma thread que termina com trace_thread_end() devolve sua região para a
+ * próxima, então TRACE_MAX_THREADS limita só as threads vivas ao mesmo tempo.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* ---- formato do arquivo (lido também pelo trace2json) ---- */
+
+#define TRACE_MAGIC "TRACE01"
+#define TRACE_MAX_THREADS 128
+#define TRACE_STRINGS_SIZE (64 * 1024)
+
+typedef enum {
+    TRACE_THREAD_BEGIN = 1,  // name = rótulo da thread, obj = tid
+    TRACE_THREAD_END,
+    TRACE_LOCK_WAIT,         // name = lock, obj = endereço do lock
+    TRACE_LOCK_ACQUIRE,
+    TRACE_LOCK_RELEASE,
+    TRACE_ALLOC,             // obj = ponteiro, value = bytes
+    TRACE_FREE,              // obj = ponteiro
+    TRACE_SIGNAL,            // value = número do sinal
+    TRACE_COUNTER,           // name = série, value = valor
+    TRACE_MARK               // name = marca, value = livre
+} trace_type_t;
+
+typedef struct {
+    uint64_t ts_ns;    // CLOCK_MONOTONIC
+    uint16_t type;
+    uint16_t reserved;
+    uint32_t name;     // offset na tabela de strings (0 = sem nome)
+    uint64_t obj;
+    uint64_t value;
+} trace_event_t;
+
+// Uma região; com reaproveitamento, tid e label são da última thread que a
+// ocupou e as anteriores aparecem nos TRACE_THREAD_BEGIN (obj = tid)
+typedef struct {
+    uint32_t tid;
+    uint32_t label;    // offset na tabela de strings
+    uint64_t count;    // eventos gravados (publicado depois do evento)
+    uint64_t dropped;
+} trace_thread_t;
+
+typedef struct {
+    char magic[8];
+    uint32_t pid;
+    uint32_t events_per_thread;
+    uint64_t start_ns;
+    uint64_t strings_used;   // bytes usados em strings (o byte 0 é a string vazia)
+    uint32_t thread_count;
+    uint32_t process_name;   // offset na tabela de strings
+    trace_thread_t threads[TRACE_MAX_THREADS];
+    char strings[TRACE_STRINGS_SIZE];
+    // seguem TRACE_MAX_THREADS regiões de events_per_thread trace_event_t
+} trace_header_t;
+
+/* ---- API ---- */
+
+// Lê TRACE_OUT e cria o arquivo; sem a variável tudo vira no-op
+void trace_init();
+int trace_enabled();
+
+void trace_thread_begin(const char* label);
+void trace_thread_end();
+
+// name precisa ser uma string estática (é gravada uma vez por ponteiro)
+void trace_lock(trace_type_t type, const void* lock, const char* name);
+void trace_alloc(const void* ptr, size_t size);
+void trace_free(const void* ptr);
+void trace_counter(const char* name, long value);
+void trace_mark(const char* name, long value);
+
+#endif
@@ -0,0 +1,371 @@
+/*
+ * Conversor do trace binário (TRACE_OUT) para Chrome Trace Event JSON
+ *
+ * Junta os eventos de todas as threads em ordem de tempo e gera:
+ *   - um intervalo por thread (início ao fim, ou até o fim do trace);
+ *   - "espera <lock>" do pedido à aquisição e "segura <lock>" da aquisição
+ *     à liberação, na linha da thread;
+ *   - contadores (ex.: shared_counter) e o heap rastreado por alloc/free;
+ *   - marcas e sinais como eventos instantâneos.
+ * Esperas e posses que nunca terminam (deadlock, processo morto por sinal)
+ * vão até o último instante do trace com "inacabado": true e são listadas
+ * no resumo em stderr.
+ *
+ * Uso: trace2json <arquivo.trace> [saida.json]   (padrão: stdout)
+ * Abra o JSON em https://ui.perfetto.dev ou chrome://tracing.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "trace.h"
+
+#define MAX_OPEN 64
+#define HEAP_SLOTS (1 << 16)
+
+typedef struct {
+    const trace_event_t* event;
+    int thread;
+} item_t;
+
+typedef struct {
+    uint64_t obj;
+    uint64_t ts;
+    uint32_t name;
+} open_span_t;
+
+typedef struct {
+    open_span_t waits[MAX_OPEN];
+    int wait_count;
+    open_span_t holds[MAX_OPEN];
+    int hold_count;
+    uint64_t begin_ts;
+    int running;
+    uint32_t tid;      // ocupante atual da região (muda a cada TRACE_THREAD_BEGIN com outro tid)
+    uint32_t label;
+} thread_state_t;
+
+static const trace_header_t* header;
+static FILE* out;
+static int first_event = 1;
+static uint64_t heap_ptr[HEAP_SLOTS];
+static uint64_t heap_size[HEAP_SLOTS];
+static int64_t heap_live = 0;
+
+static uint64_t strings_limit;   // strings_used limitado à tabela
+
+// Offsets fora da tabela ou strings sem terminador (trace truncado) viram ""
+static const char* string_at(uint32_t offset) {
+    if (!offset || offset >= strings_limit ||
+        !memchr(header->strings + offset, '\0', strings_limit - offset)) {
+        return "";
+    }
+    return header->strings + offset;
+}
+
+static void json_string(const char* s) {
+    fputc('"', out);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') {
+            fprintf(out, "\\%c", *s);
+        } else if ((unsigned char)*s < 0x20) {
+            fprintf(out, "\\u%04x", *s);
+        } else {
+            fputc(*s, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static double us(uint64_t ts) {
+    return ts > header->start_ns ? (ts - header->start_ns) / 1000.0 : 0;
+}
+
+static void begin_event(const char* ph, const char* prefix, const char* name, uint32_t tid, uint64_t ts) {
+    fprintf(out, "%s\n{\"ph\":\"%s\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f,\"name\":",
+            first_event ? "" : ",", ph, header->pid, tid, us(ts));
+    first_event = 0;
+
+    char full[256];
+    snprintf(full, sizeof(full), "%s%s", prefix, name);
+    json_string(full);
+}
+
+static void span(const char* prefix, const char* name, const char* cat, uint32_t tid,
+                 uint64_t start, uint64_t end, int unfinished) {
+    begin_event("X", prefix, name, tid, start);
+    fprintf(out, ",\"cat\":\"%s\",\"dur\":%.3f", cat, (end - start) / 1000.0);
+    if (unfinished) {
+        fprintf(out, ",\"args\":{\"inacabado\":true}");
+    }
+    fputc('}', out);
+}
+
+static int remove_open(open_span_t* spans, int* count, uint64_t obj, open_span_t* found) {
+    for (int i = *count - 1; i >= 0; i--) {
+        if (spans[i].obj == obj) {
+            *found = spans[i];
+            spans[i] = spans[--*count];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void push_open(open_span_t* spans, int* count, uint64_t obj, uint64_t ts, uint32_t name) {
+    if (*count < MAX_OPEN) {
+        spans[*count].obj = obj;
+        spans[*count].ts = ts;
+        spans[*count].name = name;
+        (*count)++;
+    }
+}
+
+// Tabela ptr -> bytes para o contador de heap (endereçamento aberto)
+static void heap_track(uint64_t ptr, uint64_t size, int alloc) {
+    unsigned i = (unsigned)((ptr >> 4) * 0x9E3779B97F4A7C15ULL >> 48) % HEAP_SLOTS;
+    for (int probe = 0; probe < HEAP_SLOTS; probe++, i = (i + 1) % HEAP_SLOTS) {
+        if (alloc && (heap_ptr[i] == 0 || heap_ptr[i] == 1)) {
+            heap_ptr[i] = ptr;
+            heap_size[i] = size;
+            heap_live += size;
+            return;
+        }
+        if (!alloc && heap_ptr[i] == ptr) {
+            heap_ptr[i] = 1; // lápide
+            heap_live -= heap_size[i];
+            return;
+        }
+        if (heap_ptr[i] == 0) {
+            return; // free de algo alocado antes do trace
+        }
+    }
+}
+
+static void thread_name(uint32_t tid, uint32_t label) {
+    char name[128];
+    snprintf(name, sizeof(name), "%s (tid %u)", *string_at(label) ? string_at(label) : "thread", tid);
+    begin_event("M", "", "thread_name", tid, header->start_ns);
+    fprintf(out, ",\"args\":{\"name\":");
+    json_string(name);
+    fprintf(out, "}}");
+}
+
+// Fecha como inacabado o que o ocupante da região deixou aberto; devolve
+// quantas esperas por lock ficaram sem fim
+static int close_open(thread_state_t* s, uint64_t end_ts, int report) {
+    int waits = s->wait_count;
+    for (int i = 0; i < s->wait_count; i++) {
+        span("espera ", string_at(s->waits[i].name), "lock", s->tid, s->waits[i].ts, end_ts, 1);
+        if (report) {
+            fprintf(stderr, "  tid %u ainda esperava %s (há %.3f ms no fim do trace)\n", s->tid,
+                    string_at(s->waits[i].name), (end_ts - s->waits[i].ts) / 1e6);
+        }
+    }
+    for (int i = 0; i < s->hold_count; i++) {
+        span("segura ", string_at(s->holds[i].name), "lock", s->tid, s->holds[i].ts, end_ts, 1);
+    }
+    if (s->running) {
+        span("thread ", string_at(s->label), "thread", s->tid, s->begin_ts, end_ts, 1);
+    }
+    s->wait_count = s->hold_count = 0;
+    s->running = 0;
+    return waits;
+}
+
+static int compare_items(const void* a, const void* b) {
+    uint64_t x = ((const item_t*)a)->event->ts_ns, y = ((const item_t*)b)->event->ts_ns;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Uso: %s <arquivo.trace> [saida.json]\n", argv[0]);
+        return 2;
+    }
+
+    int fd = open(argv[1], O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        perror(argv[1]);
+        return 1;
+    }
+    if ((size_t)st.st_size < sizeof(trace_header_t)) {
+        fprintf(stderr, "%s: arquivo curto demais para um trace\n", argv[1]);
+        return 1;
+    }
+    const char* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    header = (const trace_header_t*)map;
+    if (memcmp(header->magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0) {
+        fprintf(stderr, "%s: não é um trace (magic inválido)\n", argv[1]);
+        return 1;
+    }
+
+    // O trace.c cria o arquivo já com todas as regiões (esparso); menor que
+    // isso, o arquivo foi truncado e as regiões passariam do mapeamento
+    uint64_t per_thread = header->events_per_thread;
+    uint64_t region_bytes = (uint64_t)st.st_size - sizeof(trace_header_t);
+    if (per_thread == 0 || per_thread > region_bytes / ((uint64_t)TRACE_MAX_THREADS * sizeof(trace_event_t))) {
+        fprintf(stderr, "%s: trace truncado (%ld bytes para %lu eventos por região)\n", argv[1],
+                (long)st.st_size, (unsigned long)per_thread);
+        return 1;
+    }
+    strings_limit = header->strings_used < TRACE_STRINGS_SIZE ? header->strings_used : TRACE_STRINGS_SIZE;
+
+    out = argc > 2 ? fopen(argv[2], "w") : stdout;
+    if (!out) {
+        perror(argv[2]);
+        return 1;
+    }
+
+    const trace_event_t* regions = (const trace_event_t*)(map + sizeof(trace_header_t));
+    uint32_t threads = header->thread_count < TRACE_MAX_THREADS ? header->thread_count : TRACE_MAX_THREADS;
+
+    // Junta todas as threads numa lista só, ordenada pelo instante
+    size_t total = 0;
+    uint64_t dropped = 0;
+    for (uint32_t t = 0; t < threads; t++) {
+        total += header->threads[t].count < per_thread ? header->threads[t].count : per_thread;
+        dropped += header->threads[t].dropped;
+    }
+    item_t* items = malloc((total ? total : 1) * sizeof(item_t));
+    thread_state_t* state = calloc(threads ? threads : 1, sizeof(thread_state_t));
+    if (!items || !state) {
+        perror("malloc");
+        return 1;
+    }
+    size_t n = 0;
+    uint64_t last_ts = header->start_ns;
+    for (uint32_t t = 0; t < threads; t++) {
+        state[t].tid = header->threads[t].tid;
+        state[t].label = header->threads[t].label;
+        uint64_t count = header->threads[t].count < per_thread ? header->threads[t].count : per_thread;
+        for (uint64_t i = 0; i < count; i++) {
+            items[n].event = &regions[t * per_thread + i];
+            items[n].thread = t;
+            if (items[n].event->ts_ns > last_ts) last_ts = items[n].event->ts_ns;
+            n++;
+        }
+    }
+    qsort(items, n, sizeof(item_t), compare_items);
+    uint32_t occupants = 0;
+
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    begin_event("M", "", "process_name", 0, header->start_ns);
+    fprintf(out, ",\"args\":{\"name\":");
+    json_string(string_at(header->process_name));
+    fprintf(out, "}}");
+    for (uint32_t t = 0; t < threads; t++) {
+        thread_name(header->threads[t].tid, header->threads[t].label);
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        const trace_event_t* e = items[i].event;
+        thread_state_t* s = &state[items[i].thread];
+        const char* name = string_at(e->name);
+        open_span_t found;
+
+        if (e->type == TRACE_THREAD_BEGIN && s->running && e->obj == s->tid) {
+            // Mesma thread dando nome depois de já ter gravado eventos
+            if (e->name) s->label = e->name;
+            thread_name(s->tid, s->label);
+            continue;
+        }
+        if (e->type == TRACE_THREAD_BEGIN) {
+            // Nova ocupante da região (obj = 0 em traces antigos: mesmo tid)
+            close_open(s, e->ts_ns, 0);
+            occupants++;
+            if (e->obj) s->tid = (uint32_t)e->obj;
+            s->label = e->name;
+            s->begin_ts = e->ts_ns;
+            s->running = 1;
+            thread_name(s->tid, s->label);
+            continue;
+        }
+        uint32_t tid = s->tid;
+
+        switch (e->type) {
+            case TRACE_THREAD_END:
+                if (s->running) {
+                    span("thread ", string_at(s->label), "thread", tid, s->begin_ts, e->ts_ns, 0);
+                    s->running = 0;
+                }
+                break;
+            case TRACE_LOCK_WAIT:
+                push_open(s->waits, &s->wait_count, e->obj, e->ts_ns, e->name);
+                break;
+            case TRACE_LOCK_ACQUIRE:
+                if (remove_open(s->waits, &s->wait_count, e->obj, &found)) {
+                    span("espera ", name, "lock", tid, found.ts, e->ts_ns, 0);
+                }
+                push_open(s->holds, &s->hold_count, e->obj, e->ts_ns, e->name);
+                break;
+            case TRACE_LOCK_RELEASE:
+                if (remove_open(s->holds, &s->hold_count, e->obj, &found)) {
+                    span("segura ", name, "lock", tid, found.ts, e->ts_ns, 0);
+                }
+                break;
+            case TRACE_ALLOC:
+            case TRACE_FREE:
+                heap_track(e->obj, e->value, e->type == TRACE_ALLOC);
+                begin_event("i", e->type == TRACE_ALLOC ? "malloc" : "free", "", tid, e->ts_ns);
+                fprintf(out, ",\"cat\":\"heap\",\"s\":\"t\",\"args\":{\"ptr\":\"0x%lx\",\"bytes\":%lu}}",
+                        (unsigned long)e->obj, (unsigned long)e->value);
+                begin_event("C", "", "heap rastreado", 0, e->ts_ns);
+                fprintf(out, ",\"args\":{\"bytes\":%ld}}", (long)heap_live);
+                break;
+            case TRACE_SIGNAL:
+                begin_event("i", "sinal ", strsignal((int)e->value), tid, e->ts_ns);
+                fprintf(out, ",\"cat\":\"sinal\",\"s\":\"p\",\"args\":{\"endereço\":\"0x%lx\"}}",
+                        (unsigned long)e->obj);
+                break;
+            case TRACE_COUNTER:
+                begin_event("C", "", name, 0, e->ts_ns);
+                fprintf(out, ",\"args\":{\"valor\":%ld}}", (long)e->value);
+                break;
+            case TRACE_MARK:
+                begin_event("i", "", name, tid, e->ts_ns);
+                fprintf(out, ",\"cat\":\"marca\",\"s\":\"t\",\"args\":{\"valor\":%ld}}", (long)e->value);
+                break;
+            default:
+                break;
+        }
+    }
+
+    // O que ficou aberto vai até o fim do trace
+    int unfinished_waits = 0;
+    for (uint32_t t = 0; t < threads; t++) {
+        unfinished_waits += close_open(&state[t], last_ts, 1);
+    }
+    fprintf(out, "\n]}\n");
+
+    fprintf(stderr, "%zu eventos de %u threads em %u regiões (pid %u, %s)", n, occupants, threads, header->pid,
+            string_at(header->process_name));
+    if (dropped) {
+        fprintf(stderr, ", %lu descartados", (unsigned long)dropped);
+    }
+    fprintf(stderr, "\n");
+    if (unfinished_waits) {
+        fprintf(stderr, "%d esperas por lock sem fim: possível deadlock\n", unfinished_waits);
+    }
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    free(items);
+    free(state);
+    return 0;
+}
@@ -0,0 +1,172 @@
+/*
+ * Parâmetros de carga dos cenários com threads - implementação
+ */
+
+#define _GNU_SOURCE
+#include "workload.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+workload_t workload = {0, 0, 0, 0};
+
+static int cpus[CPU_SETSIZE];
+static int cpu_count = 0;
+static int results_fd = -1;
+
+// "0-3,8,10-11" -> lista de CPUs; devolve quantas leu
+static int parse_cpu_list(const char* list) {
+    int n = 0;
+    const char* p = list;
+    while (*p && n < CPU_SETSIZE) {
+        char* end;
+        long first = strtol(p, &end, 10);
+        if (end == p) {
+            break;
+        }
+        long last = first;
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+        }
+        for (long cpu = first; cpu <= last && n < CPU_SETSIZE; cpu++) {
+            if (cpu >= 0 && cpu < CPU_SETSIZE) {
+                cpus[n++] = (int)cpu;
+            }
+        }
+        p = *end == ',' ? end + 1 : end;
+    }
+    return n;
+}
+
+static void set_pin(const char* value) {
+    if (!value || strcmp(value, "0") == 0) {
+        workload.pin = 0;
+        return;
+    }
+    workload.pin = 1;
+    cpu_count = 0;
+    if (strcmp(value, "1") != 0 && *value) {
+        cpu_count = parse_cpu_list(value);
+    }
+    if (cpu_count == 0) {
+        // Todas as CPUs em que o processo pode rodar, em ordem
+        cpu_set_t allowed;
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                if (CPU_ISSET(cpu, &allowed)) {
+                    cpus[cpu_count++] = cpu;
+                }
+            }
+        }
+    }
+    if (cpu_count == 0) {
+        workload.pin = 0;
+    }
+}
+
+static void set_results(const char* path) {
+    if (results_fd >= 0) {
+        close(results_fd);
+    }
+    results_fd = path && *path ? open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644) : -1;
+    if (path && *path && results_fd < 0) {
+        perror("workload: WORKLOAD_RESULTS");
+    }
+}
+
+// Aplica "nome=valor" (nome sem o "--"); devolve 0 se não for um parâmetro de carga
+static int apply(const char* option) {
+    const char* value = strchr(option, '=');
+    size_t len = value ? (size_t)(value - option) : strlen(option);
+    value = value ? value + 1 : NULL;
+
+    if (len == 7 && strncmp(option, "threads", len) == 0 && value) {
+        workload.threads = atoi(value);
+    } else if (len == 10 && strncmp(option, "iterations", len) == 0 && value) {
+        workload.iterations = atol(value);
+    } else if (len == 4 && strncmp(option, "work", len) == 0 && value) {
+        workload.work = atol(value);
+    } else if (len == 3 && strncmp(option, "pin", len) == 0) {
+        set_pin(value ? value : "1");
+    } else if (len == 7 && strncmp(option, "results", len) == 0 && value) {
+        set_results(value);
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+void workload_init(int* argc, char* argv[]) {
+    const char* env;
+    if ((env = getenv("WORKLOAD_THREADS"))) workload.threads = atoi(env);
+    if ((env = getenv("WORKLOAD_ITERATIONS"))) workload.iterations = atol(env);
+    if ((env = getenv("WORKLOAD_WORK"))) workload.work = atol(env);
+    if ((env = getenv("WORKLOAD_PIN"))) set_pin(env);
+    if ((env = getenv("WORKLOAD_RESULTS"))) set_results(env);
+
+    // Remove as opções reconhecidas, mantendo a ordem do resto
+    int kept = 1;
+    for (int i = 1; i < *argc; i++) {
+        if (strncmp(argv[i], "--", 2) == 0 && apply(argv[i] + 2)) {
+            continue;
+        }
+        argv[kept++] = argv[i];
+    }
+    argv[kept] = NULL;
+    *argc = kept;
+
+    if (workload.threads < 0) workload.threads = 0;
+    if (workload.iterations < 0) workload.iterations = 0;
+    if (workload.work < 0) workload.work = 0;
+}
+
+int workload_threads(int fallback) {
+    return workload.threads > 0 ? workload.threads : fallback;
+}
+
+long workload_iterations(long fallback) {
+    return workload.iterations > 0 ? workload.iterations : fallback;
+}
+
+void workload_spin(long units) {
+    unsigned long x = (unsigned long)units;
+    for (long i = 0; i < units; i++) {
+        // Multiplicação dependente da anterior: não vetoriza nem some
+        x = x * 6364136223846793005UL + 1442695040888963407UL;
+        __asm__ __volatile__("" : "+r"(x));
+    }
+}
+
+void workload_pin_thread(int index) {
+    if (!workload.pin) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpus[index % cpu_count], &set);
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err != 0 && index == 0) {
+        fprintf(stderr, "workload: não foi possível fixar na CPU %d: %s\n",
+                cpus[index % cpu_count], strerror(err));
+    }
+}
+
+void workload_result(const char* scenario, const char* mode, int threads,
+                     double ops, double seconds, long lost) {
+    if (results_fd < 0) {
+        return;
+    }
+    // Uma linha por write() com O_APPEND: execuções paralelas não se misturam
+    char line[256];
+    int len = snprintf(line, sizeof(line), "%s\t%s\t%d\t%ld\t%.0f\t%.9f\t%ld\n",
+                       scenario, mode, threads, workload.work, ops, seconds, lost);
+    if (len > 0 && write(results_fd, line, len) < 0) {
+        perror("workload: WORKLOAD_RESULTS");
+    }
+}
@@ -0,0 +1,59 @@
+/*
+ * Parâmetros de carga dos cenários com threads
+ *
+ * Os testes têm números fixos (5 threads x 1000 incrementos, 4 x 50
+ * transferências, 5 threads no deadlock complexo). Estes parâmetros
+ * trocam esses números sem recompilar, pela linha de comando (em
+ * qualquer posição; são removidos de argv antes de o cenário ler as
+ * opções) ou pelo ambiente:
+ *
+ *   --threads=N     WORKLOAD_THREADS=N     número de threads; nos
+ *                                          benchmarks roda só N em vez
+ *                                          da série 1, 2, 4, ... max
+ *   --iterations=N  WORKLOAD_ITERATIONS=N  iterações por thread
+ *   --work=N        WORKLOAD_WORK=N        unidades de trabalho de CPU
+ *                                          (~1 ns cada) por iteração,
+ *                                          fora da seção crítica
+ *   --pin[=lista]   WORKLOAD_PIN=1|lista   fixa a thread i na i-ésima CPU
+ *                                          permitida, ou da lista
+ *                                          ("0-15,32-47")
+ *   --results=arq   WORKLOAD_RESULTS=arq   acrescenta uma linha TSV por
+ *                                          medição (usado por
+ *                                          scripts/sweep.sh): cenário,
+ *                                          modo, threads, work, ops,
+ *                                          segundos, perdidos
+ *
+ * A linha de comando tem precedência sobre o ambiente, e os dois sobre
+ * os argumentos posicionais de cada cenário.
+ */
+
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+typedef struct {
+    int threads;       // 0 = padrão do teste
+    long iterations;   // 0 = padrão do teste
+    long work;         // 0 = nenhum trabalho extra
+    int pin;
+} workload_t;
+
+extern workload_t workload;
+
+// Lê o ambiente e tira as opções --threads=... etc. de argv
+void workload_init(int* argc, char* argv[]);
+
+// Valor configurado ou o padrão do teste
+int workload_threads(int fallback);
+long workload_iterations(long fallback);
+
+// Gasta aproximadamente 'units' ns de CPU sem tocar memória compartilhada
+void workload_spin(long units);
+
+// Fixa a thread chamadora na CPU do seu índice (sem efeito sem --pin)
+void workload_pin_thread(int index);
+
+// Registra uma medição: ops operações em seconds, lost perdidas pela race
+void workload_result(const char* scenario, const char* mode, int threads,
+                     double ops, double seconds, long lost);
+
+#endif